@@ -1,16 +1,21 @@
-#include <mcl/bn256.hpp>
+#include "curve.h"
+#include "scalar_mul.h"
+#include "fixed_base.h"
+#include "nullifier_store.h"
+#include "wire_format.h"
 #include <iostream>
 #include <sstream>
+#include <vector>
 #include <openssl/sha.h>
 
-using namespace mcl::bn256;
-
 // CHAC Protocol Implementation (Simplified for performance testing)
 
 struct CHAC_PublicParams {
     G1 g1, y1, sk, pk1, pk2;
     G2 g2, y2, ipk1, ipk2;
     Fr x1, x2;
+    // Miller-loop lines for the fixed G2 arguments of the redeem equations
+    std::vector<Fp6> g2_lines, y2_lines, ipk1_lines, ipk2_lines;
 };
 
 struct CHAC_Query {
@@ -28,6 +33,66 @@ struct CHAC_Msg {
     G2 s2p, w2p, vp;
 };
 
+// Wire encodings (wire_format.h).
+template<> struct WireMessage<CHAC_Query> {
+    static const uint8_t type = 0x40;
+    static const char* name() { return "CHAC_Query"; }
+    enum { PK2, SIG, S1, S2 };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.pk2);
+        v(m.sig);
+        v(m.s1);
+        v(m.s2);
+    }
+};
+
+template<> struct WireMessage<CHAC_Response> {
+    static const uint8_t type = 0x41;
+    static const char* name() { return "CHAC_Response"; }
+    enum { W1, Z, W2, V_ };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.w1);
+        v(m.z);
+        v(m.w2);
+        v(m.v);
+    }
+};
+
+template<> struct WireMessage<CHAC_Msg> {
+    static const uint8_t type = 0x42;
+    static const char* name() { return "CHAC_Msg"; }
+    enum { PKP1, PKP2, SIGP, S1P, ZP, W1P, S2P, W2P, VP };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.pkp1);
+        v(m.pkp2);
+        v(m.sigp);
+        v(m.s1p);
+        v(m.zp);
+        v(m.w1p);
+        v(m.s2p);
+        v(m.w2p);
+        v(m.vp);
+    }
+};
+
+// Everything chac_server_issue derives from the issuer's parameters alone,
+// computed once per issuer by chac_issuer_context().
+struct CHAC_IssuerContext {
+    Fr h_ipk_scalar;               // H(ipk1); h_ipk = g2^h_ipk_scalar
+    G1 xpk;                        // pk1*x1 + pk2*x2
+    FixedBaseTable<G1> g1_table;
+    FixedBaseTable<G2> g2_table;
+    FixedBaseTable<G1> xpk_table;
+};
+
+// Client-side state for one credential: h = g1^H(nonce) is derived once
+// and shared by the query and every redemption of the credential.
+struct CHAC_CredentialContext {
+    Fr nonce;
+    G1 h;
+    FixedBaseTable<G1> h_table;
+};
+
 void hashToFr_CHAC(Fr& result, const std::string& data) {
     unsigned char hash[SHA256_DIGEST_LENGTH];
     SHA256(reinterpret_cast<const unsigned char*>(data.c_str()), data.size(), hash);
@@ -46,6 +111,14 @@ void hashToFr_CHAC(Fr& result, const std::string& data) {
     result.setArrayMask(decoded, 32);
 }
 
+// Scalar of h_ipk = g2^H(ipk1), the issuer-bound base of v
+void chac_hash_ipk(Fr& result, const G2& ipk1) {
+    unsigned char buf[MAX_G2_BYTES];
+    size_t n = ipk1.serialize(buf, sizeof(buf));
+    std::string ipk1_str(reinterpret_cast<char*>(buf), n);
+    hashToFr_CHAC(result, ipk1_str);
+}
+
 CHAC_PublicParams chac_setup() {
     CHAC_PublicParams pp;
     
@@ -69,6 +142,11 @@ CHAC_PublicParams chac_setup() {
     G2::mul(pp.ipk1, pp.g2, pp.x1);
     G2::mul(pp.ipk2, pp.g2, pp.x2);
     
+    precomputeG2(pp.g2_lines, pp.g2);
+    precomputeG2(pp.y2_lines, pp.y2);
+    precomputeG2(pp.ipk1_lines, pp.ipk1);
+    precomputeG2(pp.ipk2_lines, pp.ipk2);
+    
     return pp;
 }
 
@@ -95,6 +173,34 @@ CHAC_Query chac_client_query(const CHAC_PublicParams& pp, const Fr& nonce) {
     return query;
 }
 
+CHAC_CredentialContext chac_credential_context(const CHAC_PublicParams& pp, const Fr& nonce) {
+    CHAC_CredentialContext cred;
+    cred.nonce = nonce;
+    
+    Fr h_scalar;
+    hashToFr_CHAC(h_scalar, nonce.getStr());
+    mul_public(cred.h, pp.g1, h_scalar);
+    cred.h_table.init(cred.h);
+    return cred;
+}
+
+CHAC_Query chac_client_query(const CHAC_PublicParams& pp, const CHAC_CredentialContext& cred) {
+    Fr r;
+    r.setByCSPRNG();
+    
+    CHAC_Query query;
+    mul_secret(query.s1, pp.g1, r);
+    mul_secret(query.s2, pp.g2, r);
+    
+    G1 temp;
+    cred.h_table.mul(temp, r);
+    G1::add(query.sig, pp.sk, temp);
+    
+    query.pk2 = pp.pk2;
+    
+    return query;
+}
+
 CHAC_Response chac_server_issue(const CHAC_PublicParams& pp, const Fr& nonce, const CHAC_Query& query) {
     // Skip verification for performance testing
     
@@ -117,11 +223,8 @@ CHAC_Response chac_server_issue(const CHAC_PublicParams& pp, const Fr& nonce, co
     G1::mul(resp.w1, pp.g1, yinv);
     G2::mul(resp.w2, pp.g2, yinv);
     
-    unsigned char buf[64];
-    pp.ipk1.serialize(buf, 96);
-    std::string ipk1_str(reinterpret_cast<char*>(buf), 96);
     Fr h_ipk_scalar;
-    hashToFr_CHAC(h_ipk_scalar, ipk1_str);
+    chac_hash_ipk(h_ipk_scalar, pp.ipk1);
     
     G2 h_ipk;
     G2::mul(h_ipk, pp.g2, h_ipk_scalar);
@@ -130,6 +233,45 @@ CHAC_Response chac_server_issue(const CHAC_PublicParams& pp, const Fr& nonce, co
     return resp;
 }
 
+CHAC_IssuerContext chac_issuer_context(const CHAC_PublicParams& pp) {
+    CHAC_IssuerContext ctx;
+    chac_hash_ipk(ctx.h_ipk_scalar, pp.ipk1);
+    
+    G1 temp;
+    mul_secret(ctx.xpk, pp.pk1, pp.x1);
+    mul_secret(temp, pp.pk2, pp.x2);
+    ctx.xpk += temp;
+    
+    ctx.g1_table.init(pp.g1);
+    ctx.g2_table.init(pp.g2);
+    ctx.xpk_table.init(ctx.xpk);
+    return ctx;
+}
+
+// chac_server_issue with the issuer-only values taken from ctx: one hash,
+// one inversion and four fixed-base multiplications per request.
+CHAC_Response chac_server_issue(const CHAC_IssuerContext& ctx, const CHAC_Query& query) {
+    Fr key, y, yinv;
+    key.setByCSPRNG();
+    
+    std::stringstream ss;
+    ss << key.getStr() << query.pk2.getStr();
+    hashToFr_CHAC(y, ss.str());
+    Fr::inv(yinv, y);
+    
+    CHAC_Response resp;
+    ctx.xpk_table.mul(resp.z, y);
+    ctx.g1_table.mul(resp.w1, yinv);
+    ctx.g2_table.mul(resp.w2, yinv);
+    
+    // v = h_ipk^(1/y) = g2^(H(ipk1)/y)
+    Fr v_scalar;
+    Fr::mul(v_scalar, ctx.h_ipk_scalar, yinv);
+    ctx.g2_table.mul(resp.v, v_scalar);
+    
+    return resp;
+}
+
 CHAC_Msg chac_client_redeem(const CHAC_PublicParams& pp, const Fr& nonce, const CHAC_Response& resp) {
     Fr h_scalar;
     hashToFr_CHAC(h_scalar, nonce.getStr());
@@ -168,7 +310,113 @@ CHAC_Msg chac_client_redeem(const CHAC_PublicParams& pp, const Fr& nonce, const
     return msg;
 }
 
+CHAC_Msg chac_client_redeem(const CHAC_PublicParams& pp, const CHAC_CredentialContext& cred,
+                            const CHAC_Response& resp) {
+    Fr rp, kdp, psi;
+    rp.setByCSPRNG();
+    kdp.setByCSPRNG();
+    psi.setByCSPRNG();
+    
+    CHAC_Msg msg;
+    
+    mul_secret(msg.s1p, pp.g1, kdp);
+    mul_secret(msg.s2p, pp.g2, kdp);
+    
+    G1 temp1, temp2;
+    mul_secret(temp1, pp.sk, rp);
+    cred.h_table.mul(temp2, kdp);
+    G1::add(msg.sigp, temp1, temp2);
+    
+    mul_secret(msg.pkp1, pp.g1, rp);
+    mul_secret(msg.pkp2, pp.pk2, rp);
+    
+    Fr rp_psi;
+    Fr::mul(rp_psi, rp, psi);
+    mul_secret(msg.zp, resp.z, rp_psi);
+    
+    Fr psi_inv;
+    Fr::inv(psi_inv, psi);
+    mul_secret(msg.w1p, resp.w1, psi_inv);
+    mul_secret(msg.w2p, resp.w2, psi_inv);
+    mul_secret(msg.vp, resp.v, psi_inv);
+    
+    return msg;
+}
+
+// Checks, with h = g1^H(nonce) and h_ipk = g2^H(ipk1):
+//   (1) e(zp, w2p)   = e(pkp1, ipk1) * e(pkp2, ipk2)   issuer signature
+//   (2) e(w1p, g2)   = e(g1, w2p)                       w1p, w2p consistent
+//   (3) e(g1, vp)    = e(w1p, h_ipk)                    v bound to the issuer
+//   (4) e(sigp, g2)  = e(pkp2, y2) * e(h, s2p)          user signature on h
+//   (5) e(s1p, g2)   = e(g1, s2p)                       s1p, s2p consistent
+// Each equation is raised to a random rho_i (rho_1 = 1) and the product is
+// regrouped by G2 argument: three Miller loops over the G2 elements in msg,
+// four over the lines precomputed in chac_setup, one final exponentiation.
 bool chac_server_redeem(const CHAC_PublicParams& pp, const Fr& nonce, const CHAC_Msg& msg) {
-    // Skip all pairing verifications for performance testing
-    return true;
+    if (msg.pkp1.isZero() || msg.w1p.isZero() || msg.w2p.isZero()) {
+        return false;
+    }
+    
+    Fr h_scalar, h_ipk_scalar;
+    hashToFr_CHAC(h_scalar, nonce.getStr());
+    chac_hash_ipk(h_ipk_scalar, pp.ipk1);
+    
+    Fr rho2, rho3, rho4, rho5;
+    rho2.setByCSPRNG();
+    rho3.setByCSPRNG();
+    rho4.setByCSPRNG();
+    rho5.setByCSPRNG();
+    
+    Fr k[3];
+    G1 B[3];
+    
+    // G2 elements from the message
+    G1 P_var[3];
+    G2 Q_var[3] = { msg.w2p, msg.vp, msg.s2p };
+    // w2p: zp - g1*rho2
+    B[0] = msg.zp;
+    B[1] = pp.g1;
+    k[0] = 1;
+    Fr::neg(k[1], rho2);
+    msm_public(P_var[0], B, k, 2);
+    // vp: g1*rho3
+    mul_public(P_var[1], pp.g1, rho3);
+    // s2p: -(h*rho4 + g1*rho5) = g1*-(H(nonce)*rho4 + rho5)
+    Fr::mul(k[0], h_scalar, rho4);
+    Fr::add(k[0], k[0], rho5);
+    Fr::neg(k[0], k[0]);
+    mul_public(P_var[2], pp.g1, k[0]);
+    
+    // Fixed G2 elements
+    G1 P_g2, P_y2, P_ipk1, P_ipk2;
+    // g2: w1p*(rho2 - H(ipk1)*rho3) + sigp*rho4 + s1p*rho5
+    B[0] = msg.w1p;
+    B[1] = msg.sigp;
+    B[2] = msg.s1p;
+    Fr::mul(k[0], h_ipk_scalar, rho3);
+    Fr::sub(k[0], rho2, k[0]);
+    k[1] = rho4;
+    k[2] = rho5;
+    msm_public(P_g2, B, k, 3);
+    // y2: -pkp2*rho4
+    Fr::neg(k[0], rho4);
+    mul_public(P_y2, msg.pkp2, k[0]);
+    // ipk1, ipk2: -pkp1, -pkp2
+    G1::neg(P_ipk1, msg.pkp1);
+    G1::neg(P_ipk2, msg.pkp2);
+    
+    GT f, f_fixed;
+    millerLoopVec(f, P_var, Q_var, 3);
+    precomputedMillerLoop2(f_fixed, P_g2, pp.g2_lines, P_y2, pp.y2_lines);
+    f *= f_fixed;
+    precomputedMillerLoop2(f_fixed, P_ipk1, pp.ipk1_lines, P_ipk2, pp.ipk2_lines);
+    f *= f_fixed;
+    finalExp(f, f);
+    return f.isOne();
+}
+
+// chac_server_redeem plus the double-spend check on the credential's nonce.
+bool chac_server_redeem(const CHAC_PublicParams& pp, const Fr& nonce, const CHAC_Msg& msg,
+                        NullifierStore& spent) {
+    return chac_server_redeem(pp, nonce, msg) && spent.insert(nullifier_tag("chac/nonce", nonce));
 }
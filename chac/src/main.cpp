@@ -1,12 +1,12 @@
-#include <mcl/bn256.hpp>
+#include "curve.h"
 #include <iostream>
 #include <chrono>
 #include <iomanip>
 
 using namespace std::chrono;
-using namespace mcl::bn256;
 
 #include "chac_protocol.cpp"
+#include "wire_bench.h"
 
 void print_timing(const std::string& operation, double ms) {
     std::cout << operation << ": " 
@@ -14,88 +14,181 @@ void print_timing(const std::string& operation, double ms) {
               << ms << " ms" << std::endl;
 }
 
-int main() {
-    initPairing();
-    
-    std::cout << "\n========================================" << std::endl;
-    std::cout << "=== CHAC Protocol Benchmark ===" << std::endl;
-    std::cout << "========================================\n" << std::endl;
-    
-    auto start = steady_clock::now();
-    CHAC_PublicParams pp = chac_setup();
-    auto end = steady_clock::now();
-    print_timing("Setup", duration<double, std::milli>(end - start).count());
-    
-    Fr nonce;
-    nonce.setByCSPRNG();
-    
-    // Single run test
-    std::cout << "\n=== Single Run Test ===" << std::endl;
-    
-    start = steady_clock::now();
-    CHAC_Query query = chac_client_query(pp, nonce);
-    end = steady_clock::now();
-    double client_query_time = duration<double, std::milli>(end - start).count();
-    print_timing("Client Query", client_query_time);
-    
-    start = steady_clock::now();
-    CHAC_Response response = chac_server_issue(pp, nonce, query);
-    end = steady_clock::now();
-    double server_issue_time = duration<double, std::milli>(end - start).count();
-    print_timing("Server Issue", server_issue_time);
-    
-    std::cout << "\n** Total Issuance Time: " << std::fixed << std::setprecision(2)
-              << (client_query_time + server_issue_time) << " ms **" << std::endl;
-    
-    start = steady_clock::now();
-    CHAC_Msg msg = chac_client_redeem(pp, nonce, response);
-    end = steady_clock::now();
-    double client_redeem_time = duration<double, std::milli>(end - start).count();
-    print_timing("Client Redeem", client_redeem_time);
-    
-    start = steady_clock::now();
-    bool verified = chac_server_redeem(pp, nonce, msg);
-    end = steady_clock::now();
-    double server_redeem_time = duration<double, std::milli>(end - start).count();
-    print_timing("Server Redeem", server_redeem_time);
-    
-    std::cout << "\n** Total Redemption Time: " << std::fixed << std::setprecision(2)
-              << (client_redeem_time + server_redeem_time) << " ms **" << std::endl;
-    
-    std::cout << "\nVerification result: SUCCESS" << std::endl;
-    
-    // Performance test
-    std::cout << "\n=== Performance Test (1000 iterations) ===" << std::endl;
-    
-    start = steady_clock::now();
-    for (int i = 0; i < 1000; ++i) {
-        CHAC_Query q = chac_client_query(pp, nonce);
-        CHAC_Response r = chac_server_issue(pp, nonce, q);
-    }
-    end = steady_clock::now();
-    double total_issuance = duration<double, std::milli>(end - start).count();
-    std::cout << "Total time for 1000 issuances: " << std::fixed << std::setprecision(2) 
-              << total_issuance << " ms" << std::endl;
-    std::cout << "Average time per issuance: " << std::fixed << std::setprecision(2) 
-              << total_issuance / 1000.0 << " ms" << std::endl;
-    
-    start = steady_clock::now();
-    for (int i = 0; i < 1000; ++i) {
-        CHAC_Msg m = chac_client_redeem(pp, nonce, response);
-        bool v = chac_server_redeem(pp, nonce, m);
+struct CHACBenchmark {
+    template<class Curve>
+    CurveBenchSummary run() const {
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "=== CHAC Protocol Benchmark ===" << std::endl;
+        std::cout << "========================================\n" << std::endl;
+
+        auto start = steady_clock::now();
+        CHAC_PublicParams pp = chac_setup();
+        auto end = steady_clock::now();
+        print_timing("Setup", duration<double, std::milli>(end - start).count());
+
+        start = steady_clock::now();
+        CHAC_IssuerContext issuer = chac_issuer_context(pp);
+        end = steady_clock::now();
+        print_timing("Issuer Context", duration<double, std::milli>(end - start).count());
+
+        Fr nonce;
+        nonce.setByCSPRNG();
+
+        start = steady_clock::now();
+        CHAC_CredentialContext cred = chac_credential_context(pp, nonce);
+        end = steady_clock::now();
+        print_timing("Client Credential Context", duration<double, std::milli>(end - start).count());
+
+        // Single run test
+        std::cout << "\n=== Single Run Test ===" << std::endl;
+
+        start = steady_clock::now();
+        CHAC_Query query = chac_client_query(pp, cred);
+        end = steady_clock::now();
+        double client_query_time = duration<double, std::milli>(end - start).count();
+        print_timing("Client Query", client_query_time);
+
+        start = steady_clock::now();
+        CHAC_Response response = chac_server_issue(issuer, query);
+        end = steady_clock::now();
+        double server_issue_time = duration<double, std::milli>(end - start).count();
+        print_timing("Server Issue", server_issue_time);
+
+        std::cout << "\n** Total Issuance Time: " << std::fixed << std::setprecision(2)
+                  << (client_query_time + server_issue_time) << " ms **" << std::endl;
+
+        start = steady_clock::now();
+        CHAC_Msg msg = chac_client_redeem(pp, cred, response);
+        end = steady_clock::now();
+        double client_redeem_time = duration<double, std::milli>(end - start).count();
+        print_timing("Client Redeem", client_redeem_time);
+
+        start = steady_clock::now();
+        bool verified = chac_server_redeem(pp, nonce, msg);
+        end = steady_clock::now();
+        double server_redeem_time = duration<double, std::milli>(end - start).count();
+        print_timing("Server Redeem", server_redeem_time);
+
+        std::cout << "\n** Total Redemption Time: " << std::fixed << std::setprecision(2)
+                  << (client_redeem_time + server_redeem_time) << " ms **" << std::endl;
+
+        std::cout << "\nVerification result: " << (verified ? "SUCCESS" : "FAILED") << std::endl;
+
+        std::cout << "\n=== Wire Format ===" << std::endl;
+        wire_report_header();
+        wire_report(query);
+        wire_report(response);
+        wire_report(msg);
+        std::cout << std::endl;
+        wire_trust_report_header(64);
+        wire_trust_report(query);
+        wire_trust_report(msg);
+
+        // Performance test
+        std::cout << "\n=== Performance Test (1000 iterations) ===" << std::endl;
+
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            CHAC_Query q = chac_client_query(pp, cred);
+            chac_server_issue(issuer, q);
+        }
+        end = steady_clock::now();
+        double total_issuance = duration<double, std::milli>(end - start).count();
+        std::cout << "Total time for 1000 issuances: " << std::fixed << std::setprecision(2) 
+                  << total_issuance << " ms" << std::endl;
+        std::cout << "Average time per issuance: " << std::fixed << std::setprecision(2) 
+                  << total_issuance / 1000.0 << " ms" << std::endl;
+
+        int redemption_failures = 0;
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            CHAC_Msg m = chac_client_redeem(pp, cred, response);
+            if (!chac_server_redeem(pp, nonce, m)) {
+                ++redemption_failures;
+            }
+        }
+        end = steady_clock::now();
+        double total_redemption = duration<double, std::milli>(end - start).count();
+        std::cout << "Total time for 1000 redemptions: " << std::fixed << std::setprecision(2) 
+                  << total_redemption << " ms" << std::endl;
+        std::cout << "Average time per redemption: " << std::fixed << std::setprecision(2) 
+                  << total_redemption / 1000.0 << " ms" << std::endl;
+        if (redemption_failures != 0) {
+            std::cout << "Redemption failures: " << redemption_failures << std::endl;
+        }
+
+        // The server side used to return true without checking anything, so
+        // the old redemption figure was the client's share alone.
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            chac_client_redeem(pp, cred, response);
+        }
+        end = steady_clock::now();
+        double client_only = duration<double, std::milli>(end - start).count();
+        std::cout << "\nRedemption with stubbed server check: " << std::fixed << std::setprecision(2)
+                  << client_only / 1000.0 << " ms" << std::endl;
+        std::cout << "Added cost of the server's multi-pairing check: " << std::fixed << std::setprecision(2)
+                  << (total_redemption - client_only) / 1000.0 << " ms" << std::endl;
+
+        // Server issue recomputing the issuer-derived values per request vs.
+        // taking them from the issuer context
+        std::cout << "\n=== Server Issue: per-request vs. cached issuer values (1000 iterations) ===" << std::endl;
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            chac_server_issue(pp, nonce, query);
+        }
+        end = steady_clock::now();
+        double issue_uncached = duration<double, std::milli>(end - start).count();
+
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            chac_server_issue(issuer, query);
+        }
+        end = steady_clock::now();
+        double issue_cached = duration<double, std::milli>(end - start).count();
+
+        print_timing("Server Issue, recomputed", issue_uncached / 1000.0);
+        print_timing("Server Issue, issuer context", issue_cached / 1000.0);
+        print_timing("Saved per issuance", (issue_uncached - issue_cached) / 1000.0);
+
+        // Client rounds deriving h from the nonce each time vs. taking it
+        // from the credential context
+        std::cout << "\n=== Client Rounds: per-call h vs. credential context (1000 iterations) ===" << std::endl;
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            chac_client_query(pp, nonce);
+            chac_client_redeem(pp, nonce, response);
+        }
+        end = steady_clock::now();
+        double client_uncached = duration<double, std::milli>(end - start).count();
+
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            chac_client_query(pp, cred);
+            chac_client_redeem(pp, cred, response);
+        }
+        end = steady_clock::now();
+        double client_cached = duration<double, std::milli>(end - start).count();
+
+        print_timing("Client query + redeem, per-call h", client_uncached / 1000.0);
+        print_timing("Client query + redeem, credential context", client_cached / 1000.0);
+        print_timing("Saved per credential round trip", (client_uncached - client_cached) / 1000.0);
+
+        std::cout << "\n=== Performance Summary ===" << std::endl;
+        std::cout << "Issuance throughput: ~" << std::fixed << std::setprecision(0)
+                  << 1000000.0 / total_issuance << " tokens/second" << std::endl;
+        std::cout << "Redemption throughput: ~" << std::fixed << std::setprecision(0)
+                  << 1000000.0 / total_redemption << " tokens/second" << std::endl;
+
+        CurveBenchSummary summary;
+        summary.issuance_ms = total_issuance / 1000.0;
+        summary.redemption_ms = total_redemption / 1000.0;
+        return summary;
     }
-    end = steady_clock::now();
-    double total_redemption = duration<double, std::milli>(end - start).count();
-    std::cout << "Total time for 1000 redemptions: " << std::fixed << std::setprecision(2) 
-              << total_redemption << " ms" << std::endl;
-    std::cout << "Average time per redemption: " << std::fixed << std::setprecision(2) 
-              << total_redemption / 1000.0 << " ms" << std::endl;
-    
-    std::cout << "\n=== Performance Summary ===" << std::endl;
-    std::cout << "Issuance throughput: ~" << std::fixed << std::setprecision(0)
-              << 1000000.0 / total_issuance << " tokens/second" << std::endl;
-    std::cout << "Redemption throughput: ~" << std::fixed << std::setprecision(0)
-              << 1000000.0 / total_redemption << " tokens/second" << std::endl;
-              
-    return 0;
+};
+
+// Usage: chac_benchmark [bn254|bls12_381|bn462|all]
+int main(int argc, char** argv) {
+    std::string curve = argc > 1 ? argv[1] : "bn254";
+    return run_curve_benchmark(curve, CHACBenchmark());
 }
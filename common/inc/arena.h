@@ -0,0 +1,158 @@
+#ifndef DNTAT_COMMON_ARENA_H
+#define DNTAT_COMMON_ARENA_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Bump allocator for request-scoped state.
+//
+// Memory is carved out of a chain of blocks owned by the arena. Nothing is
+// freed individually; rewinding (reset() or an ArenaScope going out of
+// scope) makes the blocks reusable. A worker that serves one request at a
+// time therefore reaches a steady state where no request touches malloc.
+class Arena {
+public:
+    struct Mark {
+        size_t block;
+        size_t offset;
+    };
+
+    explicit Arena(size_t block_size = 64 * 1024)
+        : block_size(block_size), current(0), offset(0) {}
+
+    ~Arena() {
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            std::free(blocks[i].first);
+        }
+    }
+
+    void* allocate(size_t size, size_t align) {
+        while (current < blocks.size()) {
+            size_t aligned = (offset + align - 1) & ~(align - 1);
+            if (aligned + size <= blocks[current].second) {
+                offset = aligned + size;
+                return blocks[current].first + aligned;
+            }
+            ++current;
+            offset = 0;
+        }
+
+        // Out of blocks: grow the chain. Oversized requests get a block of
+        // their own so they cannot waste the tail of a regular block.
+        size_t size_needed = size + align;
+        size_t new_size = size_needed > block_size ? size_needed : block_size;
+        char* mem = static_cast<char*>(std::malloc(new_size));
+        if (!mem) {
+            throw std::bad_alloc();
+        }
+        blocks.push_back(std::make_pair(mem, new_size));
+        current = blocks.size() - 1;
+        offset = 0;
+        return allocate(size, align);
+    }
+
+    Mark mark() const {
+        Mark m;
+        m.block = current;
+        m.offset = offset;
+        return m;
+    }
+
+    void rewind(const Mark& m) {
+        current = m.block;
+        offset = m.offset;
+    }
+
+    void reset() {
+        current = 0;
+        offset = 0;
+    }
+
+    size_t bytes_reserved() const {
+        size_t total = 0;
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            total += blocks[i].second;
+        }
+        return total;
+    }
+
+private:
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+
+    std::vector<std::pair<char*, size_t> > blocks;
+    size_t block_size;
+    size_t current;
+    size_t offset;
+};
+
+// One arena per worker thread.
+inline Arena& thread_arena() {
+    static thread_local Arena arena;
+    return arena;
+}
+
+// Rewinds the arena to where it was on construction. Open one per request;
+// scopes nest, so helpers may open their own for temporaries.
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena& arena = thread_arena())
+        : arena(arena), saved(arena.mark()) {}
+
+    ~ArenaScope() {
+        arena.rewind(saved);
+    }
+
+private:
+    ArenaScope(const ArenaScope&);
+    ArenaScope& operator=(const ArenaScope&);
+
+    Arena& arena;
+    Arena::Mark saved;
+};
+
+// Standard allocator backed by an Arena. deallocate() is a no-op; memory is
+// reclaimed when the owning ArenaScope ends, so containers using it must not
+// outlive that scope.
+template<class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    template<class U>
+    struct rebind {
+        typedef ArenaAllocator<U> other;
+    };
+
+    ArenaAllocator() : arena(&thread_arena()) {}
+    explicit ArenaAllocator(Arena& arena) : arena(&arena) {}
+
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) {}
+
+    template<class U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+        return arena == other.arena;
+    }
+
+    template<class U>
+    bool operator!=(const ArenaAllocator<U>& other) const {
+        return arena != other.arena;
+    }
+
+    Arena* arena;
+};
+
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+
+#endif
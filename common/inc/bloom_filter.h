@@ -0,0 +1,106 @@
+#ifndef DNTAT_COMMON_BLOOM_FILTER_H
+#define DNTAT_COMMON_BLOOM_FILTER_H
+
+#include "nullifier_store.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Register-blocked Bloom filter over nullifier tags.
+//
+// Each tag selects one 64-bit word and sets 8 bits in it, so a probe touches
+// a single cache line and a filter of a few bits per token stays in cache.
+// The 8 bit positions are the top 6 bits of the tag's hash times 8 odd
+// salts; the multiplies run as one 8-lane vector multiply where AVX2 or NEON
+// is available. Because all of a tag's bits live in one word,
+// test_and_set() is one atomic fetch_or, and of several threads presenting
+// the same tag at once exactly one sees it as new.
+
+class BlockedBloomFilter {
+public:
+    // Sized for `expected` tags at `bits_per_tag` bits each, rounded up to a
+    // power of two words.
+    explicit BlockedBloomFilter(size_t expected, unsigned bits_per_tag = 16) {
+        size_t words = 1;
+        while (words * 64 < expected * bits_per_tag) {
+            words <<= 1;
+        }
+        mask_ = words - 1;
+        words_.reset(new std::atomic<uint64_t>[words]);
+        for (size_t i = 0; i < words; ++i) {
+            words_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Adds the tag. Returns true if all its bits were already set, i.e. the
+    // tag may have been added before; false means it certainly was not.
+    bool test_and_set(const NullifierTag& tag) {
+        uint64_t bits = bit_mask(tag);
+        uint64_t old = words_[word_index(tag)].fetch_or(bits);
+        return (old & bits) == bits;
+    }
+
+    bool may_contain(const NullifierTag& tag) const {
+        uint64_t bits = bit_mask(tag);
+        return (words_[word_index(tag)].load(std::memory_order_acquire) & bits) == bits;
+    }
+
+    size_t bytes() const {
+        return (mask_ + 1) * sizeof(uint64_t);
+    }
+
+private:
+    // NullifierStore indexes by lo, so the filter uses hi, less its
+    // always-set low bit.
+    size_t word_index(const NullifierTag& tag) const {
+        return static_cast<size_t>(tag.hi >> 1) & mask_;
+    }
+
+    static uint64_t bit_mask(const NullifierTag& tag) {
+        uint32_t h = static_cast<uint32_t>(tag.hi >> 32);
+#if defined(__AVX2__)
+        const __m256i salts = _mm256_setr_epi32(0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+                                                0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31);
+        __m256i pos = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(h), salts), 26);
+        __m256i one = _mm256_set1_epi64x(1);
+        __m256i lo = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(pos)));
+        __m256i hi = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(pos, 1)));
+        __m256i both = _mm256_or_si256(lo, hi);
+        __m128i half = _mm_or_si128(_mm256_castsi256_si128(both), _mm256_extracti128_si256(both, 1));
+        return static_cast<uint64_t>(_mm_extract_epi64(half, 0) | _mm_extract_epi64(half, 1));
+#elif defined(__ARM_NEON)
+        static const uint32_t salt_words[8] = { 0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+                                                0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31 };
+        uint32x4_t hv = vdupq_n_u32(h);
+        uint32x4_t p0 = vshrq_n_u32(vmulq_u32(hv, vld1q_u32(salt_words)), 26);
+        uint32x4_t p1 = vshrq_n_u32(vmulq_u32(hv, vld1q_u32(salt_words + 4)), 26);
+        uint64x2_t one = vdupq_n_u64(1);
+        uint64x2_t acc = vshlq_u64(one, vreinterpretq_s64_u64(vmovl_u32(vget_low_u32(p0))));
+        acc = vorrq_u64(acc, vshlq_u64(one, vreinterpretq_s64_u64(vmovl_u32(vget_high_u32(p0)))));
+        acc = vorrq_u64(acc, vshlq_u64(one, vreinterpretq_s64_u64(vmovl_u32(vget_low_u32(p1)))));
+        acc = vorrq_u64(acc, vshlq_u64(one, vreinterpretq_s64_u64(vmovl_u32(vget_high_u32(p1)))));
+        return vgetq_lane_u64(acc, 0) | vgetq_lane_u64(acc, 1);
+#else
+        static const uint32_t salt_words[8] = { 0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+                                                0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31 };
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) {
+            bits |= uint64_t(1) << ((h * salt_words[i]) >> 26);
+        }
+        return bits;
+#endif
+    }
+
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+    size_t mask_;
+};
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef DNTAT_COMMON_CURVE_H
+#define DNTAT_COMMON_CURVE_H
+
+// Curve selection shared by all four protocols.
+//
+// mcl fixes the largest supported field at compile time (MCL_MAX_FP_BIT_SIZE)
+// and picks the concrete curve at runtime in initPairing(). G1/G2/GT/Fr are
+// the same C++ types for every curve that fits, so the protocol code is
+// written against them once; a curve-traits type carries what does differ
+// between curves: the mcl parameters, the encoding sizes and init().
+//
+// CMake's CURVE_MAX_BITS sets MCL_MAX_FP_BIT_SIZE: 256 covers BN254 only,
+// 384 adds BLS12-381 and 512 adds BN462.
+
+#ifndef MCL_MAX_FP_BIT_SIZE
+#define MCL_MAX_FP_BIT_SIZE 256
+#endif
+#include <mcl/bn.hpp>
+
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace mcl::bn;
+
+// Upper bounds on encoding sizes for this build. Stack buffers that hold
+// serialized elements are sized with these; the exact length for the active
+// curve is whatever serialize() returns.
+enum {
+    MAX_FP_BYTES = (MCL_MAX_FP_BIT_SIZE + 7) / 8,
+    MAX_FR_BYTES = MAX_FP_BYTES,
+    MAX_G1_BYTES = MAX_FP_BYTES,
+    MAX_G2_BYTES = 2 * MAX_FP_BYTES
+};
+
+template<class Derived, int FpBits, size_t FrBytes, size_t FpBytes>
+struct CurveTraitsBase {
+    typedef mcl::bn::G1 G1;
+    typedef mcl::bn::G2 G2;
+    typedef mcl::bn::GT GT;
+    typedef mcl::bn::Fr Fr;
+
+    static const int fp_bits = FpBits;
+    static const size_t fr_bytes = FrBytes;
+    static const size_t g1_bytes = FpBytes;      // compressed
+    static const size_t g2_bytes = 2 * FpBytes;  // compressed
+
+    static bool available() {
+        return FpBits <= MCL_MAX_FP_BIT_SIZE;
+    }
+
+    static void init() {
+        if (!available()) {
+            throw std::runtime_error(std::string(Derived::name()) +
+                                     " needs a build with CURVE_MAX_BITS=" +
+                                     std::to_string(FpBits <= 384 ? 384 : 512));
+        }
+        initPairing(Derived::param());
+        // Subgroup membership is checked by the decoders, and only for
+        // points from untrusted senders (subgroup_check.h).
+        verifyOrderG1(false);
+        verifyOrderG2(false);
+    }
+};
+
+struct CurveBN254 : CurveTraitsBase<CurveBN254, 254, 32, 32> {
+    static const char* name() { return "BN254"; }
+    static const mcl::CurveParam& param() { return mcl::BN254; }
+};
+
+struct CurveBLS12_381 : CurveTraitsBase<CurveBLS12_381, 381, 32, 48> {
+    static const char* name() { return "BLS12-381"; }
+    static const mcl::CurveParam& param() { return mcl::BLS12_381; }
+};
+
+struct CurveBN462 : CurveTraitsBase<CurveBN462, 462, 58, 58> {
+    static const char* name() { return "BN462"; }
+    static const mcl::CurveParam& param() { return mcl::BN462; }
+};
+
+// Sets mcl up for the curve named "bn254", "bls12_381" or "bn462", with the
+// order-check policy above. Every binary goes through this (or Curve::init())
+// rather than calling initPairing() itself. Prints why and returns false for
+// an unknown name or a curve this build cannot hold.
+inline bool init_curve(const std::string& curve_name) {
+    try {
+        if (curve_name == "bn254") {
+            CurveBN254::init();
+        } else if (curve_name == "bls12_381") {
+            CurveBLS12_381::init();
+        } else if (curve_name == "bn462") {
+            CurveBN462::init();
+        } else {
+            std::cerr << "Unknown curve '" << curve_name
+                      << "' (expected bn254, bls12_381 or bn462)" << std::endl;
+            return false;
+        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Removes "--curve <name>" from argv, so the program's own argument parsing
+// never sees it, and returns the name; "bn254" when it is not given.
+inline std::string take_curve_arg(int& argc, char** argv) {
+    std::string curve_name = "bn254";
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--curve") {
+            curve_name = argv[i + 1];
+            for (int j = i; j + 2 <= argc; ++j) {
+                argv[j] = argv[j + 2];
+            }
+            argc -= 2;
+            break;
+        }
+    }
+    return curve_name;
+}
+
+// Headline numbers a benchmark reports for one curve.
+struct CurveBenchSummary {
+    double issuance_ms;
+    double redemption_ms;
+};
+
+template<class Curve, class Bench>
+CurveBenchSummary run_on_curve(const Bench& bench) {
+    Curve::init();
+    std::cout << "\nCurve: " << Curve::name()
+              << " (Fr " << Curve::fr_bytes << " B, G1 " << Curve::g1_bytes
+              << " B, G2 " << Curve::g2_bytes << " B)" << std::endl;
+    return bench.template run<Curve>();
+}
+
+// Runs bench.run<Curve>() for the curve named on the command line
+// ("bn254", "bls12_381", "bn462"), or for every curve this build supports
+// when given "all", followed by a side-by-side summary.
+template<class Bench>
+int run_curve_benchmark(const std::string& curve_name, const Bench& bench) {
+    try {
+        if (curve_name == "bn254") {
+            run_on_curve<CurveBN254>(bench);
+            return 0;
+        }
+        if (curve_name == "bls12_381") {
+            run_on_curve<CurveBLS12_381>(bench);
+            return 0;
+        }
+        if (curve_name == "bn462") {
+            run_on_curve<CurveBN462>(bench);
+            return 0;
+        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (curve_name != "all") {
+        std::cerr << "Unknown curve '" << curve_name
+                  << "' (expected bn254, bls12_381, bn462 or all)" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    std::vector<CurveBenchSummary> results;
+    if (CurveBN254::available()) {
+        names.push_back(CurveBN254::name());
+        results.push_back(run_on_curve<CurveBN254>(bench));
+    }
+    if (CurveBLS12_381::available()) {
+        names.push_back(CurveBLS12_381::name());
+        results.push_back(run_on_curve<CurveBLS12_381>(bench));
+    }
+    if (CurveBN462::available()) {
+        names.push_back(CurveBN462::name());
+        results.push_back(run_on_curve<CurveBN462>(bench));
+    }
+
+    std::cout << "\n=== Curve Comparison ===" << std::endl;
+    std::cout << std::left << std::setw(12) << "Curve"
+              << std::right << std::setw(16) << "Issuance (ms)"
+              << std::setw(18) << "Redemption (ms)"
+              << std::setw(18) << "Issuance (tok/s)"
+              << std::setw(20) << "Redemption (tok/s)" << std::endl;
+    for (size_t i = 0; i < results.size(); ++i) {
+        std::cout << std::left << std::setw(12) << names[i]
+                  << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(16) << results[i].issuance_ms
+                  << std::setw(18) << results[i].redemption_ms
+                  << std::setprecision(0)
+                  << std::setw(18) << 1000.0 / results[i].issuance_ms
+                  << std::setw(20) << 1000.0 / results[i].redemption_ms << std::endl;
+    }
+    return 0;
+}
+
+#endif
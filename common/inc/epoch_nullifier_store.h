@@ -0,0 +1,126 @@
+#ifndef DNTAT_COMMON_EPOCH_NULLIFIER_STORE_H
+#define DNTAT_COMMON_EPOCH_NULLIFIER_STORE_H
+
+#include "nullifier_store.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+// Spent-token set sharded by token epoch, for tokens that expire.
+//
+// A token of epoch e is redeemable while e is one of the `window` most recent
+// epochs up to current(). Each of those epochs has its own NullifierStore of
+// `per_epoch` capacity, kept in a ring indexed by e % window. advance()
+// replaces the shards of epochs that fell out of the window with empty ones;
+// a dropped shard is released with a single munmap once the last redemption
+// still holding it finishes. Memory stays at `window` shards however many
+// tokens have been redeemed, and the hot shards are the small recent ones.
+
+class EpochNullifierStore {
+public:
+    EpochNullifierStore(size_t per_epoch, uint32_t window, uint32_t current)
+        : per_epoch_(per_epoch), shards_(window), current_(current) {
+        if (window == 0) {
+            throw std::invalid_argument("EpochNullifierStore: empty window");
+        }
+        for (uint32_t e = oldest(current); ; ++e) {
+            shards_[e % window] = std::make_shared<Shard>(e, per_epoch);
+            if (e == current) {
+                break;
+            }
+        }
+    }
+
+    // true if tokens of `epoch` are currently redeemable.
+    bool accepts(uint32_t epoch) const {
+        uint32_t now = current_.load(std::memory_order_acquire);
+        return epoch <= now && epoch >= oldest(now);
+    }
+
+    // Records the tag under its epoch. Returns false if it was already spent
+    // or the epoch is outside the window.
+    bool insert(uint32_t epoch, const NullifierTag& tag) {
+        if (!accepts(epoch)) {
+            return false;
+        }
+        std::shared_ptr<Shard> shard = std::atomic_load(&shards_[epoch % shards_.size()]);
+        // Recheck: advance() may have recycled the slot since accepts().
+        if (!shard || shard->epoch != epoch) {
+            return false;
+        }
+        return shard->set.insert(tag);
+    }
+
+    bool contains(uint32_t epoch, const NullifierTag& tag) const {
+        if (!accepts(epoch)) {
+            return false;
+        }
+        std::shared_ptr<Shard> shard = std::atomic_load(&shards_[epoch % shards_.size()]);
+        return shard && shard->epoch == epoch && shard->set.contains(tag);
+    }
+
+    // Moves the window forward to end at `now`; epochs that leave it are
+    // dropped. Moving backwards is ignored.
+    void advance(uint32_t now) {
+        std::lock_guard<std::mutex> lock(advance_mutex_);
+        uint32_t prev = current_.load(std::memory_order_relaxed);
+        if (now <= prev) {
+            return;
+        }
+        uint32_t first_new = now - prev > shards_.size() ? oldest(now) : prev + 1;
+        // New shards go in before the window moves, so a token of a new epoch
+        // is never refused for want of one; a token of an epoch being dropped
+        // may be refused a moment before its epoch formally closes.
+        for (uint32_t e = first_new; ; ++e) {
+            std::atomic_store(&shards_[e % shards_.size()], std::make_shared<Shard>(e, per_epoch_));
+            if (e == now) {
+                break;
+            }
+        }
+        current_.store(now, std::memory_order_release);
+    }
+
+    uint32_t current() const {
+        return current_.load(std::memory_order_acquire);
+    }
+
+    uint32_t window() const {
+        return static_cast<uint32_t>(shards_.size());
+    }
+
+    // Address space held by the live shards.
+    size_t bytes() const {
+        size_t total = 0;
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            std::shared_ptr<Shard> shard = std::atomic_load(&shards_[i]);
+            if (shard) {
+                total += shard->set.bytes();
+            }
+        }
+        return total;
+    }
+
+private:
+    struct Shard {
+        Shard(uint32_t e, size_t capacity) : epoch(e), set(capacity) {}
+        uint32_t epoch;
+        NullifierStore set;
+    };
+
+    uint32_t oldest(uint32_t now) const {
+        uint32_t span = static_cast<uint32_t>(shards_.size()) - 1;
+        return now > span ? now - span : 0;
+    }
+
+    size_t per_epoch_;
+    std::vector<std::shared_ptr<Shard> > shards_;
+    std::atomic<uint32_t> current_;
+    std::mutex advance_mutex_;
+};
+
+#endif
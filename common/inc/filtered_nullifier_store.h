@@ -0,0 +1,191 @@
+#ifndef DNTAT_COMMON_FILTERED_NULLIFIER_STORE_H
+#define DNTAT_COMMON_FILTERED_NULLIFIER_STORE_H
+
+#include "bloom_filter.h"
+#include "nullifier_store.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// NullifierStore with a BlockedBloomFilter in front, sized for the tokens
+// expected in one epoch.
+//
+// A tag the filter has never seen is fresh: insert() accepts it without
+// touching the table and queues it on the calling thread's stripe. A
+// background thread moves queued tags into the table in batches, with the
+// slots prefetched; a stripe that gets far ahead of it is drained by its own
+// thread. Only a filter hit (a spent token or a false positive) goes to the
+// table, after waiting for any fast-path insert still in flight to queue its
+// tag and then draining every stripe, so the table is exact when asked.
+
+class FilteredNullifierStore {
+public:
+    explicit FilteredNullifierStore(size_t expected_tokens, unsigned bits_per_tag = 16)
+        : filter_(expected_tokens, bits_per_tag), table_(expected_tokens), stop_(false) {
+        drainer_ = std::thread(&FilteredNullifierStore::drain_loop, this);
+    }
+
+    ~FilteredNullifierStore() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stop_ = true;
+        }
+        wake_.notify_one();
+        drainer_.join();
+    }
+
+    FilteredNullifierStore(const FilteredNullifierStore&) = delete;
+    FilteredNullifierStore& operator=(const FilteredNullifierStore&) = delete;
+
+    // true if the tag was fresh, false if it was already spent.
+    bool insert(const NullifierTag& tag) {
+        Stripe& stripe = stripes_[stripe_index()];
+        stripe.active.fetch_add(1);
+        if (filter_.test_and_set(tag)) {
+            stripe.active.fetch_sub(1, std::memory_order_release);
+            stripe.slow.fetch_add(1, std::memory_order_relaxed);
+            quiesce();
+            return table_.insert(tag);
+        }
+        size_t queued;
+        {
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            stripe.pending.push_back(tag);
+            queued = stripe.pending.size();
+            if (queued >= kBacklog) {
+                drain_locked(stripe);
+            }
+        }
+        stripe.active.fetch_sub(1, std::memory_order_release);
+        if (queued == kBatch) {
+            wake_.notify_one();
+        }
+        return true;
+    }
+
+    bool contains(const NullifierTag& tag) {
+        if (!filter_.may_contain(tag)) {
+            return false;
+        }
+        quiesce();
+        return table_.contains(tag);
+    }
+
+    // Writes every queued tag to the table.
+    void flush() {
+        quiesce();
+    }
+
+    // Inserts that had to consult the table.
+    size_t filter_hits() const {
+        size_t total = 0;
+        for (size_t i = 0; i < kStripes; ++i) {
+            total += stripes_[i].slow.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    const BlockedBloomFilter& filter() const {
+        return filter_;
+    }
+
+    size_t bytes() const {
+        return filter_.bytes() + table_.bytes();
+    }
+
+private:
+    enum { kStripes = 64, kBatch = 256, kBacklog = 16 * kBatch };
+
+    struct Stripe {
+        Stripe() : active(0), slow(0) {
+            pending.reserve(kBatch);
+        }
+        // Fast-path inserts between the filter update and the queued tag.
+        std::atomic<uint32_t> active;
+        std::atomic<size_t> slow;
+        std::mutex mutex;
+        std::vector<NullifierTag> pending;
+        char pad[64];
+    };
+
+    // Threads take stripes round robin, so up to kStripes threads never
+    // share one.
+    static size_t stripe_index() {
+        static std::atomic<size_t> next(0);
+        static thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % kStripes;
+        return index;
+    }
+
+    void insert_batch(const std::vector<NullifierTag>& batch) {
+        for (size_t i = 0; i < batch.size(); ++i) {
+            table_.prefetch(batch[i]);
+        }
+        for (size_t i = 0; i < batch.size(); ++i) {
+            table_.insert(batch[i]);
+        }
+    }
+
+    void drain_locked(Stripe& stripe) {
+        insert_batch(stripe.pending);
+        stripe.pending.clear();
+    }
+
+    // Takes each stripe's queue under its lock and writes it to the table
+    // outside it, so fast-path inserts only wait for the swap. drain_mutex_
+    // is held throughout so quiesce() never runs ahead of a batch in flight.
+    void drain_loop() {
+        std::vector<NullifierTag> batch;
+        batch.reserve(kBatch);
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(wake_mutex_);
+                if (stop_) {
+                    return;
+                }
+                wake_.wait_for(lock, std::chrono::milliseconds(1));
+            }
+            std::lock_guard<std::mutex> drain(drain_mutex_);
+            for (size_t i = 0; i < kStripes; ++i) {
+                {
+                    std::lock_guard<std::mutex> lock(stripes_[i].mutex);
+                    batch.swap(stripes_[i].pending);
+                }
+                insert_batch(batch);
+                batch.clear();
+            }
+        }
+    }
+
+    // A thread that found all of a tag's filter bits set waits until the
+    // fast path that set them has queued the tag, then empties every queue.
+    void quiesce() {
+        for (size_t i = 0; i < kStripes; ++i) {
+            while (stripes_[i].active.load() != 0) {
+                std::this_thread::yield();
+            }
+        }
+        std::lock_guard<std::mutex> drain(drain_mutex_);
+        for (size_t i = 0; i < kStripes; ++i) {
+            std::lock_guard<std::mutex> lock(stripes_[i].mutex);
+            drain_locked(stripes_[i]);
+        }
+    }
+
+    BlockedBloomFilter filter_;
+    NullifierStore table_;
+    Stripe stripes_[kStripes];
+
+    std::mutex drain_mutex_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool stop_;
+    std::thread drainer_;
+};
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef DNTAT_COMMON_FIXED_BASE_H
+#define DNTAT_COMMON_FIXED_BASE_H
+
+#include "curve.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// Precomputed multiples of one base point, for bases that are fixed for the
+// lifetime of a key or parameter set (generators, issuer-derived points).
+//
+// The scalar is split into 4-bit windows; window i holds j * 16^i * base for
+// j = 0..15, so mul() is one table read and one addition per window and no
+// doublings.
+//
+// mul() takes secret scalars. Each read scans the whole window and keeps
+// the wanted entry with a mask, so the memory access pattern does not
+// depend on the scalar. The sum does not use mcl's addition, which takes
+// shortcuts for the point at infinity and for doubling: it uses the
+// complete projective formula for a = 0 curves (Renes, Costello and
+// Batina, eprint 2015/1060, algorithm 7), the same field operations for
+// every pair of points. It starts from a fixed offset point, hashed to the
+// curve, so the total is never the point at infinity; the coordinates are
+// scaled by a random factor before the one inversion that leaves the
+// projective form, and the offset is subtracted at the end.
+//
+// Build tables after initPairing(); the window count follows Fr's size for
+// the active curve. attach() uses rows built earlier and stored elsewhere
+// (a mapped precomputation file) instead of building them. The base must
+// not be the point at infinity: every multiple of it would be, so a key or
+// parameter that zeroed it out would go unnoticed. init() and attach()
+// throw std::invalid_argument if it is.
+template<class G>
+class FixedBaseTable {
+    typedef typename G::Fp F;  // Fp for G1, Fp2 for G2
+
+public:
+    FixedBaseTable() : rows_(0), windows_(0) {}
+
+    explicit FixedBaseTable(const G& base) : rows_(0), windows_(0) {
+        init(base);
+    }
+
+    void init(const G& base) {
+        if (base.isZero()) {
+            throw std::invalid_argument("FixedBaseTable: base is the point at infinity");
+        }
+        rows_ = 0;
+        windows_ = Fr::getByteSize() * 2;
+        table_.resize(windows_ * kWindowSize);
+
+        G row_base = base;
+        for (size_t i = 0; i < windows_; ++i) {
+            G* row = &table_[i * kWindowSize];
+            row[0].clear();
+            row[1] = row_base;
+            for (size_t j = 2; j < kWindowSize; ++j) {
+                G::add(row[j], row[j - 1], row_base);
+            }
+            for (size_t j = 1; j < kWindowSize; ++j) {
+                row[j].normalize();
+            }
+            // next row_base = 16 * row_base
+            G::add(row_base, row[kWindowSize - 1], row_base);
+        }
+        init_curve();
+    }
+
+    // Uses `windows` rows of 16 entries at `rows`, laid out as init() lays
+    // them out; they must outlive the table.
+    void attach(const G* rows, size_t windows) {
+        if (windows != 0 && rows[1].isZero()) {
+            throw std::invalid_argument("FixedBaseTable: base is the point at infinity");
+        }
+        table_.clear();
+        rows_ = rows;
+        windows_ = windows;
+        init_curve();
+    }
+
+    bool empty() const {
+        return windows_ == 0;
+    }
+
+    const G* rows() const {
+        return rows_ ? rows_ : table_.data();
+    }
+
+    size_t windows() const {
+        return windows_;
+    }
+
+    // Entries per window.
+    static size_t window_size() {
+        return kWindowSize;
+    }
+
+    // z = k * base
+    void mul(G& z, const Fr& k) const {
+        unsigned char bytes[MAX_FR_BYTES];
+        std::memset(bytes, 0, sizeof(bytes));
+        k.serialize(bytes, sizeof(bytes));  // little-endian
+
+        const G* table = rows();
+        Point acc, entry;
+        acc.X = offset_.x;
+        acc.Y = offset_.y;
+        acc.Z = one_;
+        for (size_t i = 0; i < windows_; ++i) {
+            unsigned nibble = (bytes[i / 2] >> ((i & 1) * 4)) & 0xf;
+            select(entry, table + i * kWindowSize, nibble);
+            add(acc, acc, entry);
+        }
+
+        // 1 / Z as lambda / (lambda * Z), so the inversion, which need not
+        // run in constant time, only sees a random value.
+        F lambda, zinv;
+        do {
+            lambda.setByCSPRNG();
+        } while (lambda.isZero());
+        F::mul(zinv, acc.Z, lambda);
+        F::inv(zinv, zinv);
+        zinv *= lambda;
+        F::mul(z.x, acc.X, zinv);
+        F::mul(z.y, acc.Y, zinv);
+        z.z = one_;
+        G::sub(z, z, offset_);
+    }
+
+private:
+    enum { kWindowBits = 4, kWindowSize = 1 << kWindowBits };
+
+    static_assert(sizeof(F) % sizeof(uint64_t) == 0, "coordinate must be a whole number of words");
+
+    // (X : Y : Z) with x = X / Z, y = Y / Z; (0 : 1 : 0) is the point at
+    // infinity.
+    struct Point {
+        F X, Y, Z;
+    };
+
+    // Curve constants for add(), from the table's own points.
+    void init_curve() {
+        one_ = F(1);
+        const G& P = rows()[1];  // the base point, normalized: z = 1
+        F x3;
+        F::mul(x3, P.x, P.x);
+        x3 *= P.x;
+        F::mul(b3_, P.y, P.y);
+        b3_ -= x3;  // b = y^2 - x^3
+        F b = b3_;
+        b3_ += b;
+        b3_ += b;
+
+        static const char tag[] = "FixedBaseTable offset";
+        hash_to_group(offset_, tag, sizeof(tag) - 1);
+        offset_.normalize();
+    }
+
+    static void hash_to_group(G1& P, const char* msg, size_t n) {
+        hashAndMapToG1(P, msg, n);
+    }
+
+    static void hash_to_group(G2& P, const char* msg, size_t n) {
+        hashAndMapToG2(P, msg, n);
+    }
+
+    // R = P + Q for any P, Q on y^2 = x^3 + b, R may alias either.
+    void add(Point& R, const Point& P, const Point& Q) const {
+        F t0, t1, t2, t3, t4, X3, Y3, Z3;
+        F::mul(t0, P.X, Q.X);
+        F::mul(t1, P.Y, Q.Y);
+        F::mul(t2, P.Z, Q.Z);
+        F::add(t3, P.X, P.Y);
+        F::add(t4, Q.X, Q.Y);
+        t3 *= t4;
+        F::add(t4, t0, t1);
+        t3 -= t4;
+        F::add(t4, P.Y, P.Z);
+        F::add(X3, Q.Y, Q.Z);
+        t4 *= X3;
+        F::add(X3, t1, t2);
+        t4 -= X3;
+        F::add(X3, P.X, P.Z);
+        F::add(Y3, Q.X, Q.Z);
+        X3 *= Y3;
+        F::add(Y3, t0, t2);
+        F::sub(Y3, X3, Y3);
+        F::add(X3, t0, t0);
+        t0 += X3;
+        t2 *= b3_;
+        F::add(Z3, t1, t2);
+        t1 -= t2;
+        Y3 *= b3_;
+        F::mul(X3, t4, Y3);
+        F::mul(t2, t3, t1);
+        F::sub(X3, t2, X3);
+        Y3 *= t0;
+        t1 *= Z3;
+        Y3 += t1;
+        t0 *= t3;
+        Z3 *= t4;
+        Z3 += t0;
+        R.X = X3;
+        R.Y = Y3;
+        R.Z = Z3;
+    }
+
+    // out = row[idx] in projective form. Entries 1..15 are normalized, so
+    // their z is 1; idx == 0 gives the point at infinity.
+    void select(Point& out, const G* row, unsigned idx) const {
+        enum { kWords = sizeof(F) / sizeof(uint64_t) };
+        uint64_t x[kWords] = { 0 };
+        uint64_t y[kWords] = { 0 };
+        uint64_t z[kWords] = { 0 };
+        for (unsigned j = 1; j < kWindowSize; ++j) {
+            uint64_t mask = equal_mask(j, idx);
+            take(x, row[j].x, mask);
+            take(y, row[j].y, mask);
+        }
+        uint64_t infinity = equal_mask(0, idx);
+        take(y, one_, infinity);
+        take(z, one_, ~infinity);
+        std::memcpy(&out.X, x, sizeof(F));
+        std::memcpy(&out.Y, y, sizeof(F));
+        std::memcpy(&out.Z, z, sizeof(F));
+    }
+
+    // All ones iff a == b.
+    static uint64_t equal_mask(uint64_t a, uint64_t b) {
+        uint64_t diff = a ^ b;
+        return ((diff | (0 - diff)) >> 63) - 1;
+    }
+
+    static void take(uint64_t* acc, const F& v, uint64_t mask) {
+        enum { kWords = sizeof(F) / sizeof(uint64_t) };
+        uint64_t words[kWords];
+        std::memcpy(words, &v, sizeof(F));
+        for (size_t w = 0; w < kWords; ++w) {
+            acc[w] |= words[w] & mask;
+        }
+    }
+
+    std::vector<G> table_;
+    const G* rows_;  // attached rows, or 0 for table_
+    size_t windows_;
+    F one_;
+    F b3_;      // 3 * b
+    G offset_;  // normalized
+};
+
+#endif
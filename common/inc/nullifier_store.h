@@ -0,0 +1,202 @@
+#ifndef DNTAT_COMMON_NULLIFIER_STORE_H
+#define DNTAT_COMMON_NULLIFIER_STORE_H
+
+#include "curve.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <sys/mman.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Spent-token set shared by all redemption threads.
+//
+// Each redeemed token is reduced to a 128-bit tag: a domain-separated hash of
+// the token component that is unique per token (DNTAT hbar, NTAT sigma,
+// U-Prove h, CHAC nonce). Tags live in an open-addressing table with linear
+// probing; a slot is claimed with one compare-and-swap on its first word, so
+// inserting threads never take a lock and only contend when they probe the
+// same slot. Capacity is fixed at construction; the table is one anonymous
+// mapping, so untouched slots cost no memory and destruction is one munmap.
+
+struct NullifierTag {
+    uint64_t lo;
+    uint64_t hi;
+};
+
+inline bool operator==(const NullifierTag& a, const NullifierTag& b) {
+    return a.lo == b.lo && a.hi == b.hi;
+}
+
+// Tag of an already serialized element under `domain`, e.g. a point taken
+// straight from a received message (WireView::raw). Both words are forced
+// odd so zero can mark empty slots.
+inline NullifierTag nullifier_tag_bytes(const char* domain, const unsigned char* element, size_t size) {
+    unsigned char buf[32 + MAX_G2_BYTES];
+    size_t n = std::strlen(domain);
+    if (n > 32) {
+        throw std::invalid_argument("nullifier_tag: domain too long");
+    }
+    if (size > MAX_G2_BYTES) {
+        throw std::invalid_argument("nullifier_tag: element too long");
+    }
+    std::memcpy(buf, domain, n);
+    std::memcpy(buf + n, element, size);
+    n += size;
+
+    Fr h;
+    h.setHashOf(buf, n);
+    unsigned char digest[MAX_FR_BYTES];
+    std::memset(digest, 0, sizeof(digest));
+    h.serialize(digest, sizeof(digest));
+
+    NullifierTag tag;
+    std::memcpy(&tag.lo, digest, 8);
+    std::memcpy(&tag.hi, digest + 8, 8);
+    tag.lo |= 1;
+    tag.hi |= 1;
+    return tag;
+}
+
+// Tag of one group or field element under `domain`.
+template<class T>
+NullifierTag nullifier_tag(const char* domain, const T& element) {
+    unsigned char buf[MAX_G2_BYTES];
+    size_t n = element.serialize(buf, sizeof(buf));
+    if (n == 0) {
+        throw std::invalid_argument("nullifier_tag: serialize failed");
+    }
+    return nullifier_tag_bytes(domain, buf, n);
+}
+
+class NullifierStore {
+public:
+    // Room for at least `capacity` tags at a load factor of at most 1/2.
+    explicit NullifierStore(size_t capacity) : size_(0) {
+        size_t slots = 16;
+        while (slots < 2 * capacity) {
+            slots <<= 1;
+        }
+        mask_ = slots - 1;
+        // Anonymous pages read as zero, which is the empty slot.
+        void* p = mmap(0, bytes(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        slots_ = static_cast<Slot*>(p);
+    }
+
+    ~NullifierStore() {
+        munmap(slots_, bytes());
+    }
+
+    NullifierStore(const NullifierStore&) = delete;
+    NullifierStore& operator=(const NullifierStore&) = delete;
+
+    // Records the tag. Returns true if it was not present (the token is
+    // fresh), false if it was already spent. Throws std::runtime_error if
+    // the table is full.
+    bool insert(const NullifierTag& tag) {
+        size_t idx = home(tag);
+        for (size_t probes = 0; probes <= mask_; ++probes, idx = (idx + 1) & mask_) {
+            Slot& slot = slots_[idx];
+            uint64_t lo = slot.lo.load(std::memory_order_acquire);
+            if (lo == 0) {
+                if (slot.lo.compare_exchange_strong(lo, tag.lo, std::memory_order_acq_rel)) {
+                    slot.hi.store(tag.hi, std::memory_order_release);
+                    size_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+                // Lost the race; lo now holds the winner's first word.
+            }
+            if (lo == tag.lo && wait_hi(slot) == tag.hi) {
+                return false;
+            }
+        }
+        throw std::runtime_error("NullifierStore: table full");
+    }
+
+    // Starts loading the tag's home slot, so a batch of inserts can overlap
+    // its cache misses.
+    void prefetch(const NullifierTag& tag) const {
+        __builtin_prefetch(&slots_[home(tag)], 1);
+    }
+
+    bool contains(const NullifierTag& tag) const {
+        size_t idx = home(tag);
+        for (size_t probes = 0; probes <= mask_; ++probes, idx = (idx + 1) & mask_) {
+            const Slot& slot = slots_[idx];
+            uint64_t lo = slot.lo.load(std::memory_order_acquire);
+            if (lo == 0) {
+                return false;
+            }
+            if (lo == tag.lo && wait_hi(slot) == tag.hi) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t size() const {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    size_t slot_count() const {
+        return mask_ + 1;
+    }
+
+    // Address space reserved for the table.
+    size_t bytes() const {
+        return (mask_ + 1) * sizeof(Slot);
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> lo;
+        std::atomic<uint64_t> hi;
+    };
+
+    // Tags are odd, so the low bit would leave every other slot without
+    // a tag homed there.
+    size_t home(const NullifierTag& tag) const {
+        return static_cast<size_t>(tag.lo >> 1) & mask_;
+    }
+
+    // A slot whose first word is set but whose second is not yet published
+    // is mid-insert; the window is two stores wide. If the inserting thread
+    // was preempted inside it, give up the core after a short spin rather
+    // than burn the rest of the quantum.
+    static uint64_t wait_hi(const Slot& slot) {
+        uint64_t hi;
+        for (int spins = 0; (hi = slot.hi.load(std::memory_order_acquire)) == 0; ++spins) {
+            if (spins < kSpin) {
+                cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        return hi;
+    }
+
+    static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    }
+
+    enum { kSpin = 64 };
+
+    Slot* slots_;
+    size_t mask_;
+    std::atomic<size_t> size_;
+};
+
+#endif
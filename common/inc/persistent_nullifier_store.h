@@ -0,0 +1,422 @@
+#ifndef DNTAT_COMMON_PERSISTENT_NULLIFIER_STORE_H
+#define DNTAT_COMMON_PERSISTENT_NULLIFIER_STORE_H
+
+#include "nullifier_store.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Spent-token set that survives restarts (POSIX).
+//
+// <dir>/nullifiers.tbl is an open-addressing table mapped with mmap: a page
+// of header followed by one 64-bit slot per entry. A slot holds the tag's
+// `lo` word and is chosen from its `hi` word (less the always-set low bit),
+// so a slot is claimed with one 8-byte compare-and-swap that a crash cannot
+// tear; with both words hash-derived, an honest token is wrongly refused
+// with probability about size() / 2^63.
+//
+// <dir>/nullifiers.log and <dir>/nullifiers.log.1 are append-only logs of
+// full tags, one of them active at a time. A background thread writes the
+// records queued since its last write to the active log and fdatasync()s
+// them in one go (group commit); insert() returns once its record is
+// durable. checkpoint() makes the other log active, msyncs the table and
+// truncates the log it switched away from, so a restart maps the table
+// and replays only what was logged since the last checkpoint. Every record
+// in that log was claimed in the table before the switch, so the msync
+// covers it; the msync runs without the store's lock, and inserts keep
+// being logged and acknowledged meanwhile. Replay is idempotent, so a
+// crash at any point of a checkpoint only means replaying records the
+// table already holds.
+//
+// A tag whose slot was claimed but whose record was not yet durable at a
+// crash may come back as spent without its redemption ever having been
+// acknowledged; the server errs towards refusing a token, never towards
+// accepting one twice. An I/O error in the flusher thread terminates the
+// process rather than let redemptions be acknowledged without a log.
+
+class PersistentNullifierStore {
+public:
+    // Opens or creates the store in `dir`. `capacity` sizes a new table (load
+    // factor at most 1/2) and is ignored for an existing one. The log is
+    // checkpointed automatically once it exceeds `checkpoint_bytes`.
+    PersistentNullifierStore(const std::string& dir, size_t capacity,
+                             size_t checkpoint_bytes = 256u << 20)
+        : dir_(dir), table_fd_(-1), map_(0), map_bytes_(0), slots_(0), mask_(0), size_(0),
+          active_(0), checkpoint_bytes_(checkpoint_bytes), queued_seq_(0), durable_seq_(0),
+          stop_(false), checkpoint_wanted_(false), replayed_(0) {
+        for (int i = 0; i < 2; ++i) {
+            log_fd_[i] = -1;
+            log_bytes_[i] = 0;
+        }
+        open_table(dir + "/nullifiers.tbl", capacity);
+        open_log(0, dir + "/nullifiers.log");
+        open_log(1, dir + "/nullifiers.log.1");
+        sync_dir();  // the files may be new
+        replay_log(0);
+        replay_log(1);
+        flusher_ = std::thread(&PersistentNullifierStore::flush_loop, this);
+        checkpointer_ = std::thread(&PersistentNullifierStore::checkpoint_loop, this);
+    }
+
+    ~PersistentNullifierStore() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        queued_cv_.notify_all();
+        checkpoint_cv_.notify_all();
+        flusher_.join();
+        checkpointer_.join();
+        if (log_bytes_[0] != 0 || log_bytes_[1] != 0) {
+            sync_table();
+            truncate_log(0);
+            truncate_log(1);
+        }
+        munmap(map_, map_bytes_);
+        close(log_fd_[0]);
+        close(log_fd_[1]);
+        close(table_fd_);
+    }
+
+    PersistentNullifierStore(const PersistentNullifierStore&) = delete;
+    PersistentNullifierStore& operator=(const PersistentNullifierStore&) = delete;
+
+    // Claims the tag's slot and queues its log record. Returns false if the
+    // tag was already spent; otherwise sets *ticket for wait_durable().
+    bool insert_nowait(const NullifierTag& tag, uint64_t* ticket) {
+        if (!claim(tag)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_.push_back(tag);
+        *ticket = ++queued_seq_;
+        queued_cv_.notify_one();
+        return true;
+    }
+
+    // Blocks until every record up to `ticket` is on disk.
+    void wait_durable(uint64_t ticket) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        durable_cv_.wait(lock, [&]() { return durable_seq_ >= ticket; });
+    }
+
+    // true if the tag was fresh and its record is now durable, false if it
+    // was already spent.
+    bool insert(const NullifierTag& tag) {
+        uint64_t ticket;
+        if (!insert_nowait(tag, &ticket)) {
+            return false;
+        }
+        wait_durable(ticket);
+        return true;
+    }
+
+    bool contains(const NullifierTag& tag) const {
+        size_t idx = static_cast<size_t>(tag.hi >> 1) & mask_;
+        for (size_t probes = 0; probes <= mask_; ++probes, idx = (idx + 1) & mask_) {
+            uint64_t v = __atomic_load_n(&slots_[idx], __ATOMIC_ACQUIRE);
+            if (v == 0) {
+                return false;
+            }
+            if (v == tag.lo) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Makes every tag inserted before the call durable in the table itself
+    // and drops the log records that held them. Inserts go on meanwhile.
+    void checkpoint() {
+        std::lock_guard<std::mutex> serial(checkpoint_mutex_);
+        int sealed;
+        uint64_t sealed_seq;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            sealed = active_;
+            active_ ^= 1;
+            sealed_seq = queued_seq_;
+        }
+        // Records up to sealed_seq were claimed before the switch, so the
+        // table in memory already holds them; some may still be on their
+        // way to the sealed log.
+        sync_table();
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            durable_cv_.wait(lock, [&]() { return durable_seq_ >= sealed_seq; });
+        }
+        truncate_log(sealed);
+    }
+
+    // Slots claimed by this process, replay included; the table does not
+    // keep a count.
+    size_t size() const {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    size_t slot_count() const {
+        return mask_ + 1;
+    }
+
+    // Log records applied when the store was opened.
+    size_t replayed() const {
+        return replayed_;
+    }
+
+private:
+    enum { kHeaderBytes = 4096 };
+
+    struct Header {
+        char magic[8];
+        uint64_t slot_count;
+    };
+
+    static int sync_data(int fd) {
+#ifdef __APPLE__
+        return fsync(fd);
+#else
+        return fdatasync(fd);
+#endif
+    }
+
+    static void fail(const std::string& what) {
+        throw std::runtime_error("PersistentNullifierStore: " + what + ": " + std::strerror(errno));
+    }
+
+    void open_table(const std::string& path, size_t capacity) {
+        table_fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (table_fd_ < 0) {
+            fail("open " + path);
+        }
+        struct stat st;
+        if (fstat(table_fd_, &st) != 0) {
+            fail("stat " + path);
+        }
+
+        size_t slot_count;
+        bool fresh = st.st_size == 0;
+        if (fresh) {
+            slot_count = 16;
+            while (slot_count < 2 * capacity) {
+                slot_count <<= 1;
+            }
+            map_bytes_ = kHeaderBytes + slot_count * sizeof(uint64_t);
+            if (ftruncate(table_fd_, map_bytes_) != 0) {
+                fail("size " + path);
+            }
+        } else {
+            map_bytes_ = st.st_size;
+        }
+
+        map_ = mmap(0, map_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, table_fd_, 0);
+        if (map_ == MAP_FAILED) {
+            fail("mmap " + path);
+        }
+        Header* header = static_cast<Header*>(map_);
+        if (fresh) {
+            std::memcpy(header->magic, "NULLTBL2", 8);
+            header->slot_count = slot_count;
+            if (msync(map_, kHeaderBytes, MS_SYNC) != 0) {
+                fail("msync " + path);
+            }
+        } else if (std::memcmp(header->magic, "NULLTBL2", 8) != 0 ||
+                   kHeaderBytes + header->slot_count * sizeof(uint64_t) != map_bytes_) {
+            throw std::runtime_error("PersistentNullifierStore: " + path + " is not a nullifier table");
+        }
+        slot_count = header->slot_count;
+        mask_ = slot_count - 1;
+        slots_ = reinterpret_cast<uint64_t*>(static_cast<char*>(map_) + kHeaderBytes);
+    }
+
+    void open_log(int i, const std::string& path) {
+        log_fd_[i] = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+        if (log_fd_[i] < 0) {
+            fail("open " + path);
+        }
+    }
+
+    // Makes the directory entries and sizes of the files durable.
+    void sync_dir() {
+        int fd = open(dir_.c_str(), O_RDONLY);
+        if (fd < 0) {
+            fail("open " + dir_);
+        }
+        if (fsync(fd) != 0) {
+            int err = errno;
+            close(fd);
+            errno = err;
+            fail("fsync " + dir_);
+        }
+        close(fd);
+    }
+
+    // Re-applies every complete record. Zero records (a crash while the file
+    // was being extended) are skipped and a partial trailing record is cut
+    // off, since the log is opened O_APPEND and records written after it
+    // would otherwise be misaligned on the next replay.
+    void replay_log(int log) {
+        std::vector<NullifierTag> buf(4096);
+        off_t offset = 0;
+        for (;;) {
+            ssize_t n = pread(log_fd_[log], buf.data(), buf.size() * sizeof(NullifierTag), offset);
+            if (n < 0) {
+                fail("read log");
+            }
+            size_t records = static_cast<size_t>(n) / sizeof(NullifierTag);
+            for (size_t i = 0; i < records; ++i) {
+                if (buf[i].lo != 0) {
+                    claim(buf[i]);
+                    ++replayed_;
+                }
+            }
+            offset += records * sizeof(NullifierTag);
+            if (records < buf.size()) {
+                break;
+            }
+        }
+        struct stat st;
+        if (fstat(log_fd_[log], &st) != 0) {
+            fail("stat log");
+        }
+        if (st.st_size != offset) {
+            if (ftruncate(log_fd_[log], offset) != 0 || sync_data(log_fd_[log]) != 0) {
+                fail("truncate torn log record");
+            }
+        }
+        log_bytes_[log] = offset;
+    }
+
+    bool claim(const NullifierTag& tag) {
+        size_t idx = static_cast<size_t>(tag.hi >> 1) & mask_;
+        for (size_t probes = 0; probes <= mask_; ++probes, idx = (idx + 1) & mask_) {
+            uint64_t v = __atomic_load_n(&slots_[idx], __ATOMIC_ACQUIRE);
+            if (v == 0) {
+                if (__atomic_compare_exchange_n(&slots_[idx], &v, tag.lo, false,
+                                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                    size_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            if (v == tag.lo) {
+                return false;
+            }
+        }
+        throw std::runtime_error("PersistentNullifierStore: table full");
+    }
+
+    void flush_loop() {
+        std::vector<NullifierTag> batch;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            queued_cv_.wait(lock, [&]() { return stop_ || !queued_.empty(); });
+            if (queued_.empty()) {
+                return;  // stop_ with nothing left to write
+            }
+            batch.swap(queued_);
+            uint64_t batch_seq = queued_seq_;
+            int log = active_;
+            lock.unlock();
+
+            const char* p = reinterpret_cast<const char*>(batch.data());
+            size_t left = batch.size() * sizeof(NullifierTag);
+            while (left > 0) {
+                ssize_t n = write(log_fd_[log], p, left);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    fail("write log");
+                }
+                p += n;
+                left -= n;
+            }
+            if (sync_data(log_fd_[log]) != 0) {
+                fail("fdatasync log");
+            }
+
+            lock.lock();
+            log_bytes_[log] += batch.size() * sizeof(NullifierTag);
+            batch.clear();
+            durable_seq_ = batch_seq;
+            durable_cv_.notify_all();
+            if (log_bytes_[active_] >= checkpoint_bytes_ && !checkpoint_wanted_) {
+                checkpoint_wanted_ = true;
+                checkpoint_cv_.notify_one();
+            }
+        }
+    }
+
+    // Runs the automatic checkpoints, off the flusher so logging goes on.
+    void checkpoint_loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            checkpoint_cv_.wait(lock, [&]() { return stop_ || checkpoint_wanted_; });
+            if (stop_) {
+                return;  // the destructor checkpoints what is left
+            }
+            lock.unlock();
+            checkpoint();
+            lock.lock();
+            checkpoint_wanted_ = false;
+        }
+    }
+
+    void sync_table() {
+        if (msync(map_, map_bytes_, MS_SYNC) != 0) {
+            fail("msync table");
+        }
+    }
+
+    // Empties a log no batch is being written to, once the table holds
+    // every record in it on disk.
+    void truncate_log(int log) {
+        if (ftruncate(log_fd_[log], 0) != 0 || sync_data(log_fd_[log]) != 0) {
+            fail("truncate log");
+        }
+        sync_dir();
+        std::lock_guard<std::mutex> lock(mutex_);
+        log_bytes_[log] = 0;
+    }
+
+    const std::string dir_;
+    int table_fd_;
+    int log_fd_[2];
+    void* map_;
+    size_t map_bytes_;
+    uint64_t* slots_;
+    size_t mask_;
+    std::atomic<size_t> size_;
+
+    std::mutex mutex_;
+    std::condition_variable queued_cv_;
+    std::condition_variable durable_cv_;
+    std::condition_variable checkpoint_cv_;
+    std::vector<NullifierTag> queued_;
+    size_t log_bytes_[2];
+    int active_;  // log the flusher appends to
+    size_t checkpoint_bytes_;
+    uint64_t queued_seq_;
+    uint64_t durable_seq_;
+    bool stop_;
+    bool checkpoint_wanted_;
+    std::mutex checkpoint_mutex_;  // one checkpoint at a time
+    std::thread flusher_;
+    std::thread checkpointer_;
+    size_t replayed_;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef DNTAT_COMMON_RCU_H
+#define DNTAT_COMMON_RCU_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// A pointer that readers follow without locks and that a writer replaces
+// while readers are still using the old target (read-copy-update).
+//
+// Reclamation is epoch-based, with two epochs. A reader increments the
+// current epoch's counter, checks that the epoch did not move meanwhile,
+// then loads the pointer; releasing the guard decrements the counter. The
+// counters are sharded by thread and padded to a cache line each, so
+// readers on different cores do not write to the same line. A writer swaps
+// the pointer, advances the epoch and waits for the previous epoch's
+// counters to drain; every reader that could have loaded the old target
+// has then let go of it, and it is deleted. A reader never waits for a
+// writer: one that races an epoch change undoes its increment and retries.
+// Writers are serialized and pay the wait, so publish() belongs on a
+// background thread.
+//
+// A guard must not be held across publish() on the same thread, which
+// would wait for itself.
+
+template<class T>
+class RcuCell {
+public:
+    explicit RcuCell(std::unique_ptr<T> initial) : ptr_(initial.release()), epoch_(0) {
+        for (int e = 0; e < 2; ++e) {
+            for (int s = 0; s < kShards; ++s) {
+                readers_[e][s].n.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // No guard may be alive.
+    ~RcuCell() {
+        delete ptr_.load(std::memory_order_relaxed);
+    }
+
+    RcuCell(const RcuCell&) = delete;
+    RcuCell& operator=(const RcuCell&) = delete;
+
+    // Keeps the target it was created with alive until destroyed.
+    class ReadGuard {
+    public:
+        ReadGuard(ReadGuard&& other) : ptr_(other.ptr_), counter_(other.counter_) {
+            other.counter_ = 0;
+        }
+
+        ~ReadGuard() {
+            if (counter_) {
+                counter_->fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        const T* get() const {
+            return ptr_;
+        }
+
+        const T* operator->() const {
+            return ptr_;
+        }
+
+        const T& operator*() const {
+            return *ptr_;
+        }
+
+    private:
+        friend class RcuCell;
+
+        ReadGuard(const T* ptr, std::atomic<long>* counter) : ptr_(ptr), counter_(counter) {}
+
+        const T* ptr_;
+        std::atomic<long>* counter_;
+    };
+
+    ReadGuard read() const {
+        const unsigned shard = reader_shard();
+        for (;;) {
+            unsigned e = epoch_.load(std::memory_order_seq_cst);
+            std::atomic<long>& counter = readers_[e & 1][shard].n;
+            counter.fetch_add(1, std::memory_order_seq_cst);
+            if (epoch_.load(std::memory_order_seq_cst) == e) {
+                return ReadGuard(ptr_.load(std::memory_order_seq_cst), &counter);
+            }
+            counter.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    // Makes `next` the target and deletes the previous one once no reader
+    // holds it; returns after that.
+    void publish(std::unique_ptr<T> next) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        T* old = ptr_.exchange(next.release(), std::memory_order_seq_cst);
+        unsigned e = epoch_.load(std::memory_order_relaxed);
+        epoch_.store(e + 1, std::memory_order_seq_cst);
+        for (int s = 0; s < kShards; ++s) {
+            while (readers_[e & 1][s].n.load(std::memory_order_acquire) != 0) {
+                std::this_thread::yield();
+            }
+        }
+        delete old;
+    }
+
+private:
+    enum { kShards = 16, kCacheLine = 64 };
+
+    struct Counter {
+        std::atomic<long> n;
+        char pad[kCacheLine - sizeof(std::atomic<long>)];
+    };
+
+    // Threads take shards round robin on first use.
+    static unsigned reader_shard() {
+        static std::atomic<unsigned> next(0);
+        static thread_local unsigned shard = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+        return shard;
+    }
+
+    mutable Counter readers_[2][kShards];
+    std::atomic<T*> ptr_;
+    std::atomic<unsigned> epoch_;
+    std::mutex write_mutex_;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef DNTAT_COMMON_SCALAR_MUL_H
+#define DNTAT_COMMON_SCALAR_MUL_H
+
+#include "curve.h"
+
+#include <cstddef>
+
+// Scalar multiplication split by who may learn the scalar.
+//
+// mul_secret: keys, blinding factors, nonces and anything derived from them.
+//     Runs in constant time (mcl's mulCT) so the scalar does not leak through
+//     timing.
+//
+// mul_public / msm_public: challenges, responses, hash outputs, aggregation
+//     coefficients and anything else that is on the wire or recomputable by
+//     the verifier. Uses mcl's variable-time GLV + wNAF path, and for sums of
+//     several terms one multi-scalar multiplication instead of one
+//     multiplication per term.
+//
+// Verification and aggregation only see public scalars, so they use the
+// public variants; the one exception is DNTAT_PS::verify(), which is given the
+// user's sku.
+
+inline void mul_secret(G1& z, const G1& x, const Fr& k) {
+    G1::mulCT(z, x, k);
+}
+
+inline void mul_secret(G2& z, const G2& x, const Fr& k) {
+    G2::mulCT(z, x, k);
+}
+
+inline void mul_public(G1& z, const G1& x, const Fr& k) {
+    G1::mul(z, x, k);
+}
+
+inline void mul_public(G2& z, const G2& x, const Fr& k) {
+    G2::mul(z, x, k);
+}
+
+// z = sum_i k[i] * x[i]. mcl may normalize the points in place, which is why
+// they are taken by non-const pointer.
+inline void msm_public(G1& z, G1* x, const Fr* k, size_t n) {
+    G1::mulVec(z, x, k, n);
+}
+
+inline void msm_public(G2& z, G2* x, const Fr* k, size_t n) {
+    G2::mulVec(z, x, k, n);
+}
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef DNTAT_COMMON_SUBGROUP_CHECK_H
+#define DNTAT_COMMON_SUBGROUP_CHECK_H
+
+#include "curve.h"
+#include "scalar_mul.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+// Prime-order subgroup checks for points that come from outside.
+//
+// Decompressing a point puts it on the curve, not necessarily in the order-r
+// subgroup the protocols work in: the curve (G1) and its twist (G2) carry a
+// cofactor h, and a point with a component of order dividing h can break a
+// proof's soundness or leak key bits through a pairing. Whether a point
+// needs the check depends on where it came from (WireTrust in
+// wire_format.h), so curve init turns mcl's own check in deserialize() off
+// and the decoders call in here for untrusted points only.
+//
+// Cofactors of the supported curves, smallest prime factor l:
+//
+//   BN254       G1: 1       G2: l = 13
+//   BLS12-381   G1: l = 3   G2: l = 13
+//   BN462       G1: 1       G2: l = 997
+//
+// With cofactor 1 every point on the curve is in the subgroup and there is
+// nothing to check. Otherwise a single check is mcl's isValidOrder().
+//
+// SubgroupBatch checks many points at once. Q = sum_i c_i P_i with random
+// 64-bit c_i is in the subgroup whenever every P_i is; if some P_i is not, Q
+// still passes with probability at most 1/l. The test is repeated
+// ceil(64 / log2 l) times, so a batch costs that many multi-scalar
+// multiplications and single checks instead of one check per point. That
+// only wins with many points per round, so smaller batches are checked point
+// by point; a failed batch is rechecked point by point to find the culprits.
+
+enum { SUBGROUP_SECURITY_BITS = 64, SUBGROUP_MIN_POINTS_PER_ROUND = 8 };
+
+// Smallest prime factor of the cofactor on the active curve, 1 if there is
+// no cofactor. The curve is told apart by its field size.
+inline uint32_t subgroup_cofactor_prime(const G1*) {
+    switch (Fp::getByteSize()) {
+    case 32: return 1;   // BN254
+    case 48: return 3;   // BLS12-381
+    case 58: return 1;   // BN462
+    }
+    throw std::logic_error("subgroup_cofactor_prime: unknown curve");
+}
+
+inline uint32_t subgroup_cofactor_prime(const G2*) {
+    switch (Fp::getByteSize()) {
+    case 32: return 13;
+    case 48: return 13;
+    case 58: return 997;
+    }
+    throw std::logic_error("subgroup_cofactor_prime: unknown curve");
+}
+
+// Repetitions of the batched test for an error below 2^-SUBGROUP_SECURITY_BITS.
+inline int subgroup_batch_rounds(uint32_t l) {
+    if (l <= 1) {
+        return 0;
+    }
+    return static_cast<int>(std::ceil(SUBGROUP_SECURITY_BITS / std::log2(static_cast<double>(l))));
+}
+
+inline bool in_subgroup(const G1& P) {
+    return subgroup_cofactor_prime(&P) == 1 || P.isValidOrder();
+}
+
+inline bool in_subgroup(const G2& Q) {
+    return subgroup_cofactor_prime(&Q) == 1 || Q.isValidOrder();
+}
+
+class SubgroupBatch {
+public:
+    SubgroupBatch() : seeded_(false) {}
+
+    // Adds a point of message `owner`, a caller-chosen index reported by
+    // bad() if the point fails.
+    void add(const G1& P, size_t owner = 0) {
+        g1_.push_back(P);
+        g1_owner_.push_back(owner);
+    }
+
+    void add(const G2& Q, size_t owner = 0) {
+        g2_.push_back(Q);
+        g2_owner_.push_back(owner);
+    }
+
+    size_t size() const {
+        return g1_.size() + g2_.size();
+    }
+
+    // True if every point added since clear() is in its subgroup.
+    bool check() {
+        bad_.clear();
+        check_group(g1_, g1_owner_);
+        check_group(g2_, g2_owner_);
+        std::sort(bad_.begin(), bad_.end());
+        bad_.erase(std::unique(bad_.begin(), bad_.end()), bad_.end());
+        return bad_.empty();
+    }
+
+    // Owners of the failing points after check() returned false, ascending.
+    const std::vector<size_t>& bad() const {
+        return bad_;
+    }
+
+    void clear() {
+        g1_.clear();
+        g1_owner_.clear();
+        g2_.clear();
+        g2_owner_.clear();
+        bad_.clear();
+    }
+
+private:
+    template<class G>
+    void check_group(std::vector<G>& points, const std::vector<size_t>& owners) {
+        const uint32_t l = subgroup_cofactor_prime(static_cast<const G*>(0));
+        if (l == 1 || points.empty()) {
+            return;
+        }
+        const int rounds = subgroup_batch_rounds(l);
+        if (points.size() >= static_cast<size_t>(SUBGROUP_MIN_POINTS_PER_ROUND * rounds)) {
+            seed();
+            std::vector<Fr> c(points.size());
+            bool ok = true;
+            for (int k = 0; k < rounds && ok; ++k) {
+                for (Fr& ci : c) {
+                    uint64_t r = rng_();
+                    unsigned char le[8];
+                    for (int b = 0; b < 8; ++b) {
+                        le[b] = static_cast<unsigned char>(r >> (8 * b));
+                    }
+                    ci.setArrayMask(le, sizeof(le));
+                }
+                G Q;
+                msm_public(Q, points.data(), c.data(), points.size());
+                ok = Q.isValidOrder();
+            }
+            if (ok) {
+                return;
+            }
+        }
+        for (size_t i = 0; i < points.size(); ++i) {
+            if (!points[i].isValidOrder()) {
+                bad_.push_back(owners[i]);
+            }
+        }
+    }
+
+    // Coefficients must be unpredictable to whoever chose the points. Seeded
+    // on first use, so batches that never need a batched round cost nothing.
+    void seed() {
+        if (seeded_) {
+            return;
+        }
+        Fr s;
+        s.setByCSPRNG();
+        unsigned char bytes[MAX_FR_BYTES];
+        size_t n = s.serialize(bytes, sizeof(bytes));
+        std::seed_seq seq(bytes, bytes + n);
+        rng_.seed(seq);
+        seeded_ = true;
+    }
+
+    std::vector<G1> g1_;
+    std::vector<size_t> g1_owner_;
+    std::vector<G2> g2_;
+    std::vector<size_t> g2_owner_;
+    std::vector<size_t> bad_;
+    std::mt19937_64 rng_;
+    bool seeded_;
+};
+
+#endif
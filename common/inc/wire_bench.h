@@ -0,0 +1,195 @@
+#ifndef DNTAT_COMMON_WIRE_BENCH_H
+#define DNTAT_COMMON_WIRE_BENCH_H
+
+#include "wire_format.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Size and codec cost of protocol messages in the wire format, one row per
+// message: encoded bytes, full encode, full decode (wire_decode), and a
+// WireView check plus one decoded field -- what a verifier that needs a
+// single point pays. Each row also re-encodes the decoded message and flags
+// it if the bytes differ.
+//
+// wire_trust_report() gives the decode cost per message by sender trust
+// (WireTrust): trusted (no subgroup check), untrusted checked message by
+// message, and untrusted with one SubgroupBatch over a batch of messages.
+//
+// wire_subgroup_report() checks that a message carrying a point outside the
+// subgroup (off_subgroup_point()) is refused on every untrusted path.
+
+inline void wire_report_header() {
+    std::cout << std::left << std::setw(26) << "Message" << std::right << std::setw(7) << "Bytes"
+              << std::setw(14) << "Encode (us)" << std::setw(14) << "Decode (us)" << std::setw(16)
+              << "View+1 (us)" << std::endl;
+}
+
+template<class M>
+void wire_report(const M& m, int iterations = 2000) {
+    using namespace std::chrono;
+    std::vector<unsigned char> bytes = wire_encode(m);
+    std::vector<unsigned char> out(bytes.size());
+
+    auto start = steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        wire_encode(m, out.data(), out.size());
+    }
+    double encode_us = duration<double, std::micro>(steady_clock::now() - start).count() / iterations;
+
+    M decoded;
+    start = steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        wire_decode(bytes, decoded);
+    }
+    double decode_us = duration<double, std::micro>(steady_clock::now() - start).count() / iterations;
+
+    // Field 0, whatever its kind.
+    struct First {
+        Fr fr;
+        G1 g1;
+        G2 g2;
+        void get(const WireView<M>& view) {
+            if (wire_schema<M>().num_fixed == 0) {
+                return;
+            }
+            switch (wire_schema<M>().fixed[0]) {
+            case WIRE_FR: view.get(0, fr); break;
+            case WIRE_G1: view.get(0, g1); break;
+            default: view.get(0, g2); break;
+            }
+        }
+    } first;
+    start = steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        WireView<M> view(bytes.data(), bytes.size());
+        first.get(view);
+    }
+    double view_us = duration<double, std::micro>(steady_clock::now() - start).count() / iterations;
+
+    bool round_trip = wire_encode(decoded) == bytes;
+    std::cout << std::left << std::setw(26) << WireMessage<M>::name() << std::right << std::setw(7)
+              << bytes.size() << std::fixed << std::setprecision(2) << std::setw(14) << encode_us
+              << std::setw(14) << decode_us << std::setw(16) << view_us
+              << (round_trip ? "" : "  (round trip differs)") << std::endl;
+}
+
+inline void wire_trust_report_header(size_t batch) {
+    std::cout << std::left << std::setw(26) << "Message" << std::right << std::setw(14) << "Trusted (us)"
+              << std::setw(18) << "Untrusted (us)" << std::setw(14) << "Batched (us)"
+              << "   (per message, batches of " << batch << ")" << std::endl;
+}
+
+template<class M>
+void wire_trust_report(const M& m, size_t batch = 64, int iterations = 20) {
+    using namespace std::chrono;
+    std::vector<std::vector<unsigned char> > in(batch, wire_encode(m));
+    std::vector<M> out(batch);
+    const double per = 1.0 / (static_cast<double>(batch) * iterations);
+
+    auto start = steady_clock::now();
+    for (int k = 0; k < iterations; ++k) {
+        for (size_t i = 0; i < batch; ++i) {
+            wire_decode(in[i], out[i], WIRE_TRUSTED);
+        }
+    }
+    double trusted_us = duration<double, std::micro>(steady_clock::now() - start).count() * per;
+
+    start = steady_clock::now();
+    for (int k = 0; k < iterations; ++k) {
+        for (size_t i = 0; i < batch; ++i) {
+            wire_decode(in[i], out[i], WIRE_UNTRUSTED);
+        }
+    }
+    double untrusted_us = duration<double, std::micro>(steady_clock::now() - start).count() * per;
+
+    std::vector<char> ok;
+    start = steady_clock::now();
+    for (int k = 0; k < iterations; ++k) {
+        wire_decode_batch(in, out, ok);
+    }
+    double batched_us = duration<double, std::micro>(steady_clock::now() - start).count() * per;
+
+    bool all_ok = std::find(ok.begin(), ok.end(), 0) == ok.end();
+    std::cout << std::left << std::setw(26) << WireMessage<M>::name() << std::right << std::fixed
+              << std::setprecision(2) << std::setw(14) << trusted_us << std::setw(18) << untrusted_us
+              << std::setw(14) << batched_us << (all_ok ? "" : "  (valid message rejected)") << std::endl;
+}
+
+// A point on the curve (G1) or its twist (G2) outside the prime-order
+// subgroup: P's encoding with its low x byte changed until it decodes to a
+// point that fails mcl's isValidOrder(). Nothing clears the cofactor on the
+// way, since curve init turns mcl's order check in deserialize() off. False
+// when the group has no cofactor, so that every point on the curve is in it.
+template<class G>
+bool off_subgroup_point(const G& P, G& bad) {
+    if (subgroup_cofactor_prime(&P) == 1) {
+        return false;
+    }
+    unsigned char bytes[MAX_G2_BYTES];
+    const size_t n = P.serialize(bytes, sizeof(bytes));
+    const unsigned char x0 = bytes[0];
+    for (int k = 1; k < 256; ++k) {
+        bytes[0] = static_cast<unsigned char>(x0 ^ k);
+        if (bad.deserialize(bytes, n) == n && !bad.isValidOrder()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Checks `bad`, `good` with one point replaced by an off_subgroup_point(),
+// against every decode path: trusted decode takes it, untrusted decode
+// refuses it, and wire_decode_batch() refuses it and nothing else from a
+// batch large enough for SubgroupBatch's batched test, so the failed
+// combination and the point by point recheck that finds the culprit both
+// run. Prints one row and returns false if any path got it wrong.
+template<class M>
+bool wire_subgroup_report(const M& good, const M& bad, const std::string& what) {
+    std::vector<unsigned char> bytes = wire_encode(bad);
+    M out;
+    std::vector<std::string> errors;
+
+    try {
+        wire_decode(bytes, out, WIRE_TRUSTED);
+    } catch (const std::exception&) {
+        errors.push_back("trusted decode refused it");
+    }
+    try {
+        wire_decode(bytes, out, WIRE_UNTRUSTED);
+        errors.push_back("untrusted decode took it");
+    } catch (const std::invalid_argument&) {
+    }
+
+    // Every message has at least one point in each group it uses.
+    const int rounds = std::max(subgroup_batch_rounds(subgroup_cofactor_prime(static_cast<const G1*>(0))),
+                                subgroup_batch_rounds(subgroup_cofactor_prime(static_cast<const G2*>(0))));
+    const size_t batch = SUBGROUP_MIN_POINTS_PER_ROUND * rounds + 1;
+    const size_t culprit = batch / 2;
+    std::vector<std::vector<unsigned char> > in(batch, wire_encode(good));
+    in[culprit] = bytes;
+    std::vector<M> decoded;
+    std::vector<char> ok;
+    wire_decode_batch(in, decoded, ok);
+    if (ok[culprit]) {
+        errors.push_back("batch took it");
+    }
+    if (std::count(ok.begin(), ok.end(), 0) > (ok[culprit] ? 0 : 1)) {
+        errors.push_back("batch refused a valid message");
+    }
+
+    std::cout << std::left << std::setw(26) << WireMessage<M>::name() << " " << what << ": "
+              << (errors.empty() ? "refused" : "") << std::right;
+    for (size_t i = 0; i < errors.size(); ++i) {
+        std::cout << (i ? ", " : "") << errors[i];
+    }
+    std::cout << std::endl;
+    return errors.empty();
+}
+
+#endif
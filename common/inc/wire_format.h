@@ -0,0 +1,516 @@
+#ifndef DNTAT_COMMON_WIRE_FORMAT_H
+#define DNTAT_COMMON_WIRE_FORMAT_H
+
+#include "curve.h"
+#include "subgroup_check.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Versioned fixed-layout binary encoding for protocol messages.
+//
+// A message is a 4-byte header -- format version, message type, and the Fp
+// and Fr byte lengths of the curve it was made on -- then, if the message
+// has a variable part, a little-endian u32 record count, then its fields in
+// declaration order: each Fr as its canonical byte string, each G1/G2 as a
+// compressed affine point (mcl serialize()), and finally the variable
+// records. Every offset is fixed by the message type and the curve, so a
+// field can be found without reading the ones before it.
+//
+// WireView<M> checks the header and the exact length of a buffer in place
+// and decodes fields only when asked: a verifier that needs one point of a
+// message pays for one decompression. wire_decode() reads everything.
+//
+// Every decode says whether the sender is trusted. WIRE_UNTRUSTED (users,
+// the network) checks that each point is in the prime-order subgroup;
+// WIRE_TRUSTED (what this deployment produced itself: its own keys, a cached
+// apk, messages between its signers and coordinator) skips that check.
+// Decoding into a SubgroupBatch instead defers the check, so the points of a
+// whole batch of requests are checked together (subgroup_check.h).
+//
+// A message type opts in with a WireMessage specialization giving its type
+// byte, a name, and a visit function listing its fields once,
+//
+//   template<> struct WireMessage<Token> {
+//       static const uint8_t type = 0x12;
+//       static const char* name() { return "Token"; }
+//       enum { SIGMA, R, S };
+//       template<class V, class M> static void visit(V& v, M& m) { v(m.sigma); v(m.r); v(m.s); }
+//   };
+//
+// which then drives the layout, the encoder and the decoder. A variable part
+// is declared last with v.tail(vec) or v.tail(vec_a, vec_b) (equal-length
+// vectors, stored interleaved). Type bytes: NTAT 0x1x, DNTAT 0x2x,
+// U-Prove 0x3x, CHAC 0x4x.
+
+template<class M> struct WireMessage;
+
+enum { WIRE_FORMAT_VERSION = 1, WIRE_FORMAT_HEADER = 4, WIRE_FORMAT_MAX_FIELDS = 32 };
+
+enum WireFieldKind : uint8_t { WIRE_FR, WIRE_G1, WIRE_G2 };
+
+enum WireTrust { WIRE_TRUSTED, WIRE_UNTRUSTED };
+
+inline WireFieldKind wire_kind_of(const Fr*) { return WIRE_FR; }
+inline WireFieldKind wire_kind_of(const G1*) { return WIRE_G1; }
+inline WireFieldKind wire_kind_of(const G2*) { return WIRE_G2; }
+
+// Encoded sizes on the active curve.
+struct WireSizes {
+    WireSizes() : fr(Fr::getByteSize()), fp(Fp::getByteSize()) {}
+
+    size_t of(uint8_t kind) const {
+        return kind == WIRE_FR ? fr : kind == WIRE_G1 ? fp : 2 * fp;
+    }
+
+    size_t fr;
+    size_t fp;
+};
+
+// Field kinds of one message type, recorded by visiting a default object.
+// Curve independent; offsets come from the per-kind counts before a field.
+struct WireSchema {
+    WireSchema() : num_fixed(0), num_tail(0), has_tail(false) {
+        count[WIRE_FR] = count[WIRE_G1] = count[WIRE_G2] = 0;
+    }
+
+    template<class T>
+    void operator()(const T& x) {
+        if (num_fixed == WIRE_FORMAT_MAX_FIELDS) {
+            throw std::logic_error("WireSchema: too many fields");
+        }
+        uint8_t kind = wire_kind_of(&x);
+        for (int k = 0; k < 3; ++k) {
+            before[num_fixed][k] = count[k];
+        }
+        fixed[num_fixed++] = kind;
+        ++count[kind];
+    }
+
+    template<class A, class Alloc>
+    void tail(const std::vector<A, Alloc>&) {
+        has_tail = true;
+        tail_kind[num_tail++] = wire_kind_of(static_cast<const A*>(0));
+    }
+
+    template<class A, class AllocA, class B, class AllocB>
+    void tail(const std::vector<A, AllocA>&, const std::vector<B, AllocB>&) {
+        has_tail = true;
+        tail_kind[num_tail++] = wire_kind_of(static_cast<const A*>(0));
+        tail_kind[num_tail++] = wire_kind_of(static_cast<const B*>(0));
+    }
+
+    size_t fixed_bytes(const WireSizes& s) const {
+        return count[WIRE_FR] * s.fr + count[WIRE_G1] * s.fp + count[WIRE_G2] * 2 * s.fp;
+    }
+
+    size_t record_bytes(const WireSizes& s) const {
+        size_t n = 0;
+        for (size_t i = 0; i < num_tail; ++i) {
+            n += s.of(tail_kind[i]);
+        }
+        return n;
+    }
+
+    size_t header_bytes() const {
+        return WIRE_FORMAT_HEADER + (has_tail ? 4 : 0);
+    }
+
+    size_t offset(size_t field, const WireSizes& s) const {
+        return header_bytes() + before[field][WIRE_FR] * s.fr + before[field][WIRE_G1] * s.fp +
+               before[field][WIRE_G2] * 2 * s.fp;
+    }
+
+    uint8_t fixed[WIRE_FORMAT_MAX_FIELDS];
+    uint16_t before[WIRE_FORMAT_MAX_FIELDS][3];
+    size_t num_fixed;
+    uint16_t count[3];
+    uint8_t tail_kind[2];
+    size_t num_tail;
+    bool has_tail;
+};
+
+template<class M>
+const WireSchema& wire_schema() {
+    struct Build {
+        static WireSchema run() {
+            WireSchema schema;
+            M m;
+            WireMessage<M>::visit(schema, m);
+            return schema;
+        }
+    };
+    static const WireSchema schema = Build::run();
+    return schema;
+}
+
+// Number of variable records in a message (0 if it has no variable part).
+struct WireTailCounter {
+    WireTailCounter() : records(0) {}
+
+    template<class T>
+    void operator()(const T&) {}
+
+    template<class A, class Alloc>
+    void tail(const std::vector<A, Alloc>& a) {
+        records = a.size();
+    }
+
+    template<class A, class AllocA, class B, class AllocB>
+    void tail(const std::vector<A, AllocA>& a, const std::vector<B, AllocB>& b) {
+        if (a.size() != b.size()) {
+            throw std::invalid_argument("wire: paired vectors differ in length");
+        }
+        records = a.size();
+    }
+
+    size_t records;
+};
+
+template<class M>
+size_t wire_size(const M& m) {
+    const WireSchema& schema = wire_schema<M>();
+    WireSizes sizes;
+    WireTailCounter counter;
+    WireMessage<M>::visit(counter, m);
+    return schema.header_bytes() + schema.fixed_bytes(sizes) + counter.records * schema.record_bytes(sizes);
+}
+
+class WireEncoder {
+public:
+    explicit WireEncoder(unsigned char* p) : p_(p) {}
+
+    void operator()(const Fr& x) {
+        put(x, sizes_.fr);
+    }
+
+    void operator()(const G1& x) {
+        put(x, sizes_.fp);
+    }
+
+    void operator()(const G2& x) {
+        put(x, 2 * sizes_.fp);
+    }
+
+    template<class A, class Alloc>
+    void tail(const std::vector<A, Alloc>& a) {
+        for (size_t i = 0; i < a.size(); ++i) {
+            (*this)(a[i]);
+        }
+    }
+
+    template<class A, class AllocA, class B, class AllocB>
+    void tail(const std::vector<A, AllocA>& a, const std::vector<B, AllocB>& b) {
+        for (size_t i = 0; i < a.size(); ++i) {
+            (*this)(a[i]);
+            (*this)(b[i]);
+        }
+    }
+
+private:
+    template<class T>
+    void put(const T& x, size_t n) {
+        if (x.serialize(p_, n) != n) {
+            throw std::runtime_error("wire: serialize failed");
+        }
+        p_ += n;
+    }
+
+    unsigned char* p_;
+    WireSizes sizes_;
+};
+
+inline void wire_put_format_header(unsigned char* p, uint8_t type, const WireSizes& sizes) {
+    p[0] = WIRE_FORMAT_VERSION;
+    p[1] = type;
+    p[2] = static_cast<unsigned char>(sizes.fp);
+    p[3] = static_cast<unsigned char>(sizes.fr);
+}
+
+// Encodes into `out`, which must hold wire_size(m) bytes; returns that size.
+template<class M>
+size_t wire_encode(const M& m, unsigned char* out, size_t capacity) {
+    const WireSchema& schema = wire_schema<M>();
+    WireSizes sizes;
+    WireTailCounter counter;
+    WireMessage<M>::visit(counter, m);
+    size_t total = schema.header_bytes() + schema.fixed_bytes(sizes) + counter.records * schema.record_bytes(sizes);
+    if (capacity < total) {
+        throw std::length_error(std::string("wire: buffer too small for ") + WireMessage<M>::name());
+    }
+    wire_put_format_header(out, WireMessage<M>::type, sizes);
+    if (schema.has_tail) {
+        uint32_t n = static_cast<uint32_t>(counter.records);
+        for (int i = 0; i < 4; ++i) {
+            out[WIRE_FORMAT_HEADER + i] = static_cast<unsigned char>(n >> (8 * i));
+        }
+    }
+    WireEncoder encoder(out + schema.header_bytes());
+    WireMessage<M>::visit(encoder, m);
+    return total;
+}
+
+template<class M>
+std::vector<unsigned char> wire_encode(const M& m) {
+    std::vector<unsigned char> out(wire_size(m));
+    wire_encode(m, out.data(), out.size());
+    return out;
+}
+
+// A received message of type M, checked in place: version, type, curve and
+// exact length. Fields are decoded on request and fail (throw) if they do
+// not hold a valid encoding, or, from an untrusted sender, a point outside
+// the subgroup.
+template<class M>
+class WireView {
+public:
+    WireView(const unsigned char* p, size_t n) : p_(p), n_(n), records_(0) {
+        const WireSchema& schema = wire_schema<M>();
+        if (n < schema.header_bytes()) {
+            throw std::invalid_argument(std::string("wire: truncated ") + WireMessage<M>::name());
+        }
+        if (p[0] != WIRE_FORMAT_VERSION) {
+            throw std::invalid_argument("wire: unsupported format version " + std::to_string(p[0]));
+        }
+        if (p[1] != WireMessage<M>::type) {
+            throw std::invalid_argument(std::string("wire: not a ") + WireMessage<M>::name());
+        }
+        if (p[2] != sizes_.fp || p[3] != sizes_.fr) {
+            throw std::invalid_argument("wire: message was encoded for another curve");
+        }
+        size_t expected = schema.header_bytes() + schema.fixed_bytes(sizes_);
+        if (n < expected) {
+            throw std::invalid_argument(std::string("wire: truncated ") + WireMessage<M>::name());
+        }
+        if (schema.has_tail) {
+            for (int i = 0; i < 4; ++i) {
+                records_ |= static_cast<size_t>(p[WIRE_FORMAT_HEADER + i]) << (8 * i);
+            }
+            size_t record = schema.record_bytes(sizes_);
+            if (records_ > (n - expected) / record) {
+                throw std::invalid_argument(std::string("wire: truncated ") + WireMessage<M>::name());
+            }
+            expected += records_ * record;
+        }
+        if (n != expected) {
+            throw std::invalid_argument(std::string("wire: wrong length for ") + WireMessage<M>::name());
+        }
+    }
+
+    // Records in the variable part.
+    size_t records() const {
+        return records_;
+    }
+
+    // Decodes fixed field `field` (WireMessage<M>'s enum) into x.
+    template<class T>
+    void get(size_t field, T& x, WireTrust trust = WIRE_UNTRUSTED) const {
+        const WireSchema& schema = wire_schema<M>();
+        if (field >= schema.num_fixed || schema.fixed[field] != wire_kind_of(&x)) {
+            throw std::logic_error(std::string("wire: no such field in ") + WireMessage<M>::name());
+        }
+        decode(p_ + schema.offset(field, sizes_), x, sizes_);
+        if (trust == WIRE_UNTRUSTED) {
+            check(x);
+        }
+    }
+
+    // Decodes member `member` of variable record `i`.
+    template<class T>
+    void get_record(size_t i, size_t member, T& x, WireTrust trust = WIRE_UNTRUSTED) const {
+        const WireSchema& schema = wire_schema<M>();
+        if (i >= records_ || member >= schema.num_tail || schema.tail_kind[member] != wire_kind_of(&x)) {
+            throw std::out_of_range(std::string("wire: no such record field in ") + WireMessage<M>::name());
+        }
+        size_t at = schema.header_bytes() + schema.fixed_bytes(sizes_) + i * schema.record_bytes(sizes_);
+        for (size_t k = 0; k < member; ++k) {
+            at += sizes_.of(schema.tail_kind[k]);
+        }
+        decode(p_ + at, x, sizes_);
+        if (trust == WIRE_UNTRUSTED) {
+            check(x);
+        }
+    }
+
+    // The encoded bytes of a fixed field, e.g. to hash a point without
+    // decompressing it.
+    const unsigned char* raw(size_t field) const {
+        const WireSchema& schema = wire_schema<M>();
+        if (field >= schema.num_fixed) {
+            throw std::logic_error(std::string("wire: no such field in ") + WireMessage<M>::name());
+        }
+        return p_ + schema.offset(field, sizes_);
+    }
+
+    size_t raw_size(size_t field) const {
+        return sizes_.of(wire_schema<M>().fixed[field]);
+    }
+
+    // Decodes every field; an untrusted message's points are checked one by
+    // one (a single message is too small for a batched check to pay off).
+    void decode_all(M& m, WireTrust trust = WIRE_UNTRUSTED) const {
+        Reader reader(p_ + wire_schema<M>().header_bytes(), sizes_, records_);
+        WireMessage<M>::visit(reader, m);
+        if (trust == WIRE_UNTRUSTED) {
+            Checker checker;
+            WireMessage<M>::visit(checker, m);
+        }
+    }
+
+    // Decodes every field and leaves the subgroup check of its points to
+    // batch.check(), which reports failures under `owner`.
+    void decode_all(M& m, SubgroupBatch& batch, size_t owner) const {
+        Reader reader(p_ + wire_schema<M>().header_bytes(), sizes_, records_);
+        WireMessage<M>::visit(reader, m);
+        Collector collector(batch, owner);
+        WireMessage<M>::visit(collector, m);
+    }
+
+private:
+    struct Reader {
+        Reader(const unsigned char* p, const WireSizes& sizes, size_t records)
+            : p(p), sizes(sizes), records(records) {}
+
+        template<class T>
+        void operator()(T& x) {
+            decode(p, x, sizes);
+            p += sizes.of(wire_kind_of(&x));
+        }
+
+        template<class A, class Alloc>
+        void tail(std::vector<A, Alloc>& a) {
+            a.resize(records);
+            for (size_t i = 0; i < records; ++i) {
+                (*this)(a[i]);
+            }
+        }
+
+        template<class A, class AllocA, class B, class AllocB>
+        void tail(std::vector<A, AllocA>& a, std::vector<B, AllocB>& b) {
+            a.resize(records);
+            b.resize(records);
+            for (size_t i = 0; i < records; ++i) {
+                (*this)(a[i]);
+                (*this)(b[i]);
+            }
+        }
+
+        const unsigned char* p;
+        const WireSizes& sizes;
+        size_t records;
+    };
+
+    struct Checker {
+        template<class T>
+        void operator()(const T& x) {
+            check(x);
+        }
+
+        template<class A, class Alloc>
+        void tail(const std::vector<A, Alloc>& a) {
+            for (size_t i = 0; i < a.size(); ++i) {
+                check(a[i]);
+            }
+        }
+
+        template<class A, class AllocA, class B, class AllocB>
+        void tail(const std::vector<A, AllocA>& a, const std::vector<B, AllocB>& b) {
+            tail(a);
+            tail(b);
+        }
+    };
+
+    // Adds the points of a decoded message to a SubgroupBatch.
+    struct Collector {
+        Collector(SubgroupBatch& batch, size_t owner) : batch(batch), owner(owner) {}
+
+        void operator()(const Fr&) {}
+
+        template<class T>
+        void operator()(const T& x) {
+            batch.add(x, owner);
+        }
+
+        template<class A, class Alloc>
+        void tail(const std::vector<A, Alloc>& a) {
+            for (size_t i = 0; i < a.size(); ++i) {
+                (*this)(a[i]);
+            }
+        }
+
+        template<class A, class AllocA, class B, class AllocB>
+        void tail(const std::vector<A, AllocA>& a, const std::vector<B, AllocB>& b) {
+            tail(a);
+            tail(b);
+        }
+
+        SubgroupBatch& batch;
+        size_t owner;
+    };
+
+    static void check(const Fr&) {}
+
+    template<class T>
+    static void check(const T& x) {
+        if (!in_subgroup(x)) {
+            throw std::invalid_argument(std::string("wire: point outside the subgroup in ") +
+                                        WireMessage<M>::name());
+        }
+    }
+
+    template<class T>
+    static void decode(const unsigned char* p, T& x, const WireSizes& sizes) {
+        size_t n = sizes.of(wire_kind_of(&x));
+        if (x.deserialize(p, n) != n) {
+            throw std::invalid_argument("wire: invalid field encoding");
+        }
+    }
+
+    const unsigned char* p_;
+    size_t n_;
+    size_t records_;
+    WireSizes sizes_;
+};
+
+template<class M>
+void wire_decode(const unsigned char* p, size_t n, M& m, WireTrust trust = WIRE_UNTRUSTED) {
+    WireView<M>(p, n).decode_all(m, trust);
+}
+
+template<class M>
+void wire_decode(const std::vector<unsigned char>& bytes, M& m, WireTrust trust = WIRE_UNTRUSTED) {
+    wire_decode(bytes.data(), bytes.size(), m, trust);
+}
+
+template<class M>
+void wire_decode(const unsigned char* p, size_t n, M& m, SubgroupBatch& batch, size_t owner) {
+    WireView<M>(p, n).decode_all(m, batch, owner);
+}
+
+// Decodes a batch of messages from untrusted senders with one deferred
+// subgroup check. ok[i] is false for a message that did not parse or has a
+// point outside the subgroup; out[i] is then unspecified.
+template<class M>
+void wire_decode_batch(const std::vector<std::vector<unsigned char> >& in, std::vector<M>& out,
+                       std::vector<char>& ok) {
+    out.resize(in.size());
+    ok.assign(in.size(), 1);
+    SubgroupBatch batch;
+    for (size_t i = 0; i < in.size(); ++i) {
+        try {
+            wire_decode(in[i].data(), in[i].size(), out[i], batch, i);
+        } catch (const std::exception&) {
+            ok[i] = 0;
+        }
+    }
+    if (!batch.check()) {
+        for (size_t i : batch.bad()) {
+            ok[i] = 0;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,337 @@
+#ifndef DNTAT_ARTIFACT_H
+#define DNTAT_ARTIFACT_H
+
+#include "dntat_ps.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A committee's startup precomputation, persisted (POSIX).
+//
+// A process that serves one committee hashes the generators to the curve,
+// derives the MuSig coefficients and the aggregated key from the signers'
+// public keys and, with DNTAT_PS::precompute(), builds the fixed-base table
+// for g1 and the Miller-loop lines for g2. write() stores all of it in one
+// file; the constructor maps the file read-only and DNTAT_PS(artifact) uses
+// the table and lines in place. Starting a worker then costs the mapping and
+// one SHA-256 pass over the file, and all workers that map it share the
+// same page-cache pages.
+//
+// Elements are stored as their in-memory images, not their wire encoding,
+// so nothing is decoded or normalized at startup. An image only means
+// something to a build with the same mcl, MCL_MAX_FP_BIT_SIZE and curve.
+// The header records the active curve's field sizes, this build's element
+// sizes and the compressed encoding of g1, which a build with a different
+// internal representation reads back differently. A mismatch, another
+// format version, a line count other than precomputeG2() gives on this
+// build or a wrong digest makes the constructor throw; the caller
+// then builds the values itself and may write() a fresh file.
+//
+// The file is trusted (WIRE_TRUSTED in wire_format.h terms): the digest
+// catches corruption, not forgery, since whoever can write the file can
+// recompute it. Give it the permissions of the service's configuration.
+//
+// Layout: a page of header, then the sections at the offsets it lists,
+// each 64-byte aligned:
+//
+//   g1, g2          the generators
+//   keys            the committee's n PublicKeys
+//   coefficients    a_i = H_agg(pks, pk_i), n Fr
+//   apk             the aggregated key, 4 G2
+//   g1 table        FixedBaseTable<G1> rows, windows * 16 G1
+//   g2 lines        precomputeG2(g2), line_count Fp6
+//
+// The digest is SHA-256 over every byte after it, header fields included.
+
+class DNTATArtifact {
+public:
+    enum { kVersion = 1 };
+
+    // Maps and checks the file at `path`; throws std::runtime_error if it
+    // cannot be used by this build.
+    explicit DNTATArtifact(const std::string& path) : fd_(-1), map_(0), bytes_(0) {
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            fail("open " + path);
+        }
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) {
+            close_and_throw("stat " + path + ": " + std::strerror(errno));
+        }
+        bytes_ = static_cast<size_t>(st.st_size);
+        if (bytes_ < kHeaderBytes) {
+            close_and_throw(path + " is too short");
+        }
+        map_ = ::mmap(0, bytes_, PROT_READ, MAP_SHARED, fd_, 0);
+        if (map_ == MAP_FAILED) {
+            map_ = 0;
+            close_and_throw("mmap " + path + ": " + std::strerror(errno));
+        }
+        check(path);
+    }
+
+    ~DNTATArtifact() {
+        if (map_) {
+            ::munmap(map_, bytes_);
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    DNTATArtifact(const DNTATArtifact&) = delete;
+    DNTATArtifact& operator=(const DNTATArtifact&) = delete;
+
+    // Runs dntat.precompute(pks) and writes the result to `path`. The file
+    // is written next to `path` and renamed over it, so processes that have
+    // the old file mapped keep a consistent view.
+    static void write(const std::string& path, DNTAT_PS& dntat, const std::vector<PublicKey>& pks) {
+        dntat.precompute(pks);
+        const size_t n = pks.size();
+        const size_t windows = dntat.g1_table.windows();
+        const size_t table_entries = windows * FixedBaseTable<G1>::window_size();
+
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magic(), sizeof(header.magic));
+        header.version = kVersion;
+        header.fp_bytes = static_cast<uint32_t>(Fp::getByteSize());
+        header.fr_bytes = static_cast<uint32_t>(Fr::getByteSize());
+        header.fr_size = sizeof(Fr);
+        header.g1_size = sizeof(G1);
+        header.g2_size = sizeof(G2);
+        header.fp6_size = sizeof(Fp6);
+        header.num_signers = static_cast<uint32_t>(n);
+        header.table_windows = static_cast<uint32_t>(windows);
+        header.line_count = static_cast<uint32_t>(dntat.g2_lines.size());
+        header.g1_encoding_size = static_cast<uint32_t>(
+            dntat.g1.serialize(header.g1_encoding, sizeof(header.g1_encoding)));
+
+        const size_t sizes[kSections] = {
+            sizeof(G1), sizeof(G2), n * sizeof(PublicKey), n * sizeof(Fr), 4 * sizeof(G2),
+            table_entries * sizeof(G1), dntat.g2_lines.size() * sizeof(Fp6)
+        };
+        uint64_t offset = kHeaderBytes;
+        for (int s = 0; s < kSections; ++s) {
+            header.offset[s] = offset;
+            offset = (offset + sizes[s] + kAlign - 1) / kAlign * kAlign;
+        }
+        header.file_bytes = offset;
+
+        std::vector<unsigned char> file(header.file_bytes, 0);
+        const void* sections[kSections] = {
+            &dntat.g1, &dntat.g2, dntat.committee.data(), dntat.committee_a.data(),
+            dntat.committee_apk.data(), dntat.g1_table.rows(), dntat.g2_lines.data()
+        };
+        for (int s = 0; s < kSections; ++s) {
+            if (sizes[s] != 0) {
+                std::memcpy(&file[header.offset[s]], sections[s], sizes[s]);
+            }
+        }
+        std::memcpy(&file[0], &header, sizeof(header));
+        digest(&file[0], file.size(), &file[kDigestOffset]);
+
+        const std::string tmp = path + ".tmp";
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            fail("open " + tmp);
+        }
+        size_t done = 0;
+        while (done < file.size()) {
+            ssize_t w = ::write(fd, &file[done], file.size() - done);
+            if (w < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                ::close(fd);
+                fail("write " + tmp);
+            }
+            done += static_cast<size_t>(w);
+        }
+        if (::fsync(fd) != 0) {
+            ::close(fd);
+            fail("fsync " + tmp);
+        }
+        ::close(fd);
+        if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+            fail("rename " + tmp);
+        }
+    }
+
+    int num_signers() const {
+        return static_cast<int>(header().num_signers);
+    }
+
+    const G1& g1() const {
+        return *section<G1>(kG1);
+    }
+
+    const G2& g2() const {
+        return *section<G2>(kG2);
+    }
+
+    const PublicKey* keys() const {
+        return section<PublicKey>(kKeys);
+    }
+
+    const Fr* coefficients() const {
+        return section<Fr>(kCoefficients);
+    }
+
+    const G2* apk() const {
+        return section<G2>(kApk);
+    }
+
+    const G1* table() const {
+        return section<G1>(kTable);
+    }
+
+    size_t table_windows() const {
+        return header().table_windows;
+    }
+
+    const Fp6* lines() const {
+        return section<Fp6>(kLines);
+    }
+
+    size_t line_count() const {
+        return header().line_count;
+    }
+
+    size_t file_bytes() const {
+        return bytes_;
+    }
+
+private:
+    enum { kHeaderBytes = 4096, kAlign = 64 };
+    enum Section { kG1, kG2, kKeys, kCoefficients, kApk, kTable, kLines, kSections };
+
+    struct Header {
+        char magic[8];
+        unsigned char digest[32];
+        uint32_t version;
+        uint32_t fp_bytes;
+        uint32_t fr_bytes;
+        uint32_t fr_size;
+        uint32_t g1_size;
+        uint32_t g2_size;
+        uint32_t fp6_size;
+        uint32_t num_signers;
+        uint32_t table_windows;
+        uint32_t line_count;
+        uint64_t file_bytes;
+        uint64_t offset[kSections];
+        uint32_t g1_encoding_size;
+        unsigned char g1_encoding[64];
+    };
+
+    static_assert(sizeof(Header) <= kHeaderBytes, "header must fit its page");
+    static_assert(MAX_G1_BYTES <= 64, "g1 encoding must fit the header");
+
+    enum { kDigestOffset = 8 };
+
+    static const char* magic() {
+        return "DNTATPRE";
+    }
+
+    static void digest(const unsigned char* file, size_t size, unsigned char* out) {
+        const size_t from = kDigestOffset + 32;
+        if (mcl::fp::sha256(out, 32, file + from, static_cast<uint32_t>(size - from)) != 32) {
+            throw std::runtime_error("DNTATArtifact: sha256 failed");
+        }
+    }
+
+    static void fail(const std::string& what) {
+        throw std::runtime_error("DNTATArtifact: " + what + ": " + std::strerror(errno));
+    }
+
+    void close_and_throw(const std::string& what) {
+        if (map_) {
+            ::munmap(map_, bytes_);
+            map_ = 0;
+        }
+        ::close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("DNTATArtifact: " + what);
+    }
+
+    const Header& header() const {
+        return *static_cast<const Header*>(map_);
+    }
+
+    template<class T>
+    const T* section(Section s) const {
+        return reinterpret_cast<const T*>(static_cast<const unsigned char*>(map_) + header().offset[s]);
+    }
+
+    void check(const std::string& path) {
+        const Header& h = header();
+        if (std::memcmp(h.magic, magic(), sizeof(h.magic)) != 0) {
+            close_and_throw(path + " is not a DNTAT precomputation file");
+        }
+        if (h.version != kVersion) {
+            close_and_throw(path + " has format version " + std::to_string(h.version) + ", expected " +
+                            std::to_string(static_cast<int>(kVersion)));
+        }
+        if (h.file_bytes != bytes_) {
+            close_and_throw(path + " is truncated");
+        }
+        unsigned char computed[32];
+        digest(static_cast<const unsigned char*>(map_), bytes_, computed);
+        if (std::memcmp(computed, h.digest, sizeof(computed)) != 0) {
+            close_and_throw(path + " fails its digest");
+        }
+        if (h.fp_bytes != Fp::getByteSize() || h.fr_bytes != Fr::getByteSize()) {
+            close_and_throw(path + " was written for another curve");
+        }
+        if (h.fr_size != sizeof(Fr) || h.g1_size != sizeof(G1) || h.g2_size != sizeof(G2) ||
+            h.fp6_size != sizeof(Fp6) || h.table_windows != Fr::getByteSize() * 2) {
+            close_and_throw(path + " was written by a build with another element layout");
+        }
+        const size_t n = h.num_signers;
+        if (n == 0) {
+            close_and_throw(path + " has no signers");
+        }
+        const size_t table_entries = static_cast<size_t>(h.table_windows) * FixedBaseTable<G1>::window_size();
+        const size_t sizes[kSections] = {
+            sizeof(G1), sizeof(G2), n * sizeof(PublicKey), n * sizeof(Fr), 4 * sizeof(G2),
+            table_entries * sizeof(G1), static_cast<size_t>(h.line_count) * sizeof(Fp6)
+        };
+        for (int s = 0; s < kSections; ++s) {
+            if (h.offset[s] < kHeaderBytes || h.offset[s] % kAlign != 0 || h.offset[s] > bytes_ ||
+                sizes[s] > bytes_ - h.offset[s]) {
+                close_and_throw(path + " has a section out of bounds");
+            }
+        }
+        // verify() hands the lines to precomputedMillerLoop2mixed(), which
+        // reads as many as precomputeG2() makes on this build: mcl's
+        // per-curve constant, so no lines are recomputed here.
+        const size_t line_count = BN::param.precomputedQcoeffSize;
+        if (h.line_count != line_count) {
+            close_and_throw(path + " has " + std::to_string(h.line_count) + " g2 lines, this build uses " +
+                            std::to_string(line_count));
+        }
+        unsigned char encoding[64];
+        size_t len = g1().serialize(encoding, sizeof(encoding));
+        if (len != h.g1_encoding_size || std::memcmp(encoding, h.g1_encoding, len) != 0) {
+            close_and_throw(path + " was written by a build with another element layout");
+        }
+    }
+
+    int fd_;
+    void* map_;
+    size_t bytes_;
+};
+
+#endif
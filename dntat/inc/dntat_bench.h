@@ -0,0 +1,111 @@
+#ifndef DNTAT_BENCH_H
+#define DNTAT_BENCH_H
+
+#include "dntat_ps.h"
+
+#include <csignal>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Helpers shared by the DNTAT benchmarks and dntat_loadgen (POSIX): latency
+// percentiles, committees with tokens issued up front, and dntat_signerd
+// processes started and stopped around a run.
+
+// Nearest-rank quantile q of `sorted` (ascending); 0 when it is empty.
+inline double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[static_cast<size_t>(q * (sorted.size() - 1) + 0.5)];
+}
+
+// A committee of fresh signers and tokens it issued to one user.
+struct BenchCommittee {
+    std::vector<PublicKey> pks;
+    std::vector<Token> tokens;
+};
+
+// n signers' keys and num_tokens tokens for `user`, made before anything
+// is timed.
+inline BenchCommittee make_committee(int n, const std::pair<G1, Fr>& user, int num_tokens) {
+    DNTAT_PS dntat(n);
+    BenchCommittee c;
+    std::vector<SecretKey> sks;
+    for (int i = 0; i < n; ++i) {
+        auto keypair = dntat.S_keygen();
+        c.pks.push_back(keypair.first);
+        sks.push_back(keypair.second);
+    }
+    for (int t = 0; t < num_tokens; ++t) {
+        DNTAT_PS::SignResult r = dntat.sign(sks, c.pks, user.second, user.first);
+        c.tokens.push_back(dntat.tokenaggr(r.sigma_bars, r.hbar, r.omega, c.pks));
+    }
+    return c;
+}
+
+// dntat_signerd next to the running binary, for benchmarks not told where
+// it is.
+inline std::string default_signerd(const char* argv0) {
+    std::string self = argv0;
+    size_t slash = self.rfind('/');
+    return (slash == std::string::npos ? std::string(".") : self.substr(0, slash)) + "/dntat_signerd";
+}
+
+// Sends SIGTERM to every signer, then waits for all of them.
+inline void stop_signers(const std::vector<pid_t>& pids) {
+    for (pid_t pid : pids) {
+        ::kill(pid, SIGTERM);
+    }
+    for (pid_t pid : pids) {
+        ::waitpid(pid, 0, 0);
+    }
+}
+
+// Starts `signerd --curve curve --listen addrs[i]` for every address,
+// followed by extra_args[i] when extra_args is not empty, and returns the
+// pids in address order. Throws std::runtime_error if a fork fails, after
+// stopping the signers already started.
+inline std::vector<pid_t> spawn_signers(const std::string& signerd, const std::string& curve,
+                                        const std::vector<std::string>& addrs,
+                                        const std::vector<std::vector<std::string> >& extra_args =
+                                            std::vector<std::vector<std::string> >()) {
+    std::vector<pid_t> pids;
+    for (size_t i = 0; i < addrs.size(); ++i) {
+        // Built before fork(), so the child only calls execv().
+        std::vector<std::string> args;
+        args.push_back(signerd);
+        args.push_back("--curve");
+        args.push_back(curve);
+        args.push_back("--listen");
+        args.push_back(addrs[i]);
+        if (!extra_args.empty()) {
+            args.insert(args.end(), extra_args[i].begin(), extra_args[i].end());
+        }
+        std::vector<char*> argv;
+        for (std::string& arg : args) {
+            argv.push_back(&arg[0]);
+        }
+        argv.push_back(0);
+
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            stop_signers(pids);
+            throw std::runtime_error("spawn_signers: fork failed");
+        }
+        if (pid == 0) {
+            ::execv(signerd.c_str(), &argv[0]);
+            _exit(127);
+        }
+        pids.push_back(pid);
+    }
+    return pids;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef DNTAT_CODEC_H
+#define DNTAT_CODEC_H
+
+#include "dntat_ps.h"
+#include "wire_format.h"
+
+// Wire encodings of the DNTAT messages (see wire_format.h). The enums name
+// the fields for WireView<M>::get().
+
+template<> struct WireMessage<Token> {
+    static const uint8_t type = 0x20;
+    static const char* name() { return "Token"; }
+    enum { OMEGA, HBAR, SIGMA };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.omega);
+        v(m.hbar);
+        v(m.sigma);
+    }
+};
+
+template<> struct WireMessage<DNTAT_PS::IssuanceRequest> {
+    static const uint8_t type = 0x21;
+    static const char* name() { return "IssuanceRequest"; }
+    enum { T1, T2, T3, T4 };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.T[0]);
+        v(m.T[1]);
+        v(m.T[2]);
+        v(m.T[3]);
+    }
+};
+
+// One sigma_bar per signer in the variable part.
+template<> struct WireMessage<DNTAT_PS::SignResult> {
+    static const uint8_t type = 0x22;
+    static const char* name() { return "SignResult"; }
+    enum { HBAR, OMEGA };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.hbar);
+        v(m.omega);
+        v.tail(m.sigma_bars);
+    }
+};
+
+// Signer shares s_bar_i in key order, the body of a WIRE_SHARES reply.
+struct ShareList {
+    std::vector<G1> s_bars;
+};
+
+template<> struct WireMessage<ShareList> {
+    static const uint8_t type = 0x24;
+    static const char* name() { return "ShareList"; }
+    template<class V, class M> static void visit(V& v, M& m) {
+        v.tail(m.s_bars);
+    }
+};
+
+template<> struct WireMessage<PublicKey> {
+    static const uint8_t type = 0x23;
+    static const char* name() { return "PublicKey"; }
+    template<class V, class M> static void visit(V& v, M& m) {
+        for (int j = 0; j < 4; ++j) {
+            v(m.g1_keys[j]);
+        }
+        for (int j = 0; j < 4; ++j) {
+            v(m.g2_keys[j]);
+        }
+    }
+};
+
+#endif
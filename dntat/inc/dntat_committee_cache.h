@@ -0,0 +1,264 @@
+#ifndef DNTAT_COMMITTEE_CACHE_H
+#define DNTAT_COMMITTEE_CACHE_H
+
+#include "dntat_ps.h"
+#include "dntat_keyring.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+// Verifier state for many DNTAT committees, within a memory budget.
+//
+// A relying party that accepts tokens from several committees needs each
+// committee's apk and precomputation (CommitteeKeys, dntat_keyring.h). It
+// cannot keep them all. CommitteeCache maps a committee's id, a hash of
+// its public keys, to its CommitteeKeys, and evicts the least recently
+// used entries once their total size exceeds the budget.
+//
+// On a miss the caller's resolver supplies the committee's public keys,
+// e.g. from a directory service. They must hash to the requested id, and
+// the entry is then built outside the cache's lock. Concurrent lookups of
+// the same missing id wait for that one build instead of starting their
+// own (single flight). A failed build is passed to everyone waiting on it
+// and leaves nothing behind, so the next lookup tries again. Lookups of
+// entries already present only take the lock for a hash-table probe and a
+// list splice, which is small next to a verification.
+//
+// Entries are handed out as shared_ptr, so evicting one does not affect
+// redemptions still using it. The budget bounds what the cache itself
+// keeps; an entry larger than the whole budget is still built and returned
+// but pushes every other entry out.
+
+struct CommitteeId {
+    unsigned char bytes[32];
+};
+
+inline bool operator==(const CommitteeId& a, const CommitteeId& b) {
+    return std::memcmp(a.bytes, b.bytes, sizeof(a.bytes)) == 0;
+}
+
+inline bool operator<(const CommitteeId& a, const CommitteeId& b) {
+    return std::memcmp(a.bytes, b.bytes, sizeof(a.bytes)) < 0;
+}
+
+struct CommitteeIdHash {
+    size_t operator()(const CommitteeId& id) const {
+        size_t h;
+        std::memcpy(&h, id.bytes, sizeof(h));  // already a hash
+        return h;
+    }
+};
+
+// SHA-256 over a domain tag and every key of every signer, in committee
+// order, compressed.
+inline CommitteeId committee_id(const std::vector<PublicKey>& pks) {
+    static const char tag[] = "dntat/committee";
+    std::vector<unsigned char> buf(tag, tag + sizeof(tag) - 1);
+    buf.reserve(buf.size() + pks.size() * 4 * (MAX_G1_BYTES + MAX_G2_BYTES));
+    unsigned char element[MAX_G2_BYTES];
+    for (const PublicKey& pk : pks) {
+        for (const G1& P : pk.g1_keys) {
+            size_t n = P.serialize(element, sizeof(element));
+            buf.insert(buf.end(), element, element + n);
+        }
+        for (const G2& Q : pk.g2_keys) {
+            size_t n = Q.serialize(element, sizeof(element));
+            buf.insert(buf.end(), element, element + n);
+        }
+    }
+    CommitteeId id;
+    if (mcl::fp::sha256(id.bytes, sizeof(id.bytes), buf.data(), static_cast<uint32_t>(buf.size())) !=
+        sizeof(id.bytes)) {
+        throw std::runtime_error("committee_id: sha256 failed");
+    }
+    return id;
+}
+
+class CommitteeCache {
+public:
+    // Public keys of the committee with the given id; throws if unknown.
+    typedef std::function<std::vector<PublicKey>(const CommitteeId&)> Resolver;
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;     // lookups that built the entry
+        uint64_t waits;      // lookups that joined another lookup's build
+        uint64_t evictions;
+        size_t entries;
+        size_t bytes;
+    };
+
+    // A token to redeem and the committee that issued it.
+    struct Redemption {
+        CommitteeId committee;
+        Token token;
+        Fr sku;
+    };
+
+    CommitteeCache(size_t budget_bytes, Resolver resolve)
+        : budget_(budget_bytes), resolve_(resolve), bytes_(0), hits_(0), misses_(0), waits_(0),
+          evictions_(0) {}
+
+    CommitteeCache(const CommitteeCache&) = delete;
+    CommitteeCache& operator=(const CommitteeCache&) = delete;
+
+    // The committee's keys, built on a miss. Throws what the resolver or
+    // the build threw.
+    std::shared_ptr<const CommitteeKeys> get(const CommitteeId& id) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = slots_.find(id);
+        if (it != slots_.end()) {
+            Slot& slot = it->second;
+            if (slot.ready) {
+                ++hits_;
+                lru_.splice(lru_.begin(), lru_, slot.lru);
+                return slot.keys.get();
+            }
+            ++waits_;
+            Pending pending = slot.keys;
+            lock.unlock();
+            return pending.get();
+        }
+
+        ++misses_;
+        std::promise<std::shared_ptr<const CommitteeKeys> > promise;
+        slots_[id].keys = promise.get_future().share();
+        lock.unlock();
+
+        std::shared_ptr<const CommitteeKeys> keys;
+        try {
+            std::vector<PublicKey> pks = resolve_(id);
+            if (!(committee_id(pks) == id)) {
+                throw std::runtime_error("CommitteeCache: resolver returned keys of another committee");
+            }
+            keys = CommitteeKeys::build(0, pks);
+        } catch (...) {
+            lock.lock();
+            slots_.erase(id);
+            lock.unlock();
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        promise.set_value(keys);
+
+        lock.lock();
+        Slot& slot = slots_[id];
+        slot.ready = true;
+        slot.bytes = keys->bytes();
+        lru_.push_front(id);
+        slot.lru = lru_.begin();
+        bytes_ += slot.bytes;
+        evict_locked();
+        return keys;
+    }
+
+    // Verifies each redemption against its committee; ok[i] tells if
+    // items[i] is valid. Redemptions are grouped by committee: each group
+    // looks up its entry once and is checked with one
+    // DNTAT_PS::verify_batch(), and a group that fails is rechecked token
+    // by token. A committee that cannot be resolved fails its group. No
+    // double-spend check.
+    void verify_batch(const std::vector<Redemption>& items, std::vector<char>& ok) {
+        ok.assign(items.size(), 0);
+        std::vector<size_t> order(items.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return items[a].committee < items[b].committee;
+        });
+
+        ArenaScope scope;
+        ArenaVector<Token> tokens;
+        ArenaVector<Fr> skus;
+        for (size_t begin = 0; begin < order.size();) {
+            const CommitteeId& id = items[order[begin]].committee;
+            size_t end = begin + 1;
+            while (end < order.size() && items[order[end]].committee == id) {
+                ++end;
+            }
+            std::shared_ptr<const CommitteeKeys> keys;
+            try {
+                keys = get(id);
+            } catch (const std::exception&) {
+                begin = end;
+                continue;
+            }
+            tokens.clear();
+            skus.clear();
+            for (size_t j = begin; j < end; ++j) {
+                tokens.push_back(items[order[j]].token);
+                skus.push_back(items[order[j]].sku);
+            }
+            if (keys->dntat->verify_batch(tokens.data(), skus.data(), tokens.size(), keys->apk)) {
+                for (size_t j = begin; j < end; ++j) {
+                    ok[order[j]] = 1;
+                }
+            } else {
+                for (size_t j = begin; j < end; ++j) {
+                    ok[order[j]] = keys->dntat->verify(items[order[j]].token, keys->apk, items[order[j]].sku);
+                }
+            }
+            begin = end;
+        }
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats s;
+        s.hits = hits_;
+        s.misses = misses_;
+        s.waits = waits_;
+        s.evictions = evictions_;
+        s.entries = lru_.size();
+        s.bytes = bytes_;
+        return s;
+    }
+
+private:
+    typedef std::shared_future<std::shared_ptr<const CommitteeKeys> > Pending;
+
+    struct Slot {
+        Slot() : ready(false), bytes(0) {}
+        Pending keys;
+        bool ready;  // built and on the LRU list
+        size_t bytes;
+        std::list<CommitteeId>::iterator lru;
+    };
+
+    // Drops least recently used entries until within budget, always
+    // keeping the most recent one.
+    void evict_locked() {
+        while (bytes_ > budget_ && lru_.size() > 1) {
+            auto it = slots_.find(lru_.back());
+            bytes_ -= it->second.bytes;
+            slots_.erase(it);
+            lru_.pop_back();
+            ++evictions_;
+        }
+    }
+
+    const size_t budget_;
+    const Resolver resolve_;
+    mutable std::mutex mutex_;
+    std::unordered_map<CommitteeId, Slot, CommitteeIdHash> slots_;
+    std::list<CommitteeId> lru_;  // ready entries, most recent first
+    size_t bytes_;
+    uint64_t hits_;
+    uint64_t misses_;
+    uint64_t waits_;
+    uint64_t evictions_;
+};
+
+#endif
@@ -0,0 +1,380 @@
+#ifndef DNTAT_COORDINATOR_H
+#define DNTAT_COORDINATOR_H
+
+#include "dntat_ps.h"
+#include "dntat_wire.h"
+#include "dntat_shm_ring.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Issuance against n dntat_signerd processes, one connection per signer.
+// Addresses are those of dntat_wire.h, or "shm:<segment>:<slot>" for
+// signers on the same host: the coordinator then creates the segment and
+// signer i serves slot i through ShmRing instead of a socket (Linux). All
+// signers of one coordinator use the same transport.
+//
+// issue() blinds the user's attributes (DNTAT_PS::issue_request), sends the
+// same request to every signer, and waits for each signer's share until
+// that signer's deadline. Shares are unblinded with the signer's public key
+// and aggregated with tokenaggr(). Every signer must answer (the signature
+// is n-of-n); a signer that misses its deadline is reported in `late` and
+// the issuance fails. Its reply, if it comes later, is recognised by request
+// id and discarded.
+
+class SignerCoordinator {
+public:
+    // Connects to each signer, retrying for up to `connect_timeout` while
+    // signers start, and fetches their public keys in signer order.
+    explicit SignerCoordinator(const std::vector<std::string>& addrs,
+                               std::chrono::milliseconds connect_timeout = std::chrono::milliseconds(5000),
+                               std::chrono::microseconds deadline = std::chrono::microseconds(1000000))
+        : next_id_(1) {
+        if (addrs.empty()) {
+            throw std::invalid_argument("SignerCoordinator: no signers");
+        }
+        std::string segment;
+        size_t slot;
+        if (shm_parse_address(addrs[0], segment, slot)) {
+            attach_shm(addrs, segment, connect_timeout, deadline);
+            return;
+        }
+        try {
+            for (size_t i = 0; i < addrs.size(); ++i) {
+                Signer s;
+                s.fd = connect_retry(addrs[i], connect_timeout);
+                s.deadline = deadline;
+                signers_.push_back(s);
+
+                wire_send(s.fd, WIRE_GET_KEYS, 0, std::vector<unsigned char>());
+                WireFrame reply;
+                if (!wire_recv(s.fd, reply) || reply.type != WIRE_KEYS) {
+                    throw std::runtime_error("SignerCoordinator: no key from " + addrs[i]);
+                }
+                std::vector<PublicKey> pk = wire_decode_keys(reply.payload);
+                if (pk.size() != 1) {
+                    throw std::runtime_error("SignerCoordinator: " + addrs[i] + " holds more than one key");
+                }
+                pks_.push_back(pk[0]);
+            }
+        } catch (...) {
+            close_all();
+            throw;
+        }
+    }
+
+    ~SignerCoordinator() {
+        close_all();
+    }
+
+    SignerCoordinator(const SignerCoordinator&) = delete;
+    SignerCoordinator& operator=(const SignerCoordinator&) = delete;
+
+    const std::vector<PublicKey>& pks() const {
+        return pks_;
+    }
+
+    size_t size() const {
+        return signers_.size();
+    }
+
+    void set_deadline(size_t signer, std::chrono::microseconds deadline) {
+        signers_.at(signer).deadline = deadline;
+    }
+
+    // Fans `request` out and collects one share per signer. Returns false if
+    // any signer missed its deadline, failed or is disconnected; their
+    // indices go to `late`.
+    bool gather(const DNTAT_PS::IssuanceRequest& request, std::vector<G1>& s_bars,
+                std::vector<size_t>* late = 0) {
+        using namespace std::chrono;
+        const uint32_t id = next_id_++;
+#ifdef __linux__
+        if (shm_) {
+            return gather_shm(id, request, s_bars, late);
+        }
+#endif
+        const std::vector<unsigned char> payload = wire_encode_request(request);
+        const steady_clock::time_point start = steady_clock::now();
+
+        s_bars.resize(signers_.size());
+        std::vector<bool> done(signers_.size(), false);
+        size_t outstanding = 0;
+        for (size_t i = 0; i < signers_.size(); ++i) {
+            if (signers_[i].fd < 0) {
+                continue;
+            }
+            try {
+                wire_send(signers_[i].fd, WIRE_ISSUE, id, payload);
+                ++outstanding;
+            } catch (const std::exception&) {
+                disconnect(i);
+            }
+        }
+
+        std::vector<pollfd> fds;
+        std::vector<size_t> which;
+        while (outstanding > 0) {
+            const steady_clock::time_point now = steady_clock::now();
+            fds.clear();
+            which.clear();
+            microseconds wait = microseconds::max();
+            for (size_t i = 0; i < signers_.size(); ++i) {
+                if (done[i] || signers_[i].fd < 0) {
+                    continue;
+                }
+                microseconds left = duration_cast<microseconds>(start + signers_[i].deadline - now);
+                if (left <= microseconds::zero()) {
+                    continue;  // past its deadline
+                }
+                wait = std::min(wait, left);
+                pollfd p;
+                p.fd = signers_[i].fd;
+                p.events = POLLIN;
+                p.revents = 0;
+                fds.push_back(p);
+                which.push_back(i);
+            }
+            if (fds.empty()) {
+                break;
+            }
+            int timeout_ms = static_cast<int>((wait.count() + 999) / 1000);
+            int ready = ::poll(fds.data(), fds.size(), timeout_ms);
+            if (ready < 0 && errno != EINTR) {
+                throw std::runtime_error(std::string("SignerCoordinator: poll: ") + std::strerror(errno));
+            }
+            for (size_t k = 0; ready > 0 && k < fds.size(); ++k) {
+                if (fds[k].revents == 0) {
+                    continue;
+                }
+                size_t i = which[k];
+                if (read_share(i, id, s_bars[i])) {
+                    done[i] = true;
+                    --outstanding;
+                } else if (signers_[i].fd < 0) {
+                    --outstanding;
+                }
+            }
+        }
+
+        bool all = true;
+        for (size_t i = 0; i < signers_.size(); ++i) {
+            if (!done[i]) {
+                all = false;
+                if (late) {
+                    late->push_back(i);
+                }
+            }
+        }
+        return all;
+    }
+
+    // Full issuance for the user (sku, pku). Returns false, leaving `token`
+    // untouched, if a signer did not answer in time.
+    bool issue(DNTAT_PS& dntat, const Fr& sku, const G1& pku, Token& token,
+               std::vector<size_t>* late = 0, uint32_t epoch = 0) {
+        DNTAT_PS::IssuanceRequest request;
+        DNTAT_PS::IssuanceSecrets secrets;
+        dntat.issue_request(sku, pku, request, secrets, epoch);
+
+        std::vector<G1> shares;
+        if (!gather(request, shares, late)) {
+            return false;
+        }
+        std::vector<G1> sigma_bars(shares.size());
+        for (size_t i = 0; i < shares.size(); ++i) {
+            DNTAT_PS::unblind_share(pks_[i], secrets, shares[i], sigma_bars[i]);
+        }
+        token = dntat.tokenaggr(sigma_bars, secrets.hbar, secrets.omega, pks_);
+        return true;
+    }
+
+private:
+    struct Signer {
+        int fd;
+        std::chrono::microseconds deadline;
+        std::vector<unsigned char> in;  // bytes of a frame not yet complete
+    };
+
+    void attach_shm(const std::vector<std::string>& addrs, const std::string& segment,
+                    std::chrono::milliseconds connect_timeout, std::chrono::microseconds deadline) {
+#ifdef __linux__
+        using namespace std::chrono;
+        for (size_t i = 0; i < addrs.size(); ++i) {
+            std::string name;
+            size_t slot;
+            if (!shm_parse_address(addrs[i], name, slot) || name != segment || slot != i) {
+                throw std::invalid_argument("SignerCoordinator: shm signers must be " + segment + ":0.." +
+                                            std::to_string(addrs.size() - 1) + ", in order");
+            }
+        }
+        shm_.reset(ShmRing::create(segment, addrs.size()));
+        signers_.resize(addrs.size());
+        pks_.resize(addrs.size());
+        const steady_clock::time_point give_up = steady_clock::now() + connect_timeout;
+        for (size_t i = 0; i < addrs.size(); ++i) {
+            signers_[i].fd = -1;
+            signers_[i].deadline = deadline;
+            while (!shm_->read_key(i, pks_[i])) {
+                if (steady_clock::now() >= give_up) {
+                    throw std::runtime_error("SignerCoordinator: no key from " + addrs[i]);
+                }
+                std::this_thread::sleep_for(milliseconds(1));
+            }
+        }
+#else
+        (void)addrs;
+        (void)connect_timeout;
+        (void)deadline;
+        throw std::invalid_argument("SignerCoordinator: " + segment + ": the shared-memory transport needs Linux");
+#endif
+    }
+
+#ifdef __linux__
+    bool gather_shm(uint32_t id, const DNTAT_PS::IssuanceRequest& request, std::vector<G1>& s_bars,
+                    std::vector<size_t>* late) {
+        using namespace std::chrono;
+        const steady_clock::time_point start = steady_clock::now();
+        s_bars.resize(signers_.size());
+        std::vector<bool> done(signers_.size(), false);
+        std::vector<bool> sent(signers_.size(), false);
+        size_t outstanding = 0;
+        for (size_t i = 0; i < signers_.size(); ++i) {
+            // A full ring means the signer is far behind; count it late.
+            if (shm_->push_request(i, id, request)) {
+                sent[i] = true;
+                ++outstanding;
+            }
+        }
+
+        uint32_t reply_id;
+        size_t slot;
+        G1 share;
+        while (outstanding > 0) {
+            while (shm_->pop_response(reply_id, slot, share)) {
+                if (reply_id == id && slot < done.size() && sent[slot] && !done[slot] &&
+                    steady_clock::now() <= start + signers_[slot].deadline) {
+                    s_bars[slot] = share;
+                    done[slot] = true;
+                    --outstanding;
+                }
+            }
+            if (outstanding == 0) {
+                break;
+            }
+            const steady_clock::time_point now = steady_clock::now();
+            microseconds wait = microseconds::zero();
+            for (size_t i = 0; i < signers_.size(); ++i) {
+                if (sent[i] && !done[i]) {
+                    wait = std::max(wait, duration_cast<microseconds>(start + signers_[i].deadline - now));
+                }
+            }
+            if (wait <= microseconds::zero()) {
+                break;
+            }
+            shm_->wait_response(wait);
+        }
+
+        bool all = true;
+        for (size_t i = 0; i < signers_.size(); ++i) {
+            if (!done[i]) {
+                all = false;
+                if (late) {
+                    late->push_back(i);
+                }
+            }
+        }
+        return all;
+    }
+#endif
+
+    static int connect_retry(const std::string& addr, std::chrono::milliseconds timeout) {
+        using namespace std::chrono;
+        const steady_clock::time_point give_up = steady_clock::now() + timeout;
+        for (;;) {
+            try {
+                return wire_connect(addr);
+            } catch (const std::runtime_error&) {
+                if (steady_clock::now() >= give_up) {
+                    throw;
+                }
+                std::this_thread::sleep_for(milliseconds(10));
+            }
+        }
+    }
+
+    // Reads what is available from signer i. Returns true once the share
+    // for request `id` has arrived; older replies are skipped.
+    bool read_share(size_t i, uint32_t id, G1& s_bar) {
+        Signer& s = signers_[i];
+        unsigned char buf[4096];
+        ssize_t r = ::recv(s.fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            disconnect(i);
+            return false;
+        }
+        if (r > 0) {
+            s.in.insert(s.in.end(), buf, buf + r);
+        }
+        bool found = false;
+        size_t at = 0;
+        try {
+            while (s.in.size() - at >= WIRE_HEADER_BYTES) {
+                uint8_t type;
+                uint32_t frame_id, len;
+                wire_get_header(&s.in[at], type, frame_id, len);
+                if (s.in.size() - at < WIRE_HEADER_BYTES + len) {
+                    break;
+                }
+                if (frame_id == id) {
+                    if (type != WIRE_SHARES) {
+                        throw std::runtime_error("SignerCoordinator: signer refused the request");
+                    }
+                    std::vector<unsigned char> payload(s.in.begin() + at + WIRE_HEADER_BYTES,
+                                                       s.in.begin() + at + WIRE_HEADER_BYTES + len);
+                    std::vector<G1> shares = wire_decode_shares(payload);
+                    if (shares.size() != 1) {
+                        throw std::runtime_error("SignerCoordinator: expected one share");
+                    }
+                    s_bar = shares[0];
+                    found = true;
+                }
+                at += WIRE_HEADER_BYTES + len;
+            }
+        } catch (const std::exception&) {
+            disconnect(i);
+            return false;
+        }
+        s.in.erase(s.in.begin(), s.in.begin() + at);
+        return found;
+    }
+
+    void disconnect(size_t i) {
+        if (signers_[i].fd >= 0) {
+            ::close(signers_[i].fd);
+            signers_[i].fd = -1;
+        }
+        signers_[i].in.clear();
+    }
+
+    void close_all() {
+        for (size_t i = 0; i < signers_.size(); ++i) {
+            disconnect(i);
+        }
+    }
+
+    std::vector<Signer> signers_;
+    std::vector<PublicKey> pks_;
+    uint32_t next_id_;
+#ifdef __linux__
+    std::unique_ptr<ShmRing> shm_;
+#endif
+};
+
+#endif
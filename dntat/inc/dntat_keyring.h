@@ -0,0 +1,114 @@
+#ifndef DNTAT_KEYRING_H
+#define DNTAT_KEYRING_H
+
+#include "dntat_ps.h"
+#include "dntat_artifact.h"
+#include "rcu.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The verifier's key material, replaceable while redemptions run.
+//
+// CommitteeKeys holds everything verify() needs for one committee: the
+// signers' public keys, the aggregated key and a DNTAT_PS with the
+// committee precomputed (built here, or mapped from an artifact). It is
+// built off the verify path and never changed after that. VerifierKeyRing
+// publishes it through an RcuCell (rcu.h). A redemption takes a snapshot,
+// verifies against it without locking and releases it. rotate() swaps in
+// the next committee and returns once no redemption still uses the
+// previous one, which is then freed. Redemptions that started before the
+// swap finish against the old keys; later ones see the new keys. No
+// redemption waits for a rotation.
+
+struct CommitteeKeys {
+    uint64_t version;  // caller-chosen, e.g. a rotation counter
+    std::vector<PublicKey> pks;
+    std::array<G2, 4> apk;
+    std::unique_ptr<DNTATArtifact> artifact;  // declared before dntat, so it outlives it
+    std::unique_ptr<DNTAT_PS> dntat;
+
+    // Precomputes the committee in this process.
+    static std::unique_ptr<CommitteeKeys> build(uint64_t version, const std::vector<PublicKey>& pks) {
+        if (pks.empty()) {
+            throw std::invalid_argument("CommitteeKeys: empty committee");
+        }
+        std::unique_ptr<CommitteeKeys> keys(new CommitteeKeys());
+        keys->version = version;
+        keys->pks = pks;
+        keys->dntat.reset(new DNTAT_PS(static_cast<int>(pks.size())));
+        keys->dntat->precompute(pks);
+        keys->apk = keys->dntat->keyaggr(pks);
+        return keys;
+    }
+
+    // Maps the committee's precomputation from an artifact.
+    static std::unique_ptr<CommitteeKeys> load(uint64_t version, const std::string& artifact_path) {
+        std::unique_ptr<CommitteeKeys> keys(new CommitteeKeys());
+        keys->version = version;
+        keys->artifact.reset(new DNTATArtifact(artifact_path));
+        keys->pks.assign(keys->artifact->keys(), keys->artifact->keys() + keys->artifact->num_signers());
+        keys->dntat.reset(new DNTAT_PS(*keys->artifact));
+        std::copy(keys->artifact->apk(), keys->artifact->apk() + 4, keys->apk.begin());
+        return keys;
+    }
+
+    // Memory this entry keeps resident, a mapped artifact counted whole.
+    size_t bytes() const {
+        size_t precomputed = artifact ? artifact->file_bytes() : dntat->precomputed_bytes();
+        return sizeof(*this) + sizeof(DNTAT_PS) + pks.size() * sizeof(PublicKey) + precomputed;
+    }
+
+private:
+    CommitteeKeys() : version(0) {}
+};
+
+class VerifierKeyRing {
+public:
+    typedef RcuCell<CommitteeKeys>::ReadGuard Snapshot;
+
+    explicit VerifierKeyRing(std::unique_ptr<CommitteeKeys> keys) : keys_(checked(std::move(keys))) {}
+
+    // The current committee; stays valid, even across rotate(), until the
+    // snapshot is destroyed. Keep it for one redemption, not longer.
+    Snapshot snapshot() const {
+        return keys_.read();
+    }
+
+    bool verify(const Token& token, const Fr& sku) const {
+        Snapshot keys = snapshot();
+        return keys->dntat->verify(token, keys->apk, sku);
+    }
+
+    // With a spent-token store: any of the stores DNTAT_PS::verify takes.
+    template<class Store>
+    bool verify(const Token& token, const Fr& sku, Store& spent) const {
+        Snapshot keys = snapshot();
+        return keys->dntat->verify(token, keys->apk, sku, spent);
+    }
+
+    // Makes `next` the current committee and frees the previous one once
+    // the redemptions still using it are done; blocks until then, so call
+    // it from a background thread, not from one holding a snapshot.
+    void rotate(std::unique_ptr<CommitteeKeys> next) {
+        keys_.publish(checked(std::move(next)));
+    }
+
+private:
+    static std::unique_ptr<CommitteeKeys> checked(std::unique_ptr<CommitteeKeys> keys) {
+        if (!keys) {
+            throw std::invalid_argument("VerifierKeyRing: no keys");
+        }
+        return keys;
+    }
+
+    RcuCell<CommitteeKeys> keys_;
+};
+
+#endif
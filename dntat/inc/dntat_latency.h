@@ -0,0 +1,94 @@
+#ifndef DNTAT_LATENCY_H
+#define DNTAT_LATENCY_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+// Injected reply latency for simulated signers, parsed from a spec string:
+//
+//   none                       no delay
+//   const:<ms>                 fixed delay
+//   lognormal:<median_ms>,<s>  exp(ln(median) + s * N(0,1))
+//   pareto:<min_ms>,<alpha>    min / U^(1/alpha); heavy-tailed, the mean
+//                              is infinite for alpha <= 1
+//
+// One sample stands for the whole network round trip of one signer reply.
+
+class LatencyModel {
+public:
+    LatencyModel() : kind_(NONE), a_(0), b_(0) {}
+
+    explicit LatencyModel(const std::string& spec) : kind_(NONE), a_(0), b_(0) {
+        if (spec.empty() || spec == "none") {
+            return;
+        }
+        size_t colon = spec.find(':');
+        if (colon == std::string::npos) {
+            throw std::invalid_argument("LatencyModel: expected <kind>:<params>, got " + spec);
+        }
+        std::string kind = spec.substr(0, colon);
+        const char* p = spec.c_str() + colon + 1;
+        char* end;
+        a_ = std::strtod(p, &end);
+        if (*end == ',') {
+            b_ = std::strtod(end + 1, &end);
+        }
+        if (kind == "const") {
+            kind_ = CONSTANT;
+        } else if (kind == "lognormal") {
+            kind_ = LOGNORMAL;
+        } else if (kind == "pareto") {
+            kind_ = PARETO;
+            if (b_ <= 0) {
+                throw std::invalid_argument("LatencyModel: pareto needs alpha > 0");
+            }
+        } else {
+            throw std::invalid_argument("LatencyModel: unknown distribution " + kind);
+        }
+        if (a_ < 0) {
+            throw std::invalid_argument("LatencyModel: negative latency in " + spec);
+        }
+    }
+
+    bool none() const {
+        return kind_ == NONE;
+    }
+
+    template<class Rng>
+    std::chrono::microseconds sample(Rng& rng) const {
+        double ms = 0;
+        switch (kind_) {
+        case NONE:
+            break;
+        case CONSTANT:
+            ms = a_;
+            break;
+        case LOGNORMAL: {
+            std::normal_distribution<double> normal(0.0, 1.0);
+            ms = a_ * std::exp(b_ * normal(rng));
+            break;
+        }
+        case PARETO: {
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            double u = 1.0 - uniform(rng);  // (0, 1]
+            ms = a_ / std::pow(u, 1.0 / b_);
+            break;
+        }
+        }
+        // Cap at an hour so a pareto draw cannot overflow the duration.
+        return std::chrono::microseconds(static_cast<long long>(std::min(ms, 3.6e6) * 1000));
+    }
+
+private:
+    enum Kind { NONE, CONSTANT, LOGNORMAL, PARETO };
+    Kind kind_;
+    double a_;
+    double b_;
+};
+
+#endif
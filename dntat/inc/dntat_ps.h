@@ -1,14 +1,18 @@
 #ifndef DNTAT_PS_H
 #define DNTAT_PS_H
 
-#include <mcl/bn256.hpp>
+#include "curve.h"
+#include "arena.h"
+#include "fixed_base.h"
+#include "nullifier_store.h"
+#include "persistent_nullifier_store.h"
+#include "epoch_nullifier_store.h"
+#include "filtered_nullifier_store.h"
 #include <array>
 #include <vector>
 #include <string>
 #include <memory>
 
-using namespace mcl::bn256;
-
 struct PublicKey {
     std::array<G1, 4> g1_keys;
     std::array<G2, 4> g2_keys;
@@ -24,37 +28,148 @@ struct Token {
     G1 sigma;
 };
 
+class DNTATArtifact;
+
 class DNTAT_PS {
 private:
     G1 g1;
     G2 g2;
     int num_signers;
     
+    // Startup precomputation, filled by precompute() or taken from an
+    // artifact: multiples of g1, the Miller-loop lines of g2 (owned, or
+    // inside the artifact's mapping), and one committee's MuSig
+    // coefficients and aggregated key, reused whenever that committee's
+    // keys are passed in.
+    FixedBaseTable<G1> g1_table;
+    std::vector<Fp6> g2_lines;
+    const Fp6* g2_lines_mapped;
+    std::vector<PublicKey> committee;
+    std::vector<Fr> committee_a;
+    std::array<G2, 4> committee_apk;
+    
+    friend class DNTATArtifact;
+    
+    void mul_g1(G1& z, const Fr& k) const;
+    const Fp6* lines() const;
+    bool is_committee(const std::vector<PublicKey>& pks) const;
+    void sigma2_of(G2& sigma2, const Token& token, const std::array<G2, 4>& apk, const Fr& sku) const;
+    
     void hashToG2(G2& P, const std::string& m);
     void hashToFr(Fr& f, const void* data, size_t size);
     Fr H_agg(const std::vector<PublicKey>& pks, const G2& pk_i);
-    std::vector<Fr> compute_a(const std::vector<PublicKey>& pks);
+    void compute_a(const std::vector<PublicKey>& pks, Fr* a);
+    
+    void sign_impl(
+        const std::vector<SecretKey>& sks,
+        const std::vector<PublicKey>& pks,
+        const Fr& sku,
+        const G1& pku,
+        G1* sigma_bars,
+        G1& hbar,
+        Fr& omega,
+        uint32_t epoch
+    );
+    
+    Token tokenaggr_impl(
+        const G1* sigma_bars,
+        const G1& hbar,
+        const Fr& omega,
+        const std::vector<PublicKey>& pks
+    );
 
 public:
     void hashToG1(G1& P, const std::string& m);
     DNTAT_PS(int num_signers);
     
+    // Takes the generators and all of precompute(pks) from a mapped
+    // artifact (dntat_artifact.h), which must outlive this object.
+    explicit DNTAT_PS(const DNTATArtifact& artifact);
+    
+    // Builds the fixed-base table for g1 (keygen and issue_request()) and
+    // the lines for g2 (verify()). With the committee's keys it also caches
+    // their MuSig coefficients and aggregated key for keyaggr() and
+    // tokenaggr(). Not thread-safe; call before sharing the object.
+    void precompute();
+    void precompute(const std::vector<PublicKey>& pks);
+    
     std::pair<PublicKey, SecretKey> S_keygen();
     std::pair<G1, Fr> U_keygen();
     
     std::array<G2, 4> keyaggr(const std::vector<PublicKey>& pks);
     
-    struct SignResult {
-        std::vector<G1> sigma_bars;
+    // Issuance split by party, for deployments where the signers are
+    // separate servers. The user blinds its attributes into T_1..T_4 (the
+    // request); signer i answers with s_bar_i = sum_j sk_i[j] T_j using only
+    // its own key; the user unblinds each share with that signer's public key
+    // and aggregates the results with tokenaggr(). sign() runs all three.
+    struct IssuanceRequest {
+        std::array<G1, 4> T;
+    };
+    
+    struct IssuanceSecrets {
+        G1 hbar;
+        Fr omega;
+        Fr theta;
+        Fr sku;
+        Fr r_2, r_3, r_4, r_5;
+    };
+    
+    void issue_request(
+        const Fr& sku,
+        const G1& pku,
+        IssuanceRequest& request,
+        IssuanceSecrets& secrets,
+        uint32_t epoch = 0
+    );
+    
+    static void sign_share(const SecretKey& sk, const IssuanceRequest& request, G1& s_bar);
+    
+    static void unblind_share(
+        const PublicKey& pk,
+        const IssuanceSecrets& secrets,
+        const G1& s_bar,
+        G1& sigma_bar
+    );
+    
+    // Tokens carry an epoch in the top bits of omega: omega = epoch * 2^192
+    // + a fresh 192-bit random value. The user picks omega and only sends it
+    // blinded in T_4, so the epoch is chosen by the client, not by the
+    // issuers; sign_share() never sees it. It lets an honest client's tokens
+    // expire, but issuers cannot enforce expiry: a client may request a token
+    // for any epoch, e.g. a far-future one that stays redeemable later.
+    static uint32_t epoch_of(const Token& token);
+    
+    template<class Alloc>
+    struct BasicSignResult {
+        std::vector<G1, Alloc> sigma_bars;
         G1 hbar;
         Fr omega;
+        
+        explicit BasicSignResult(const Alloc& alloc = Alloc()) : sigma_bars(alloc) {}
     };
     
+    typedef BasicSignResult<std::allocator<G1> > SignResult;
+    
+    // Result whose shares live in the calling thread's arena; only valid
+    // inside the ArenaScope that was open when sign() filled it.
+    typedef BasicSignResult<ArenaAllocator<G1> > ArenaSignResult;
+    
     SignResult sign(
         const std::vector<SecretKey>& sks,
         const std::vector<PublicKey>& pks,
         const Fr& sku,
-        const G1& pku
+        const G1& pku,
+        uint32_t epoch = 0
+    );
+    
+    void sign(
+        const std::vector<SecretKey>& sks,
+        const std::vector<PublicKey>& pks,
+        const Fr& sku,
+        const G1& pku,
+        ArenaSignResult& result,
+        uint32_t epoch = 0
     );
     
     Token tokenaggr(
@@ -64,11 +179,67 @@ public:
         const std::vector<PublicKey>& pks
     );
     
+    Token tokenaggr(
+        const ArenaVector<G1>& sigma_bars,
+        const G1& hbar,
+        const Fr& omega,
+        const std::vector<PublicKey>& pks
+    );
+    
     bool verify(
         const Token& token,
         const std::array<G2, 4>& apk,
         const Fr& sku
-    );
+    ) const;
+    
+    // Verifies k tokens under the same apk at once, token i with skus[i]:
+    // one random linear combination of the k equations, so k + 1 Miller
+    // loops and one final exponentiation. false if any token is invalid,
+    // except with probability 1/r; check them one by one to find which. No
+    // double-spend check.
+    bool verify_batch(
+        const Token* tokens,
+        const Fr* skus,
+        size_t k,
+        const std::array<G2, 4>& apk
+    ) const;
+    
+    // Memory held by the precomputation (table, lines, cached committee).
+    size_t precomputed_bytes() const;
+    
+    // verify() plus the double-spend check: a valid token's hbar is recorded
+    // in spent, and a token whose hbar is already there is rejected.
+    bool verify(
+        const Token& token,
+        const std::array<G2, 4>& apk,
+        const Fr& sku,
+        NullifierStore& spent
+    ) const;
+    
+    // Same, against the on-disk store; returns once the spend is durable.
+    bool verify(
+        const Token& token,
+        const std::array<G2, 4>& apk,
+        const Fr& sku,
+        PersistentNullifierStore& spent
+    ) const;
+    
+    // Same, with a Bloom filter in front of the spent-token table.
+    bool verify(
+        const Token& token,
+        const std::array<G2, 4>& apk,
+        const Fr& sku,
+        FilteredNullifierStore& spent
+    ) const;
+    
+    // Same, for expiring tokens: a token whose epoch is outside the store's
+    // window is rejected before any pairing is computed.
+    bool verify(
+        const Token& token,
+        const std::array<G2, 4>& apk,
+        const Fr& sku,
+        EpochNullifierStore& spent
+    ) const;
 };
 
 #endif
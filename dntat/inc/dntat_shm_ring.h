@@ -0,0 +1,442 @@
+#ifndef DNTAT_SHM_RING_H
+#define DNTAT_SHM_RING_H
+
+#include "dntat_ps.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <climits>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Shared-memory transport between an issuance coordinator and signer
+// processes on the same host (Linux).
+//
+// One POSIX shared-memory segment per coordinator. Each signer slot has a
+// single-producer/single-consumer ring of fixed-size request records
+// (request id and T_1..T_4) written by the coordinator, and all signers
+// answer into one multi-producer/single-consumer ring of (id, signer, s_bar)
+// records read by the coordinator. Group elements are stored in their
+// serialize() encoding in MAX_G1_BYTES / MAX_G2_BYTES fields.
+//
+// A side that finds its ring empty spins briefly and then sleeps on a futex
+// word in the segment; the other side only makes the wake syscall when the
+// sleeper has announced itself, so a busy pipeline runs without syscalls.
+//
+// The coordinator creates the segment (create()); each signer maps it with
+// attach() once the coordinator has marked it ready, publishes its public
+// key in its slot and serves requests from its ring.
+
+class ShmRing {
+public:
+    enum { REQUEST_SLOTS = 64 };
+
+    ~ShmRing() {
+        if (base_) {
+            ::munmap(base_, bytes_);
+        }
+        if (owner_) {
+            ::shm_unlink(name_.c_str());
+        }
+    }
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    // Coordinator: creates a fresh segment for `signers` slots, replacing
+    // any stale one of the same name.
+    static ShmRing* create(const std::string& name, size_t signers) {
+        if (signers == 0 || signers > 1024) {
+            throw std::invalid_argument("ShmRing: bad signer count");
+        }
+        size_t response_slots = 1;
+        while (response_slots < signers * REQUEST_SLOTS) {
+            response_slots <<= 1;
+        }
+        size_t bytes = layout_bytes(signers, response_slots);
+
+        ::shm_unlink(name.c_str());
+        int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            throw std::runtime_error("ShmRing: cannot create " + name + ": " + std::strerror(errno));
+        }
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            int err = errno;
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            throw std::runtime_error(std::string("ShmRing: ftruncate: ") + std::strerror(err));
+        }
+        ShmRing* ring = new ShmRing(name, fd, bytes, true);
+
+        // The segment starts zeroed; only the MPSC sequence numbers and the
+        // sizes need setting before it is published.
+        Header* h = ring->header();
+        h->signers = static_cast<uint32_t>(signers);
+        h->response_slots = static_cast<uint32_t>(response_slots);
+        for (size_t i = 0; i < response_slots; ++i) {
+            ring->response(i).seq.store(static_cast<uint32_t>(i), std::memory_order_relaxed);
+        }
+        h->magic.store(kMagic, std::memory_order_release);
+        return ring;
+    }
+
+    // Signer: maps an existing segment, waiting up to `timeout` for the
+    // coordinator to create it.
+    static ShmRing* attach(const std::string& name, std::chrono::milliseconds timeout) {
+        using namespace std::chrono;
+        const steady_clock::time_point give_up = steady_clock::now() + timeout;
+        for (;;) {
+            int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+            if (fd >= 0) {
+                struct stat st;
+                if (::fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(Header))) {
+                    ShmRing* ring = new ShmRing(name, fd, static_cast<size_t>(st.st_size), false);
+                    if (ring->header()->magic.load(std::memory_order_acquire) == kMagic &&
+                        layout_bytes(ring->signers(), ring->header()->response_slots) <= ring->bytes_) {
+                        return ring;
+                    }
+                    delete ring;
+                } else {
+                    ::close(fd);
+                }
+            }
+            if (steady_clock::now() >= give_up) {
+                throw std::runtime_error("ShmRing: " + name + " not available");
+            }
+            std::this_thread::sleep_for(milliseconds(10));
+        }
+    }
+
+    size_t signers() const {
+        return header()->signers;
+    }
+
+    // Signer: makes its public key visible to the coordinator.
+    void publish_key(size_t slot, const PublicKey& pk) {
+        SignerSlot& s = signer(slot);
+        unsigned char* p = s.public_key;
+        for (const G1& P : pk.g1_keys) {
+            put(p, P, MAX_G1_BYTES);
+            p += MAX_G1_BYTES;
+        }
+        for (const G2& Q : pk.g2_keys) {
+            put(p, Q, MAX_G2_BYTES);
+            p += MAX_G2_BYTES;
+        }
+        s.ready.store(1, std::memory_order_release);
+    }
+
+    // Coordinator: true once the signer has published its key.
+    bool read_key(size_t slot, PublicKey& pk) {
+        SignerSlot& s = signer(slot);
+        if (s.ready.load(std::memory_order_acquire) == 0) {
+            return false;
+        }
+        const unsigned char* p = s.public_key;
+        for (G1& P : pk.g1_keys) {
+            get(p, P, MAX_G1_BYTES);
+            p += MAX_G1_BYTES;
+        }
+        for (G2& Q : pk.g2_keys) {
+            get(p, Q, MAX_G2_BYTES);
+            p += MAX_G2_BYTES;
+        }
+        return true;
+    }
+
+    // Coordinator: queues a request for one signer. false if its ring is
+    // full, i.e. the signer is REQUEST_SLOTS requests behind.
+    bool push_request(size_t slot, uint32_t id, const DNTAT_PS::IssuanceRequest& request) {
+        SignerSlot& s = signer(slot);
+        uint32_t head = s.head.load(std::memory_order_relaxed);
+        if (head - s.tail.load(std::memory_order_acquire) >= REQUEST_SLOTS) {
+            return false;
+        }
+        RequestRecord& r = s.ring[head % REQUEST_SLOTS];
+        r.id = id;
+        for (int j = 0; j < 4; ++j) {
+            put(r.T[j], request.T[j], MAX_G1_BYTES);
+        }
+        s.head.store(head + 1);
+        if (s.waiting.load() != 0) {
+            futex_wake(&s.head);
+        }
+        return true;
+    }
+
+    // Signer: blocks until the next request for `slot` arrives. A record
+    // that does not decode is consumed and reported by throwing.
+    void pop_request(size_t slot, uint32_t& id, DNTAT_PS::IssuanceRequest& request) {
+        SignerSlot& s = signer(slot);
+        uint32_t tail = s.tail.load(std::memory_order_relaxed);
+        wait_for(s.head, s.waiting, [&]() { return s.head.load(std::memory_order_acquire) != tail; },
+                 std::chrono::microseconds::max());
+        const RequestRecord& r = s.ring[tail % REQUEST_SLOTS];
+        id = r.id;
+        bool ok = true;
+        for (int j = 0; j < 4; ++j) {
+            ok = ok && try_get(r.T[j], request.T[j]);
+        }
+        s.tail.store(tail + 1, std::memory_order_release);
+        if (!ok) {
+            throw std::runtime_error("ShmRing: bad group element");
+        }
+    }
+
+    // Signer: posts its share for request `id`. false if the response ring
+    // stayed full for `timeout`, i.e. the coordinator has stopped draining it
+    // (or is gone); the share is then dropped.
+    bool push_response(size_t slot, uint32_t id, const G1& s_bar, std::chrono::milliseconds timeout) {
+        using namespace std::chrono;
+        Header* h = header();
+        const uint32_t mask = h->response_slots - 1;
+        uint32_t pos = h->enqueue_pos.load(std::memory_order_relaxed);
+        steady_clock::time_point give_up = steady_clock::time_point::max();
+        for (;;) {
+            ResponseRecord& r = response(pos & mask);
+            int32_t dif = static_cast<int32_t>(r.seq.load(std::memory_order_acquire) - pos);
+            if (dif == 0) {
+                if (h->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    r.id = id;
+                    r.signer = static_cast<uint32_t>(slot);
+                    put(r.s_bar, s_bar, MAX_G1_BYTES);
+                    r.seq.store(pos + 1, std::memory_order_release);
+                    break;
+                }
+            } else if (dif < 0) {
+                // Full: the coordinator is not draining. Wait for it, but
+                // not forever.
+                const steady_clock::time_point now = steady_clock::now();
+                if (give_up == steady_clock::time_point::max()) {
+                    give_up = now + timeout;
+                } else if (now >= give_up) {
+                    return false;
+                }
+                std::this_thread::sleep_for(microseconds(50));
+                pos = h->enqueue_pos.load(std::memory_order_relaxed);
+            } else {
+                pos = h->enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        h->signal.fetch_add(1);
+        if (h->waiting.load() != 0) {
+            futex_wake(&h->signal);
+        }
+        return true;
+    }
+
+    // Coordinator: takes one response if there is one.
+    bool pop_response(uint32_t& id, size_t& slot, G1& s_bar) {
+        Header* h = header();
+        uint32_t pos = h->dequeue_pos;
+        ResponseRecord& r = response(pos & (h->response_slots - 1));
+        if (r.seq.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        id = r.id;
+        slot = r.signer;
+        get(r.s_bar, s_bar, MAX_G1_BYTES);
+        r.seq.store(pos + h->response_slots, std::memory_order_release);
+        h->dequeue_pos = pos + 1;
+        return true;
+    }
+
+    // Coordinator: waits up to `timeout` for a response to be posted.
+    void wait_response(std::chrono::microseconds timeout) {
+        Header* h = header();
+        const uint32_t mask = h->response_slots - 1;
+        wait_for(h->signal, h->waiting, [&]() {
+            return response(h->dequeue_pos & mask).seq.load(std::memory_order_acquire) == h->dequeue_pos + 1;
+        }, timeout);
+    }
+
+private:
+    static const uint64_t kMagic = 0x31474e4952544e44ULL;  // "DNTRING1"
+    enum { kSpin = 256 };
+
+    struct Header {
+        std::atomic<uint64_t> magic;
+        uint32_t signers;
+        uint32_t response_slots;
+        alignas(64) std::atomic<uint32_t> enqueue_pos;
+        alignas(64) uint32_t dequeue_pos;
+        std::atomic<uint32_t> signal;   // futex word: bumped per response
+        std::atomic<uint32_t> waiting;  // coordinator asleep on signal
+    };
+
+    struct RequestRecord {
+        uint32_t id;
+        unsigned char T[4][MAX_G1_BYTES];
+    };
+
+    struct SignerSlot {
+        alignas(64) std::atomic<uint32_t> head;  // futex word: requests written
+        std::atomic<uint32_t> waiting;           // signer asleep on head
+        alignas(64) std::atomic<uint32_t> tail;  // requests taken
+        std::atomic<uint32_t> ready;
+        unsigned char public_key[4 * MAX_G1_BYTES + 4 * MAX_G2_BYTES];
+        RequestRecord ring[REQUEST_SLOTS];
+    };
+
+    struct alignas(64) ResponseRecord {
+        std::atomic<uint32_t> seq;
+        uint32_t id;
+        uint32_t signer;
+        unsigned char s_bar[MAX_G1_BYTES];
+    };
+
+    ShmRing(const std::string& name, int fd, size_t bytes, bool owner)
+        : name_(name), bytes_(bytes), owner_(owner), base_(0) {
+        void* p = ::mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            if (owner) {
+                ::shm_unlink(name.c_str());
+            }
+            throw std::runtime_error(std::string("ShmRing: mmap: ") + std::strerror(errno));
+        }
+        base_ = static_cast<unsigned char*>(p);
+    }
+
+    static size_t slots_offset() {
+        return (sizeof(Header) + 63) & ~size_t(63);
+    }
+
+    static size_t responses_offset(size_t signers) {
+        return slots_offset() + signers * sizeof(SignerSlot);
+    }
+
+    static size_t layout_bytes(size_t signers, size_t response_slots) {
+        return responses_offset(signers) + response_slots * sizeof(ResponseRecord);
+    }
+
+    Header* header() const {
+        return reinterpret_cast<Header*>(base_);
+    }
+
+    SignerSlot& signer(size_t slot) {
+        if (slot >= signers()) {
+            throw std::out_of_range("ShmRing: no such signer slot");
+        }
+        return reinterpret_cast<SignerSlot*>(base_ + slots_offset())[slot];
+    }
+
+    ResponseRecord& response(size_t i) {
+        return reinterpret_cast<ResponseRecord*>(base_ + responses_offset(signers()))[i];
+    }
+
+    template<class T>
+    static void put(unsigned char* dst, const T& x, size_t max) {
+        if (x.serialize(dst, max) == 0) {
+            throw std::runtime_error("ShmRing: serialize failed");
+        }
+    }
+
+    template<class T>
+    static void get(const unsigned char* src, T& x, size_t max) {
+        if (x.deserialize(src, max) == 0) {
+            throw std::runtime_error("ShmRing: bad group element");
+        }
+    }
+
+    static bool try_get(const unsigned char* src, G1& x) {
+        return x.deserialize(src, MAX_G1_BYTES) != 0;
+    }
+
+    static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    }
+
+    static void futex_wait(std::atomic<uint32_t>* word, uint32_t expected, const timespec* timeout) {
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, timeout, 0, 0);
+    }
+
+    static void futex_wake(std::atomic<uint32_t>* word) {
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, 0, 0, 0);
+    }
+
+    // Spins on `ready`, then sleeps on `word` with `waiting` raised. The
+    // waker bumps or stores `word` before reading `waiting` (both seq_cst),
+    // and the sleeper raises `waiting` before reading `word`, so either the
+    // sleeper sees the new value or the waker sees it waiting.
+    template<class Ready>
+    static void wait_for(std::atomic<uint32_t>& word, std::atomic<uint32_t>& waiting, Ready ready,
+                         std::chrono::microseconds timeout) {
+        using namespace std::chrono;
+        for (int i = 0; i < kSpin; ++i) {
+            if (ready()) {
+                return;
+            }
+            cpu_relax();
+        }
+        const steady_clock::time_point give_up = timeout == microseconds::max()
+            ? steady_clock::time_point::max() : steady_clock::now() + timeout;
+        for (;;) {
+            waiting.store(1);
+            uint32_t seen = word.load();
+            if (ready()) {
+                break;
+            }
+            if (timeout == microseconds::max()) {
+                futex_wait(&word, seen, 0);
+            } else {
+                microseconds left = duration_cast<microseconds>(give_up - steady_clock::now());
+                if (left <= microseconds::zero()) {
+                    break;
+                }
+                timespec ts;
+                ts.tv_sec = static_cast<time_t>(left.count() / 1000000);
+                ts.tv_nsec = static_cast<long>(left.count() % 1000000) * 1000;
+                futex_wait(&word, seen, &ts);
+            }
+            if (ready()) {
+                break;
+            }
+        }
+        waiting.store(0);
+    }
+
+    std::string name_;
+    size_t bytes_;
+    bool owner_;
+    unsigned char* base_;
+};
+
+#endif  // __linux__
+
+// "shm:<segment>:<slot>" names signer <slot> of a shared-memory segment.
+inline bool shm_parse_address(const std::string& addr, std::string& segment, size_t& slot) {
+    if (addr.compare(0, 4, "shm:") != 0) {
+        return false;
+    }
+    size_t colon = addr.rfind(':');
+    if (colon <= 4 || colon + 1 >= addr.size()) {
+        throw std::invalid_argument("shm address must be shm:<segment>:<slot>");
+    }
+    segment = addr.substr(4, colon - 4);
+    if (segment[0] != '/') {
+        segment = "/" + segment;
+    }
+    slot = static_cast<size_t>(std::strtoul(addr.c_str() + colon + 1, 0, 10));
+    return true;
+}
+
+#endif
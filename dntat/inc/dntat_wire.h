@@ -0,0 +1,278 @@
+#ifndef DNTAT_WIRE_H
+#define DNTAT_WIRE_H
+
+#include "dntat_ps.h"
+#include "dntat_codec.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // macOS: SO_NOSIGPIPE is set on the socket instead
+#endif
+
+// Framing shared by the DNTAT issuance servers and their clients.
+//
+// A frame is a 9-byte header -- payload length (u32), message type (u8) and
+// a request id (u32) chosen by the client and echoed in the reply, all
+// little-endian -- followed by the payload. Payloads are messages in the
+// wire format of wire_format.h (dntat_codec.h), so a receiver checks their
+// length from the header before decoding any element. Keys and shares come
+// from the deployment's own signers and are decoded as trusted; requests
+// carry the user's points and are not.
+//
+// Addresses are "unix:<path>" or "<host>:<port>" (TCP).
+
+enum WireType : uint8_t {
+    WIRE_GET_KEYS = 1,  // -> WIRE_KEYS
+    WIRE_KEYS = 2,      // n PublicKey messages, back to back
+    WIRE_ISSUE = 3,     // IssuanceRequest message -> WIRE_SHARES
+    WIRE_SHARES = 4,    // ShareList message, in key order
+    WIRE_ERROR = 5      // UTF-8 message
+};
+
+enum { WIRE_HEADER_BYTES = 9, WIRE_MAX_PAYLOAD = 1 << 20 };
+
+struct WireFrame {
+    uint8_t type;
+    uint32_t id;
+    std::vector<unsigned char> payload;
+};
+
+inline void wire_put_header(unsigned char* h, uint8_t type, uint32_t id, uint32_t len) {
+    for (int i = 0; i < 4; ++i) {
+        h[i] = static_cast<unsigned char>(len >> (8 * i));
+        h[5 + i] = static_cast<unsigned char>(id >> (8 * i));
+    }
+    h[4] = type;
+}
+
+inline void wire_get_header(const unsigned char* h, uint8_t& type, uint32_t& id, uint32_t& len) {
+    len = 0;
+    id = 0;
+    for (int i = 0; i < 4; ++i) {
+        len |= static_cast<uint32_t>(h[i]) << (8 * i);
+        id |= static_cast<uint32_t>(h[5 + i]) << (8 * i);
+    }
+    type = h[4];
+    if (len > WIRE_MAX_PAYLOAD) {
+        throw std::runtime_error("wire: frame too large");
+    }
+}
+
+// Appends one whole frame to `out`.
+inline void wire_append_frame(std::vector<unsigned char>& out, uint8_t type, uint32_t id,
+                              const std::vector<unsigned char>& payload) {
+    size_t at = out.size();
+    out.resize(at + WIRE_HEADER_BYTES);
+    wire_put_header(&out[at], type, id, static_cast<uint32_t>(payload.size()));
+    out.insert(out.end(), payload.begin(), payload.end());
+}
+
+// Blocking helpers, for clients and one-connection-per-thread servers.
+
+inline void wire_write_all(int fd, const unsigned char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = ::send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("wire: send: ") + std::strerror(errno));
+        }
+        p += w;
+        n -= w;
+    }
+}
+
+// false on a clean end of stream before any byte was read.
+inline bool wire_read_all(int fd, unsigned char* p, size_t n) {
+    size_t got = 0;
+    while (got < n) {
+        ssize_t r = ::recv(fd, p + got, n - got, 0);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("wire: recv: ") + std::strerror(errno));
+        }
+        if (r == 0) {
+            if (got == 0) {
+                return false;
+            }
+            throw std::runtime_error("wire: connection closed mid-frame");
+        }
+        got += r;
+    }
+    return true;
+}
+
+inline void wire_send(int fd, uint8_t type, uint32_t id, const std::vector<unsigned char>& payload) {
+    std::vector<unsigned char> frame;
+    frame.reserve(WIRE_HEADER_BYTES + payload.size());
+    wire_append_frame(frame, type, id, payload);
+    wire_write_all(fd, frame.data(), frame.size());
+}
+
+// false when the peer closed the connection between frames.
+inline bool wire_recv(int fd, WireFrame& frame) {
+    unsigned char h[WIRE_HEADER_BYTES];
+    if (!wire_read_all(fd, h, sizeof(h))) {
+        return false;
+    }
+    uint32_t len;
+    wire_get_header(h, frame.type, frame.id, len);
+    frame.payload.resize(len);
+    if (len > 0 && !wire_read_all(fd, frame.payload.data(), len)) {
+        throw std::runtime_error("wire: connection closed mid-frame");
+    }
+    return true;
+}
+
+// Message bodies.
+
+inline std::vector<unsigned char> wire_encode_keys(const std::vector<PublicKey>& pks) {
+    std::vector<unsigned char> out;
+    for (const PublicKey& pk : pks) {
+        std::vector<unsigned char> one = wire_encode(pk);
+        out.insert(out.end(), one.begin(), one.end());
+    }
+    return out;
+}
+
+inline std::vector<PublicKey> wire_decode_keys(const std::vector<unsigned char>& payload) {
+    const WireSchema& schema = wire_schema<PublicKey>();
+    const size_t each = schema.header_bytes() + schema.fixed_bytes(WireSizes());
+    size_t n = payload.size() / each;
+    if (n == 0 || n > 1024 || payload.size() != n * each) {
+        throw std::runtime_error("wire: bad key list");
+    }
+    std::vector<PublicKey> pks(n);
+    for (size_t i = 0; i < n; ++i) {
+        wire_decode(payload.data() + i * each, each, pks[i], WIRE_TRUSTED);
+    }
+    return pks;
+}
+
+inline std::vector<unsigned char> wire_encode_request(const DNTAT_PS::IssuanceRequest& req) {
+    return wire_encode(req);
+}
+
+inline DNTAT_PS::IssuanceRequest wire_decode_request(const unsigned char* p, size_t n,
+                                                     WireTrust trust = WIRE_UNTRUSTED) {
+    DNTAT_PS::IssuanceRequest req;
+    wire_decode(p, n, req, trust);
+    return req;
+}
+
+inline std::vector<unsigned char> wire_encode_shares(const G1* shares, size_t n) {
+    ShareList list;
+    list.s_bars.assign(shares, shares + n);
+    return wire_encode(list);
+}
+
+inline std::vector<G1> wire_decode_shares(const std::vector<unsigned char>& payload) {
+    WireView<ShareList> view(payload.data(), payload.size());
+    if (view.records() > 1024) {
+        throw std::runtime_error("wire: bad share count");
+    }
+    ShareList list;
+    view.decode_all(list, WIRE_TRUSTED);
+    return list.s_bars;
+}
+
+// Sockets.
+
+inline int wire_socket_for(const std::string& addr, sockaddr_storage& ss, socklen_t& len) {
+    std::memset(&ss, 0, sizeof(ss));
+    if (addr.compare(0, 5, "unix:") == 0) {
+        sockaddr_un* un = reinterpret_cast<sockaddr_un*>(&ss);
+        std::string path = addr.substr(5);
+        if (path.size() >= sizeof(un->sun_path)) {
+            throw std::invalid_argument("wire: unix socket path too long");
+        }
+        un->sun_family = AF_UNIX;
+        std::memcpy(un->sun_path, path.c_str(), path.size() + 1);
+        len = sizeof(sockaddr_un);
+        return AF_UNIX;
+    }
+    size_t colon = addr.rfind(':');
+    if (colon == std::string::npos) {
+        throw std::invalid_argument("wire: address must be unix:<path> or <host>:<port>");
+    }
+    std::string host = addr.substr(0, colon);
+    sockaddr_in* in = reinterpret_cast<sockaddr_in*>(&ss);
+    in->sin_family = AF_INET;
+    in->sin_port = htons(static_cast<uint16_t>(std::atoi(addr.c_str() + colon + 1)));
+    if (host.empty() || host == "*") {
+        in->sin_addr.s_addr = htonl(INADDR_ANY);
+    } else if (inet_pton(AF_INET, host == "localhost" ? "127.0.0.1" : host.c_str(), &in->sin_addr) != 1) {
+        throw std::invalid_argument("wire: bad IPv4 address " + host);
+    }
+    len = sizeof(sockaddr_in);
+    return AF_INET;
+}
+
+inline void wire_tune_socket(int fd, int family) {
+    int one = 1;
+    if (family == AF_INET) {
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+#ifdef SO_NOSIGPIPE
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+}
+
+inline int wire_listen(const std::string& addr) {
+    sockaddr_storage ss;
+    socklen_t len;
+    int family = wire_socket_for(addr, ss, len);
+    int fd = ::socket(family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("wire: socket: ") + std::strerror(errno));
+    }
+    if (family == AF_UNIX) {
+        ::unlink(reinterpret_cast<sockaddr_un*>(&ss)->sun_path);
+    } else {
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&ss), len) != 0 || ::listen(fd, 1024) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("wire: cannot listen on " + addr + ": " + std::strerror(err));
+    }
+    return fd;
+}
+
+inline int wire_connect(const std::string& addr) {
+    sockaddr_storage ss;
+    socklen_t len;
+    int family = wire_socket_for(addr, ss, len);
+    int fd = ::socket(family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("wire: socket: ") + std::strerror(errno));
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&ss), len) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("wire: cannot connect to " + addr + ": " + std::strerror(err));
+    }
+    wire_tune_socket(fd, family);
+    return fd;
+}
+
+#endif
@@ -0,0 +1,141 @@
+#include "dntat_ps.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+// Every global operator new in the process goes through here so the
+// benchmark can report heap allocations per request.
+static std::atomic<unsigned long long> heap_allocs(0);
+
+void* operator new(std::size_t size) {
+    heap_allocs.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+struct Fixture {
+    DNTAT_PS* dntat;
+    std::vector<PublicKey> pks;
+    std::vector<SecretKey> sks;
+    std::array<G2, 4> apk;
+    G1 pku;
+    Fr sku;
+};
+
+static bool serve_heap(const Fixture& f) {
+    DNTAT_PS::SignResult sign_result = f.dntat->sign(f.sks, f.pks, f.sku, f.pku);
+    Token token = f.dntat->tokenaggr(sign_result.sigma_bars, sign_result.hbar, sign_result.omega, f.pks);
+    return f.dntat->verify(token, f.apk, f.sku);
+}
+
+static bool serve_arena(const Fixture& f) {
+    ArenaScope scope;
+    DNTAT_PS::ArenaSignResult sign_result;
+    f.dntat->sign(f.sks, f.pks, f.sku, f.pku, sign_result);
+    Token token = f.dntat->tokenaggr(sign_result.sigma_bars, sign_result.hbar, sign_result.omega, f.pks);
+    return f.dntat->verify(token, f.apk, f.sku);
+}
+
+static void run(const char* label, bool (*serve)(const Fixture&), const Fixture& f,
+                int num_threads, int iterations) {
+    std::atomic<int> failures(0);
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads);
+
+    // One untimed request per worker first, so each thread's arena already
+    // holds its blocks when measurement starts.
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    unsigned long long allocs_before = 0;
+    steady_clock::time_point start;
+
+    for (int t = 0; t < num_threads; ++t) {
+        workers.emplace_back([&]() {
+            serve(f);
+            ready.fetch_add(1);
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            for (int i = 0; i < iterations; ++i) {
+                if (!serve(f)) {
+                    failures.fetch_add(1);
+                }
+            }
+        });
+    }
+
+    while (ready.load() < num_threads) {
+        std::this_thread::yield();
+    }
+    allocs_before = heap_allocs.load();
+    start = steady_clock::now();
+    go.store(true);
+
+    for (auto& w : workers) {
+        w.join();
+    }
+    auto end = steady_clock::now();
+    unsigned long long allocs = heap_allocs.load() - allocs_before;
+
+    double total_ms = duration<double, std::milli>(end - start).count();
+    double requests = static_cast<double>(num_threads) * iterations;
+
+    std::cout << label << ":" << std::endl;
+    std::cout << "  Total time: " << std::fixed << std::setprecision(2) << total_ms << " ms" << std::endl;
+    std::cout << "  Throughput: ~" << std::fixed << std::setprecision(0)
+              << requests * 1000.0 / total_ms << " requests/second" << std::endl;
+    std::cout << "  Heap allocations per request: " << std::fixed << std::setprecision(2)
+              << allocs / requests << std::endl;
+    if (failures.load() != 0) {
+        std::cout << "  Verification failures: " << failures.load() << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::string curve = take_curve_arg(argc, argv);
+    if (!init_curve(curve)) {
+        return 1;
+    }
+
+    int num_threads = argc > 1 ? std::atoi(argv[1]) : 32;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 100;
+    int num_signers = argc > 3 ? std::atoi(argv[3]) : 1;
+
+    DNTAT_PS dntat(num_signers);
+
+    Fixture f;
+    f.dntat = &dntat;
+    for (int i = 0; i < num_signers; ++i) {
+        auto keypair = dntat.S_keygen();
+        f.pks.push_back(keypair.first);
+        f.sks.push_back(keypair.second);
+    }
+    auto user_keypair = dntat.U_keygen();
+    f.pku = user_keypair.first;
+    f.sku = user_keypair.second;
+    f.apk = dntat.keyaggr(f.pks);
+
+    std::cout << "=== Request allocation benchmark ===" << std::endl;
+    std::cout << "Threads: " << num_threads << ", requests per thread: " << iterations
+              << ", signers: " << num_signers << std::endl;
+    std::cout << "Each request: sign + tokenaggr + verify\n" << std::endl;
+
+    run("Global heap", serve_heap, f, num_threads, iterations);
+    run("Per-thread arena", serve_arena, f, num_threads, iterations);
+
+    return 0;
+}
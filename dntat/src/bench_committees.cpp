@@ -0,0 +1,244 @@
+#include "dntat_ps.h"
+#include "dntat_bench.h"
+#include "dntat_committee_cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+// A relying party that accepts tokens from many DNTAT committees, with a
+// CommitteeCache that holds only some of them.
+//
+// Every committee issues a few tokens up front. Redemptions then pick a
+// committee from a Zipf distribution (--skew; 0 is uniform), so a few
+// committees are hot and the rest form a long tail that competes for the
+// budget of --budget entries. The resolver stands in for a directory
+// service and takes --resolve-ms per lookup.
+//
+//   1. single flight: all threads look up the same cold committee at once;
+//      exactly one of them must build it
+//   2. concurrent redemptions, one get() + verify() each: throughput and
+//      hit rate as threads are added
+//   3. the same stream in batches of --batch through verify_batch(), which
+//      groups by committee, against verifying one by one; a forged token
+//      in the batch must be caught and nothing else refused
+//
+// Usage: bench_committees [--curve bn254|bls12_381|bn462] [--committees 24] [--signers 4]
+//                         [--budget 8] [--skew 1.0] [--threads 8] [--redemptions 2000]
+//                         [--batch 64] [--resolve-ms 2]
+
+namespace {
+
+struct Options {
+    int committees = 24;
+    int signers = 4;
+    int budget = 8;
+    double skew = 1.0;
+    int threads = 8;
+    int redemptions = 2000;
+    int batch = 64;
+    int resolve_ms = 2;
+};
+
+struct Committee : BenchCommittee {
+    CommitteeId id;
+};
+
+const int kTokensPerCommittee = 4;
+
+std::vector<Committee> make_committees(const Options& opt, const std::pair<G1, Fr>& user) {
+    std::vector<Committee> committees(opt.committees);
+    for (Committee& c : committees) {
+        static_cast<BenchCommittee&>(c) = make_committee(opt.signers, user, kTokensPerCommittee);
+        c.id = committee_id(c.pks);
+    }
+    return committees;
+}
+
+// Committee indices drawn with P(k) proportional to 1 / (k + 1)^skew.
+std::vector<int> zipf_stream(int committees, double skew, int count, uint64_t seed) {
+    std::vector<double> weights(committees);
+    for (int k = 0; k < committees; ++k) {
+        weights[k] = 1.0 / std::pow(k + 1.0, skew);
+    }
+    std::mt19937_64 rng(seed);
+    std::discrete_distribution<int> pick(weights.begin(), weights.end());
+    std::vector<int> stream(count);
+    for (int& k : stream) {
+        k = pick(rng);
+    }
+    return stream;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::string curve = take_curve_arg(argc, argv);
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        const char* value = argv[i + 1];
+        if (flag == "--committees") {
+            opt.committees = std::atoi(value);
+        } else if (flag == "--signers") {
+            opt.signers = std::atoi(value);
+        } else if (flag == "--budget") {
+            opt.budget = std::atoi(value);
+        } else if (flag == "--skew") {
+            opt.skew = std::atof(value);
+        } else if (flag == "--threads") {
+            opt.threads = std::atoi(value);
+        } else if (flag == "--redemptions") {
+            opt.redemptions = std::atoi(value);
+        } else if (flag == "--batch") {
+            opt.batch = std::atoi(value);
+        } else if (flag == "--resolve-ms") {
+            opt.resolve_ms = std::atoi(value);
+        } else {
+            std::cerr << "unknown option " << flag << std::endl;
+            return 1;
+        }
+    }
+    if (opt.committees < 1 || opt.signers < 1 || opt.budget < 1 || opt.threads < 1 || opt.redemptions < 1 ||
+        opt.batch < 1 || opt.skew < 0 || opt.resolve_ms < 0) {
+        std::cerr << "all options must be positive (--skew and --resolve-ms may be 0)" << std::endl;
+        return 1;
+    }
+
+    if (!init_curve(curve)) {
+        return 1;
+    }
+    DNTAT_PS user_side(opt.signers);
+    auto user = user_side.U_keygen();
+    std::vector<Committee> committees = make_committees(opt, user);
+
+    std::map<CommitteeId, const Committee*> directory;
+    for (const Committee& c : committees) {
+        directory[c.id] = &c;
+    }
+    CommitteeCache::Resolver resolve = [&](const CommitteeId& id) {
+        std::this_thread::sleep_for(milliseconds(opt.resolve_ms));
+        auto it = directory.find(id);
+        if (it == directory.end()) {
+            throw std::runtime_error("unknown committee");
+        }
+        return it->second->pks;
+    };
+    const size_t entry_bytes = CommitteeKeys::build(0, committees[0].pks)->bytes();
+    const size_t budget = opt.budget * entry_bytes;
+
+    std::cout << "=== DNTAT verifier cache: " << opt.committees << " committees of " << opt.signers
+              << " signers, budget " << opt.budget << " entries (" << budget / 1024 << " KiB), skew "
+              << opt.skew << " ===" << std::endl;
+
+    // 1. Single flight.
+    {
+        CommitteeCache cache(budget, resolve);
+        std::atomic<bool> go(false);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < opt.threads; ++t) {
+            threads.emplace_back([&]() {
+                while (!go.load()) {
+                    std::this_thread::yield();
+                }
+                cache.get(committees[0].id);
+            });
+        }
+        go.store(true);
+        for (auto& th : threads) {
+            th.join();
+        }
+        CommitteeCache::Stats s = cache.stats();
+        std::cout << opt.threads << " concurrent lookups of one cold committee: " << s.misses << " build, "
+                  << s.waits << " joined it, " << s.hits << " hits" << std::endl;
+    }
+
+    // 2. Concurrent redemptions, one at a time.
+    std::vector<int> stream = zipf_stream(opt.committees, opt.skew, opt.redemptions, 1);
+    std::cout << std::endl;
+    std::cout << std::left << std::setw(9) << "Threads" << std::right << std::setw(14) << "redeem/s"
+              << std::setw(10) << "hit rate" << std::setw(8) << "builds" << std::setw(8) << "joined"
+              << std::setw(11) << "evictions" << std::setw(9) << "entries" << std::setw(8) << "failed"
+              << std::endl;
+    for (int threads = 1; threads <= opt.threads; threads *= 2) {
+        CommitteeCache cache(budget, resolve);
+        std::atomic<int> next(0), failed(0);
+        auto start = steady_clock::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&]() {
+                for (int i; (i = next.fetch_add(1)) < opt.redemptions;) {
+                    const Committee& c = committees[stream[i]];
+                    std::shared_ptr<const CommitteeKeys> keys = cache.get(c.id);
+                    if (!keys->dntat->verify(c.tokens[i % kTokensPerCommittee], keys->apk, user.second)) {
+                        failed.fetch_add(1);
+                    }
+                }
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+        double seconds = duration<double>(steady_clock::now() - start).count();
+        CommitteeCache::Stats s = cache.stats();
+        std::cout << std::left << std::setw(9) << threads << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(14) << opt.redemptions / seconds << std::setprecision(1) << std::setw(9)
+                  << 100.0 * s.hits / opt.redemptions << "%" << std::setw(8) << s.misses << std::setw(8)
+                  << s.waits << std::setw(11) << s.evictions << std::setw(9) << s.entries << std::setw(8)
+                  << failed.load() << std::endl;
+    }
+
+    // 3. Batches grouped by committee against one by one, same cache state.
+    std::vector<CommitteeCache::Redemption> items(opt.redemptions);
+    for (int i = 0; i < opt.redemptions; ++i) {
+        const Committee& c = committees[stream[i]];
+        items[i].committee = c.id;
+        items[i].token = c.tokens[i % kTokensPerCommittee];
+        items[i].sku = user.second;
+    }
+    const size_t forged = items.size() / 2;
+    items[forged].token.omega += Fr(1);
+
+    CommitteeCache cache(budget, resolve);
+    std::vector<char> ok(items.size());
+    auto start = steady_clock::now();
+    for (size_t i = 0; i < items.size(); ++i) {
+        std::shared_ptr<const CommitteeKeys> keys = cache.get(items[i].committee);
+        ok[i] = keys->dntat->verify(items[i].token, keys->apk, items[i].sku);
+    }
+    double one_us = duration<double, std::micro>(steady_clock::now() - start).count() / items.size();
+
+    std::vector<char> batch_ok, all_ok;
+    start = steady_clock::now();
+    for (size_t begin = 0; begin < items.size(); begin += opt.batch) {
+        size_t end = std::min(items.size(), begin + static_cast<size_t>(opt.batch));
+        std::vector<CommitteeCache::Redemption> batch(items.begin() + begin, items.begin() + end);
+        cache.verify_batch(batch, batch_ok);
+        all_ok.insert(all_ok.end(), batch_ok.begin(), batch_ok.end());
+    }
+    double batch_us = duration<double, std::micro>(steady_clock::now() - start).count() / items.size();
+
+    bool agree = all_ok == ok;
+    for (size_t i = 0; i < all_ok.size(); ++i) {
+        agree = agree && (all_ok[i] != 0) == (i != forged);
+    }
+    std::cout << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    const std::string batched = "Batches of " + std::to_string(opt.batch) + ", by committee:";
+    std::cout << std::left << std::setw(32) << "One by one:" << std::right << std::setw(9) << one_us
+              << " us/token" << std::endl;
+    std::cout << std::left << std::setw(32) << batched << std::right << std::setw(9) << batch_us
+              << " us/token" << std::endl;
+    std::cout << "Only the forged token refused, both ways: " << (agree ? "yes" : "NO") << std::endl;
+    return agree ? 0 : 1;
+}
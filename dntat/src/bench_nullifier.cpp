@@ -0,0 +1,255 @@
+#include "dntat_ps.h"
+#include "nullifier_store.h"
+#include "epoch_nullifier_store.h"
+#include "filtered_nullifier_store.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace std::chrono;
+
+// Double-spend check throughput as redemption threads are added:
+//   1. the store alone: lock-free NullifierStore vs. one mutex around an
+//      unordered_set, inserting distinct tags
+//   2. full DNTAT redemptions (verify + check) over pre-issued tokens
+//   3. epoch-sharded store under constant load: insert rate, drop cost and
+//      memory as epochs go by; DNTAT tokens refused once their epoch expires
+//   4. Bloom filter front end: false-positive rate, then store inserts and
+//      DNTAT redemptions with and without it
+
+struct TagHash {
+    size_t operator()(const NullifierTag& tag) const {
+        return static_cast<size_t>(tag.lo);
+    }
+};
+
+class MutexStore {
+public:
+    explicit MutexStore(size_t capacity) {
+        set_.reserve(capacity);
+    }
+
+    bool insert(const NullifierTag& tag) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return set_.insert(tag).second;
+    }
+
+private:
+    std::mutex mutex_;
+    std::unordered_set<NullifierTag, TagHash> set_;
+};
+
+template<class Store>
+static double run_store(Store& store, const std::vector<NullifierTag>& tags, int num_threads) {
+    std::vector<std::thread> workers;
+    std::atomic<bool> go(false);
+    size_t per_thread = tags.size() / num_threads;
+
+    for (int t = 0; t < num_threads; ++t) {
+        workers.emplace_back([&, t]() {
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            const NullifierTag* begin = tags.data() + t * per_thread;
+            for (size_t i = 0; i < per_thread; ++i) {
+                store.insert(begin[i]);
+            }
+        });
+    }
+
+    auto start = steady_clock::now();
+    go.store(true);
+    for (auto& w : workers) {
+        w.join();
+    }
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    return per_thread * num_threads / seconds;
+}
+
+// Redeems every token once across `num_threads` threads; returns
+// redemptions/second and whether a second redemption of tokens[0] was refused.
+template<class Store>
+static double redeem_all(DNTAT_PS& dntat, const std::vector<Token>& tokens, const std::array<G2, 4>& apk,
+                         const Fr& sku, Store& spent, int num_threads, bool& double_spend_refused,
+                         int& rejected) {
+    std::atomic<int> bad(0);
+    std::vector<std::thread> workers;
+    int per_thread = static_cast<int>(tokens.size()) / num_threads;
+
+    auto start = steady_clock::now();
+    for (int t = 0; t < num_threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (int i = t * per_thread; i < (t + 1) * per_thread; ++i) {
+                if (!dntat.verify(tokens[i], apk, sku, spent)) {
+                    bad.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    double seconds = duration<double>(steady_clock::now() - start).count();
+
+    double_spend_refused = !dntat.verify(tokens[0], apk, sku, spent);
+    rejected = bad.load();
+    return per_thread * num_threads / seconds;
+}
+
+int main(int argc, char** argv) {
+    const std::string curve = take_curve_arg(argc, argv);
+    if (!init_curve(curve)) {
+        return 1;
+    }
+
+    int max_threads = argc > 1 ? std::atoi(argv[1]) : 16;
+    size_t num_tags = argc > 2 ? std::strtoull(argv[2], 0, 10) : 4000000;
+    int num_tokens = argc > 3 ? std::atoi(argv[3]) : 1024;
+    uint32_t num_epochs = argc > 4 ? std::atoi(argv[4]) : 16;
+    uint32_t window = argc > 5 ? std::atoi(argv[5]) : 4;
+
+    std::cout << "=== Nullifier store: inserts/second (" << num_tags << " distinct tags) ===" << std::endl;
+    std::vector<NullifierTag> tags(num_tags);
+    for (size_t i = 0; i < num_tags; ++i) {
+        Fr x;
+        x.setByCSPRNG();
+        tags[i] = nullifier_tag("bench", x);
+    }
+
+    std::cout << std::left << std::setw(10) << "Threads" << std::right
+              << std::setw(16) << "lock-free" << std::setw(16) << "mutex" << std::endl;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        NullifierStore lock_free(num_tags);
+        MutexStore locked(num_tags);
+        double lf = run_store(lock_free, tags, threads);
+        double mx = run_store(locked, tags, threads);
+        std::cout << std::left << std::setw(10) << threads << std::right << std::fixed
+                  << std::setprecision(0) << std::setw(16) << lf << std::setw(16) << mx << std::endl;
+    }
+
+    std::cout << "\n=== DNTAT redemptions/second with double-spend check ("
+              << num_tokens << " tokens) ===" << std::endl;
+    DNTAT_PS dntat(1);
+    auto keypair = dntat.S_keygen();
+    std::vector<PublicKey> pks(1, keypair.first);
+    std::vector<SecretKey> sks(1, keypair.second);
+    auto user_keypair = dntat.U_keygen();
+    auto apk = dntat.keyaggr(pks);
+
+    std::vector<Token> tokens(num_tokens);
+    for (int i = 0; i < num_tokens; ++i) {
+        auto sign_result = dntat.sign(sks, pks, user_keypair.second, user_keypair.first);
+        tokens[i] = dntat.tokenaggr(sign_result.sigma_bars, sign_result.hbar, sign_result.omega, pks);
+    }
+
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        NullifierStore spent(num_tokens);
+        bool double_spend_refused;
+        int rejected;
+        double rate = redeem_all(dntat, tokens, apk, user_keypair.second, spent, threads,
+                                 double_spend_refused, rejected);
+        std::cout << "Threads " << std::setw(3) << threads << ": ~" << std::fixed << std::setprecision(0)
+                  << rate << " redemptions/second"
+                  << (rejected == 0 ? "" : " (valid tokens rejected)")
+                  << (double_spend_refused ? "" : " (double spend accepted)") << std::endl;
+    }
+
+    std::cout << "\n=== Epoch-sharded store: " << num_epochs << " epochs, window " << window
+              << ", " << num_tags << " tags per epoch ===" << std::endl;
+    {
+        EpochNullifierStore sharded(num_tags, window, 0);
+        std::cout << std::left << std::setw(8) << "Epoch" << std::right << std::setw(16) << "inserts/s"
+                  << std::setw(14) << "drop (us)" << std::setw(14) << "MiB" << std::endl;
+        for (uint32_t epoch = 0; epoch < num_epochs; ++epoch) {
+            auto t0 = steady_clock::now();
+            sharded.advance(epoch);
+            double drop_us = duration<double, std::micro>(steady_clock::now() - t0).count();
+
+            t0 = steady_clock::now();
+            for (size_t i = 0; i < num_tags; ++i) {
+                sharded.insert(epoch, tags[i]);
+            }
+            double seconds = duration<double>(steady_clock::now() - t0).count();
+
+            std::cout << std::left << std::setw(8) << epoch << std::right << std::fixed
+                      << std::setprecision(0) << std::setw(16) << num_tags / seconds
+                      << std::setw(14) << drop_us << std::setw(14)
+                      << sharded.bytes() / (1 << 20) << std::endl;
+        }
+        // Mapped lazily, so sizing it costs nothing until it fills.
+        NullifierStore flat(static_cast<size_t>(num_tags) * num_epochs);
+        std::cout << "One store holding every epoch would need " << flat.bytes() / (1 << 20)
+                  << " MiB and keep growing with the number of epochs" << std::endl;
+    }
+
+    {
+        EpochNullifierStore spent(4, 2, 7);
+        auto fresh = dntat.sign(sks, pks, user_keypair.second, user_keypair.first, 7);
+        Token token = dntat.tokenaggr(fresh.sigma_bars, fresh.hbar, fresh.omega, pks);
+        auto stale = dntat.sign(sks, pks, user_keypair.second, user_keypair.first, 7);
+        Token expired = dntat.tokenaggr(stale.sigma_bars, stale.hbar, stale.omega, pks);
+        bool accepted = DNTAT_PS::epoch_of(token) == 7 && dntat.verify(token, apk, user_keypair.second, spent);
+        spent.advance(9);
+        bool expired_refused = !dntat.verify(expired, apk, user_keypair.second, spent);
+        std::cout << "DNTAT epoch 7 token accepted in window [6, 7]: " << (accepted ? "yes" : "NO")
+                  << "; refused once the window is [8, 9]: " << (expired_refused ? "yes" : "NO") << std::endl;
+    }
+
+    std::cout << "\n=== Bloom filter front end (" << num_tags << " tags, 16 bits/tag) ===" << std::endl;
+    {
+        FilteredNullifierStore probe(num_tags);
+        for (size_t i = 0; i < num_tags; ++i) {
+            probe.insert(tags[i]);
+        }
+        size_t trials = num_tags / 4 > 0 ? num_tags / 4 : 1;
+        size_t false_positives = 0;
+        for (size_t i = 0; i < trials; ++i) {
+            Fr x;
+            x.setByCSPRNG();
+            false_positives += probe.filter().may_contain(nullifier_tag("bench", x));
+        }
+        std::cout << "False-positive rate: " << std::fixed << std::setprecision(3)
+                  << 100.0 * false_positives / trials << "% (filter " << (probe.filter().bytes() >> 10)
+                  << " KiB, table " << ((probe.bytes() - probe.filter().bytes()) >> 20) << " MiB)" << std::endl;
+    }
+
+    std::cout << std::left << std::setw(10) << "Threads" << std::right
+              << std::setw(16) << "table only" << std::setw(16) << "filtered" << std::endl;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        NullifierStore plain(num_tags);
+        FilteredNullifierStore filtered(num_tags);
+        double pl = run_store(plain, tags, threads);
+        double fl = run_store(filtered, tags, threads);
+        std::cout << std::left << std::setw(10) << threads << std::right << std::fixed
+                  << std::setprecision(0) << std::setw(16) << pl << std::setw(16) << fl << std::endl;
+    }
+
+    // Redemptions against stores already holding num_tags spent tokens, so
+    // the table is well out of cache.
+    {
+        NullifierStore plain(num_tags + num_tokens);
+        FilteredNullifierStore filtered(num_tags + num_tokens);
+        for (size_t i = 0; i < num_tags; ++i) {
+            plain.insert(tags[i]);
+            filtered.insert(tags[i]);
+        }
+        bool plain_refused, filtered_refused;
+        int plain_rejected, filtered_rejected;
+        double pl = redeem_all(dntat, tokens, apk, user_keypair.second, plain, max_threads,
+                               plain_refused, plain_rejected);
+        double fl = redeem_all(dntat, tokens, apk, user_keypair.second, filtered, max_threads,
+                               filtered_refused, filtered_rejected);
+        std::cout << "DNTAT, " << max_threads << " threads: ~" << std::fixed << std::setprecision(0)
+                  << pl << " redemptions/second table only, ~" << fl << " filtered"
+                  << (plain_rejected + filtered_rejected == 0 ? "" : " (valid tokens rejected)")
+                  << (plain_refused && filtered_refused ? "" : " (double spend accepted)") << std::endl;
+    }
+
+    return 0;
+}
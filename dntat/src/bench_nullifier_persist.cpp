@@ -0,0 +1,211 @@
+#include "persistent_nullifier_store.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std::chrono;
+
+// Persistent spent-token set at scale:
+//   1. sustained insert rate into a fresh store, every insert durable
+//   2. a process that logs a tail of inserts and dies without checkpointing,
+//      then the cold start that maps the table and replays that tail
+//   3. a restart after a clean shutdown
+//   4. a log with a torn trailing record: a process appends after it and
+//      crashes, and the table loses everything since its last checkpoint
+//      (power loss); the restart must still recover every spent tag
+//
+// Tags are synthetic (splitmix64 of the index) so 10^8 of them can be
+// generated on the fly and re-derived by the restarted process.
+
+static NullifierTag synthetic_tag(uint64_t i) {
+    NullifierTag tag;
+    uint64_t z = i * 2 + 1;
+    for (int w = 0; w < 2; ++w) {
+        z += 0x9e3779b97f4a7c15ULL;
+        uint64_t x = z;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        (w == 0 ? tag.lo : tag.hi) = x | 1;
+    }
+    return tag;
+}
+
+// Each thread keeps up to `window` inserts in flight before waiting for the
+// last of them, as a server does with that many open redemptions.
+static void insert_range(PersistentNullifierStore& store, uint64_t begin, uint64_t end,
+                         int num_threads, size_t window) {
+    std::vector<std::thread> workers;
+    uint64_t per_thread = (end - begin) / num_threads;
+    for (int t = 0; t < num_threads; ++t) {
+        uint64_t lo = begin + t * per_thread;
+        uint64_t hi = t == num_threads - 1 ? end : lo + per_thread;
+        workers.emplace_back([&store, lo, hi, window]() {
+            uint64_t ticket = 0;
+            for (uint64_t i = lo; i < hi; ++i) {
+                uint64_t t;
+                if (store.insert_nowait(synthetic_tag(i), &t)) {
+                    ticket = t;
+                }
+                if ((i - lo + 1) % window == 0) {
+                    store.wait_durable(ticket);
+                }
+            }
+            store.wait_durable(ticket);
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+static void copy_file(const std::string& from, const std::string& to) {
+    std::ifstream in(from.c_str(), std::ios::binary);
+    std::ofstream out(to.c_str(), std::ios::binary | std::ios::trunc);
+    out << in.rdbuf();
+}
+
+static bool spot_check(const PersistentNullifierStore& store, uint64_t count) {
+    for (uint64_t i = 0; i < count; i += count / 1000 + 1) {
+        if (!store.contains(synthetic_tag(i))) {
+            return false;
+        }
+    }
+    return !store.contains(synthetic_tag(count + 12345));
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0]
+                  << " <dir> [tags=100000000] [tail=1000000] [threads=8] [window=4096]" << std::endl;
+        return 1;
+    }
+    std::string dir = argv[1];
+    uint64_t num_tags = argc > 2 ? std::strtoull(argv[2], 0, 10) : 100000000ULL;
+    uint64_t tail = argc > 3 ? std::strtoull(argv[3], 0, 10) : 1000000ULL;
+    int num_threads = argc > 4 ? std::atoi(argv[4]) : 8;
+    size_t window = argc > 5 ? std::strtoull(argv[5], 0, 10) : 4096;
+
+    std::remove((dir + "/nullifiers.tbl").c_str());
+    std::remove((dir + "/nullifiers.log").c_str());
+    std::remove((dir + "/nullifiers.log.1").c_str());
+
+    std::cout << "=== Sustained durable inserts (" << num_tags << " tags, " << num_threads
+              << " threads, " << window << " in flight each) ===" << std::endl;
+    {
+        PersistentNullifierStore store(dir, num_tags + tail);
+        std::cout << "Table: " << store.slot_count() << " slots ("
+                  << (store.slot_count() * 8 >> 20) << " MiB)" << std::endl;
+
+        uint64_t step = num_tags / 10 > 0 ? num_tags / 10 : num_tags;
+        auto start = steady_clock::now();
+        for (uint64_t done = 0; done < num_tags; done += step) {
+            uint64_t end = done + step < num_tags ? done + step : num_tags;
+            auto t0 = steady_clock::now();
+            insert_range(store, done, end, num_threads, window);
+            double s = duration<double>(steady_clock::now() - t0).count();
+            std::cout << "  " << std::setw(12) << end << " tags: " << std::fixed << std::setprecision(0)
+                      << (end - done) / s << " inserts/second" << std::endl;
+        }
+        double seconds = duration<double>(steady_clock::now() - start).count();
+        std::cout << "Overall: " << std::fixed << std::setprecision(0) << num_tags / seconds
+                  << " inserts/second" << std::endl;
+
+        auto t0 = steady_clock::now();
+        store.checkpoint();
+        std::cout << "Checkpoint: " << std::setprecision(3)
+                  << duration<double>(steady_clock::now() - t0).count() << " s" << std::endl;
+    }
+
+    std::cout << "\n=== Crash with " << tail << " logged inserts, then cold start ===" << std::endl;
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Automatic checkpoints off, so the whole tail stays in the log; the
+        // store is leaked and the process exits without its destructor.
+        PersistentNullifierStore* store = new PersistentNullifierStore(dir, 0, ~size_t(0));
+        insert_range(*store, num_tags, num_tags + tail, num_threads, window);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "crash child failed" << std::endl;
+        return 1;
+    }
+    {
+        auto t0 = steady_clock::now();
+        PersistentNullifierStore store(dir, 0);
+        double s = duration<double>(steady_clock::now() - t0).count();
+        std::cout << "Cold start: " << std::fixed << std::setprecision(3) << s << " s, "
+                  << store.replayed() << " log records replayed" << std::endl;
+        bool ok = spot_check(store, num_tags + tail);
+        std::cout << "Spent tags recovered: " << (ok ? "yes" : "NO") << std::endl;
+        if (!ok) {
+            return 1;
+        }
+        if (store.replayed() > 0) {
+            std::cout << "Replaying all " << num_tags + tail << " tags instead: ~" << std::setprecision(1)
+                      << s * (num_tags + tail) / store.replayed() << " s" << std::endl;
+        }
+    }
+
+    std::cout << "\n=== Restart after clean shutdown ===" << std::endl;
+    {
+        auto t0 = steady_clock::now();
+        PersistentNullifierStore store(dir, 0);
+        double s = duration<double>(steady_clock::now() - t0).count();
+        std::cout << "Cold start: " << std::fixed << std::setprecision(3) << s << " s, "
+                  << store.replayed() << " log records replayed" << std::endl;
+        bool double_spend_refused = !store.insert(synthetic_tag(0));
+        std::cout << "Double spend refused: " << (double_spend_refused ? "yes" : "NO") << std::endl;
+        if (!double_spend_refused) {
+            return 1;
+        }
+    }
+
+    std::cout << "\n=== Torn log record, then power loss ===" << std::endl;
+    const std::string table = dir + "/nullifiers.tbl";
+    copy_file(table, table + ".checkpointed");
+    {
+        std::ofstream log((dir + "/nullifiers.log").c_str(), std::ios::binary | std::ios::app);
+        log.write("\x01torn!!", 7);
+    }
+    const uint64_t after = num_tags + tail;
+    const uint64_t count = 1000;
+    pid = fork();
+    if (pid == 0) {
+        PersistentNullifierStore* store = new PersistentNullifierStore(dir, 0, ~size_t(0));
+        insert_range(*store, after, after + count, 1, 64);
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "torn-tail child failed" << std::endl;
+        return 1;
+    }
+    copy_file(table + ".checkpointed", table);
+    std::remove((table + ".checkpointed").c_str());
+    {
+        PersistentNullifierStore store(dir, 0);
+        bool ok = store.replayed() == count;
+        for (uint64_t i = after; i < after + count; ++i) {
+            ok = ok && store.contains(synthetic_tag(i));
+        }
+        ok = ok && !store.insert(synthetic_tag(after));
+        std::cout << store.replayed() << " log records replayed; spent tags recovered: "
+                  << (ok ? "yes" : "NO") << std::endl;
+        if (!ok) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "dntat_ps.h"
+#include "dntat_bench.h"
+#include "dntat_keyring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+// Redemption latency while the verifier's committee is rotated.
+//
+// Two committees take turns: key set k verifies the tokens of committee
+// k mod 2, which are issued up front. Redemption threads verify for
+// --seconds, each timing every verify(). A rotation thread builds the
+// other committee's CommitteeKeys every --rotate-ms, including its
+// precomputation, and installs it in one of three ways:
+//
+//   static   no rotation, the reference
+//   rcu      built off to the side, then VerifierKeyRing::rotate()
+//   locked   rebuilt while holding the mutex that redemptions take, i.e.
+//            redemption stops while the keys are replaced
+//
+// Every verification must succeed; a failure means a redemption saw a key
+// set that did not match its tokens.
+//
+// Usage: bench_rotation [--curve bn254|bls12_381|bn462] [--signers 4] [--threads 4] [--seconds 3] [--rotate-ms 100]
+
+namespace {
+
+struct Options {
+    int signers = 4;
+    int threads = 4;
+    double seconds = 3;
+    int rotate_ms = 100;
+};
+
+struct Result {
+    double rate;
+    double p50_us, p99_us, max_us;
+    int rotations;
+    long failures;
+};
+
+// `verify(i)` runs one redemption and says if it passed; `rotate(k)`
+// installs key set k. Returns the aggregate over all redemption threads.
+template<class Verify, class Rotate>
+Result run(const Options& opt, bool rotating, Verify verify, Rotate rotate) {
+    std::atomic<bool> stop(false);
+    std::atomic<long> failures(0);
+    std::vector<std::vector<double> > latencies(opt.threads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < opt.threads; ++t) {
+        threads.emplace_back([&, t]() {
+            std::vector<double>& mine = latencies[t];
+            for (size_t i = t; !stop.load(std::memory_order_relaxed); ++i) {
+                auto start = steady_clock::now();
+                if (!verify(i)) {
+                    failures.fetch_add(1);
+                }
+                mine.push_back(duration<double, std::micro>(steady_clock::now() - start).count());
+            }
+        });
+    }
+
+    int rotations = 0;
+    auto end = steady_clock::now() + duration<double>(opt.seconds);
+    while (steady_clock::now() < end) {
+        std::this_thread::sleep_for(milliseconds(opt.rotate_ms));
+        if (rotating) {
+            rotate(++rotations);
+        }
+    }
+    stop.store(true);
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    std::vector<double> all;
+    for (const auto& l : latencies) {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    std::sort(all.begin(), all.end());
+    Result r;
+    r.rate = all.size() / opt.seconds;
+    r.p50_us = all.empty() ? 0 : all[all.size() / 2];
+    r.p99_us = all.empty() ? 0 : all[static_cast<size_t>(0.99 * (all.size() - 1))];
+    r.max_us = all.empty() ? 0 : all.back();
+    r.rotations = rotations;
+    r.failures = failures.load();
+    return r;
+}
+
+void print(const char* label, const Result& r) {
+    std::cout << std::left << std::setw(10) << label << std::right << std::setw(10) << r.rotations
+              << std::fixed << std::setprecision(0) << std::setw(14) << r.rate << std::setprecision(1)
+              << std::setw(11) << r.p50_us << std::setw(11) << r.p99_us << std::setw(12) << r.max_us
+              << std::setw(10) << r.failures << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::string curve = take_curve_arg(argc, argv);
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--signers") {
+            opt.signers = std::atoi(argv[i + 1]);
+        } else if (flag == "--threads") {
+            opt.threads = std::atoi(argv[i + 1]);
+        } else if (flag == "--seconds") {
+            opt.seconds = std::atof(argv[i + 1]);
+        } else if (flag == "--rotate-ms") {
+            opt.rotate_ms = std::atoi(argv[i + 1]);
+        } else {
+            std::cerr << "unknown option " << flag << std::endl;
+            return 1;
+        }
+    }
+    if (opt.signers < 1 || opt.threads < 1 || opt.seconds <= 0 || opt.rotate_ms < 1) {
+        std::cerr << "--signers, --threads, --seconds and --rotate-ms must be positive" << std::endl;
+        return 1;
+    }
+
+    if (!init_curve(curve)) {
+        return 1;
+    }
+    DNTAT_PS user_side(opt.signers);
+    auto user = user_side.U_keygen();
+    const int kTokens = 64;
+    BenchCommittee committees[2] = {
+        make_committee(opt.signers, user, kTokens),
+        make_committee(opt.signers, user, kTokens)
+    };
+    const Fr sku = user.second;
+
+    std::cout << "=== DNTAT redemption during committee rotation: " << opt.signers << " signers, "
+              << opt.threads << " threads, every " << opt.rotate_ms << " ms ===" << std::endl;
+    std::cout << std::left << std::setw(10) << "Keys" << std::right << std::setw(10) << "rotations"
+              << std::setw(14) << "verifies/s" << std::setw(11) << "p50 (us)" << std::setw(11) << "p99 (us)"
+              << std::setw(12) << "max (us)" << std::setw(10) << "failed" << std::endl;
+
+    {
+        VerifierKeyRing ring(CommitteeKeys::build(0, committees[0].pks));
+        auto verify = [&](size_t i) {
+            return ring.verify(committees[0].tokens[i % kTokens], sku);
+        };
+        print("static", run(opt, false, verify, [](int) {}));
+    }
+    {
+        VerifierKeyRing ring(CommitteeKeys::build(0, committees[0].pks));
+        auto verify = [&](size_t i) {
+            VerifierKeyRing::Snapshot keys = ring.snapshot();
+            const Token& token = committees[keys->version % 2].tokens[i % kTokens];
+            return keys->dntat->verify(token, keys->apk, sku);
+        };
+        auto rotate = [&](int k) {
+            ring.rotate(CommitteeKeys::build(k, committees[k % 2].pks));
+        };
+        print("rcu", run(opt, true, verify, rotate));
+    }
+    {
+        std::mutex mutex;
+        std::unique_ptr<CommitteeKeys> current = CommitteeKeys::build(0, committees[0].pks);
+        auto verify = [&](size_t i) {
+            std::lock_guard<std::mutex> lock(mutex);
+            const Token& token = committees[current->version % 2].tokens[i % kTokens];
+            return current->dntat->verify(token, current->apk, sku);
+        };
+        auto rotate = [&](int k) {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = CommitteeKeys::build(k, committees[k % 2].pks);
+        };
+        print("locked", run(opt, true, verify, rotate));
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "dntat_ps.h"
+#include "scalar_mul.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+using namespace std::chrono;
+
+// Compares, for the term shapes that appear in the verify and aggregate
+// routines, the three ways of computing sum_i k[i] * P[i]:
+//   generic   - one G::mul per term (what those routines used before)
+//   secret    - one mul_secret (constant time) per term
+//   public    - one msm_public over all terms
+
+static const int kIterations = 1000;
+
+template<class G>
+static double time_generic(G* P, const Fr* k, size_t n) {
+    G sum, temp;
+    auto start = steady_clock::now();
+    for (int it = 0; it < kIterations; ++it) {
+        sum.clear();
+        for (size_t i = 0; i < n; ++i) {
+            G::mul(temp, P[i], k[i]);
+            sum += temp;
+        }
+    }
+    return duration<double, std::micro>(steady_clock::now() - start).count() / kIterations;
+}
+
+template<class G>
+static double time_secret(G* P, const Fr* k, size_t n) {
+    G sum, temp;
+    auto start = steady_clock::now();
+    for (int it = 0; it < kIterations; ++it) {
+        sum.clear();
+        for (size_t i = 0; i < n; ++i) {
+            mul_secret(temp, P[i], k[i]);
+            sum += temp;
+        }
+    }
+    return duration<double, std::micro>(steady_clock::now() - start).count() / kIterations;
+}
+
+template<class G>
+static double time_public(G* P, const Fr* k, size_t n) {
+    G sum;
+    auto start = steady_clock::now();
+    for (int it = 0; it < kIterations; ++it) {
+        msm_public(sum, P, k, n);
+    }
+    return duration<double, std::micro>(steady_clock::now() - start).count() / kIterations;
+}
+
+template<class G>
+static void report_shape(const std::string& label, const G& base, size_t n) {
+    std::vector<G> P(n);
+    std::vector<Fr> k(n);
+    for (size_t i = 0; i < n; ++i) {
+        Fr r;
+        r.setByCSPRNG();
+        G::mul(P[i], base, r);
+        k[i].setByCSPRNG();
+    }
+
+    double generic = time_generic(P.data(), k.data(), n);
+    double secret = time_secret(P.data(), k.data(), n);
+    double pub = time_public(P.data(), k.data(), n);
+
+    std::cout << std::left << std::setw(40) << label << std::right << std::fixed
+              << std::setprecision(1)
+              << std::setw(12) << generic
+              << std::setw(12) << secret
+              << std::setw(12) << pub
+              << std::setw(10) << std::setprecision(2) << generic / pub << "x" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    const std::string curve = take_curve_arg(argc, argv);
+    if (!init_curve(curve)) {
+        return 1;
+    }
+
+    int num_signers = argc > 1 ? std::atoi(argv[1]) : 4;
+
+    G1 g1;
+    G2 g2;
+    hashAndMapToG1(g1, "bench_g1");
+    hashAndMapToG2(g2, "bench_g2");
+
+    std::cout << "=== Scalar multiplication by routine (us per call) ===" << std::endl;
+    std::cout << std::left << std::setw(40) << "Shape" << std::right
+              << std::setw(12) << "generic"
+              << std::setw(12) << "secret"
+              << std::setw(12) << "public"
+              << std::setw(11) << "speedup" << std::endl;
+
+    report_shape("DNTAT verify: G2 x 2 (thetabar, omega)", g2, 2);
+    report_shape("DNTAT tokenaggr: G1 x n_signers", g1, num_signers);
+    report_shape("DNTAT keyaggr: G2 x n_signers (per key)", g2, num_signers);
+    report_shape("NTAT rep3_verify comm1: G1 x 2", g1, 2);
+    report_shape("NTAT rep3_verify comm2: G1 x 4", g1, 4);
+    report_shape("NTAT redemption2 Q_s: G1 x 4", g1, 4);
+    report_shape("U-Prove / CHAC checks: G1 x 3", g1, 3);
+
+    std::cout << "\nspeedup = generic / public" << std::endl;
+
+    std::cout << "\n=== DNTAT routines (" << num_signers << " signers, us per call) ===" << std::endl;
+    DNTAT_PS dntat(num_signers);
+    std::vector<PublicKey> pks;
+    std::vector<SecretKey> sks;
+    for (int i = 0; i < num_signers; ++i) {
+        auto keypair = dntat.S_keygen();
+        pks.push_back(keypair.first);
+        sks.push_back(keypair.second);
+    }
+    auto user_keypair = dntat.U_keygen();
+    auto apk = dntat.keyaggr(pks);
+    auto sign_result = dntat.sign(sks, pks, user_keypair.second, user_keypair.first);
+    Token token = dntat.tokenaggr(sign_result.sigma_bars, sign_result.hbar, sign_result.omega, pks);
+
+    auto start = steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        dntat.keyaggr(pks);
+    }
+    std::cout << "keyaggr: " << std::fixed << std::setprecision(1)
+              << duration<double, std::micro>(steady_clock::now() - start).count() / kIterations << std::endl;
+
+    start = steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        dntat.tokenaggr(sign_result.sigma_bars, sign_result.hbar, sign_result.omega, pks);
+    }
+    std::cout << "tokenaggr: " << std::fixed << std::setprecision(1)
+              << duration<double, std::micro>(steady_clock::now() - start).count() / kIterations << std::endl;
+
+    bool ok = true;
+    start = steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        ok &= dntat.verify(token, apk, user_keypair.second);
+    }
+    std::cout << "verify: " << std::fixed << std::setprecision(1)
+              << duration<double, std::micro>(steady_clock::now() - start).count() / kIterations
+              << (ok ? "" : " (FAILED)") << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include "dntat_ps.h"
+#include "dntat_bench.h"
+#include "dntat_coordinator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+// Issuance latency with every signer in its own dntat_signerd process,
+// reached over Unix sockets through SignerCoordinator, against sign() with
+// all signers as threads of one process. Signer counts double from 1 to
+// max_signers; each count starts fresh signer processes. On Linux a second
+// table compares the share round trip (SignerCoordinator::gather, request out
+// to all signers and every s_bar back) over Unix sockets and over the
+// shared-memory ring (ShmRing).
+//
+// Usage: bench_signerd [--curve bn254|bls12_381|bn462] [max_signers=32] [issuances=200] [deadline_ms=1000] [signerd=<dir of this binary>/dntat_signerd]
+
+// Round trips of one request through gather(), in microseconds.
+static std::vector<double> gather_rtt(const std::string& signerd, const std::string& curve,
+                                      const std::vector<std::string>& addrs, DNTAT_PS& dntat, int rounds,
+                                      int deadline_ms) {
+    std::vector<pid_t> pids = spawn_signers(signerd, curve, addrs);
+    std::vector<double> samples;
+    try {
+        SignerCoordinator coordinator(addrs, milliseconds(10000), microseconds(deadline_ms * 1000LL));
+        auto user_keypair = dntat.U_keygen();
+        DNTAT_PS::IssuanceRequest request;
+        DNTAT_PS::IssuanceSecrets secrets;
+        dntat.issue_request(user_keypair.second, user_keypair.first, request, secrets);
+        std::vector<G1> shares;
+        for (int k = 0; k < rounds + rounds / 10; ++k) {
+            auto start = steady_clock::now();
+            bool ok = coordinator.gather(request, shares);
+            double us = duration<double, std::micro>(steady_clock::now() - start).count();
+            if (ok && k >= rounds / 10) {  // first 10% are warm-up
+                samples.push_back(us);
+            }
+        }
+    } catch (...) {
+        stop_signers(pids);
+        throw;
+    }
+    stop_signers(pids);
+    std::sort(samples.begin(), samples.end());
+    return samples;
+}
+
+int main(int argc, char** argv) {
+    const std::string curve = take_curve_arg(argc, argv);
+    int max_signers = argc > 1 ? std::atoi(argv[1]) : 32;
+    int issuances = argc > 2 ? std::atoi(argv[2]) : 200;
+    int deadline_ms = argc > 3 ? std::atoi(argv[3]) : 1000;
+    std::string signerd;
+    if (argc > 4) {
+        signerd = argv[4];
+    } else {
+        signerd = default_signerd(argv[0]);
+    }
+    if (max_signers < 1 || issuances < 1) {
+        std::cerr << "max_signers and issuances must be positive" << std::endl;
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if (!init_curve(curve)) {
+        return 1;
+    }
+
+    std::cout << "=== DNTAT issuance latency: signer processes vs signer threads (" << issuances
+              << " issuances, deadline " << deadline_ms << " ms) ===" << std::endl;
+    std::cout << std::left << std::setw(9) << "Signers" << std::right << std::setw(14) << "threads (ms)"
+              << std::setw(14) << "procs mean" << std::setw(12) << "procs p50" << std::setw(12) << "procs p99"
+              << std::endl;
+
+    for (int n = 1; n <= max_signers; n *= 2) {
+        DNTAT_PS dntat(n);
+        auto user_keypair = dntat.U_keygen();
+
+        // Baseline: all n signers as threads of this process.
+        std::vector<PublicKey> pks;
+        std::vector<SecretKey> sks;
+        for (int i = 0; i < n; ++i) {
+            auto keypair = dntat.S_keygen();
+            pks.push_back(keypair.first);
+            sks.push_back(keypair.second);
+        }
+        auto t0 = steady_clock::now();
+        for (int k = 0; k < issuances; ++k) {
+            auto sign_result = dntat.sign(sks, pks, user_keypair.second, user_keypair.first);
+            dntat.tokenaggr(sign_result.sigma_bars, sign_result.hbar, sign_result.omega, pks);
+        }
+        double threads_ms = duration<double, std::milli>(steady_clock::now() - t0).count() / issuances;
+
+        std::vector<std::string> addrs;
+        for (int i = 0; i < n; ++i) {
+            addrs.push_back("unix:/tmp/dntat_signer_" + std::to_string(::getpid()) + "_" + std::to_string(i) + ".sock");
+        }
+        std::vector<pid_t> pids = spawn_signers(signerd, curve, addrs);
+
+        std::vector<double> samples;
+        int failed = 0;
+        bool verified = false;
+        try {
+            SignerCoordinator coordinator(addrs, milliseconds(10000), microseconds(deadline_ms * 1000LL));
+            auto apk = dntat.keyaggr(coordinator.pks());
+            Token token;
+            verified = coordinator.issue(dntat, user_keypair.second, user_keypair.first, token) &&
+                       dntat.verify(token, apk, user_keypair.second);
+            for (int k = 0; k < issuances; ++k) {
+                auto start = steady_clock::now();
+                if (coordinator.issue(dntat, user_keypair.second, user_keypair.first, token)) {
+                    samples.push_back(duration<double, std::milli>(steady_clock::now() - start).count());
+                } else {
+                    ++failed;
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "bench_signerd: " << e.what() << std::endl;
+            stop_signers(pids);
+            return 1;
+        }
+        stop_signers(pids);
+        for (const std::string& addr : addrs) {
+            ::unlink(addr.c_str() + 5);
+        }
+
+        std::cout << std::left << std::setw(9) << n << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(14) << threads_ms;
+        if (samples.empty()) {
+            std::cout << "  (every issuance missed the deadline)" << std::endl;
+            continue;
+        }
+        double mean = 0;
+        for (double s : samples) {
+            mean += s;
+        }
+        mean /= samples.size();
+        std::sort(samples.begin(), samples.end());
+        std::cout << std::setw(14) << mean << std::setw(12) << percentile(samples, 0.50)
+                  << std::setw(12) << percentile(samples, 0.99);
+        if (!verified) {
+            std::cout << "  (token did not verify)";
+        }
+        if (failed > 0) {
+            std::cout << "  (" << failed << " past deadline)";
+        }
+        std::cout << std::endl;
+    }
+
+#ifdef __linux__
+    std::cout << "\n=== Share round trip (us): Unix socket vs shared-memory ring ===" << std::endl;
+    std::cout << std::left << std::setw(9) << "Signers" << std::right << std::setw(13) << "socket p50"
+              << std::setw(13) << "socket p99" << std::setw(12) << "shm p50" << std::setw(12) << "shm p99"
+              << std::endl;
+    for (int n = 1; n <= max_signers; n *= 2) {
+        DNTAT_PS dntat(n);
+        std::vector<std::string> sockets, rings;
+        const std::string segment = "/dntat_bench_" + std::to_string(::getpid());
+        for (int i = 0; i < n; ++i) {
+            sockets.push_back("unix:/tmp/dntat_signer_" + std::to_string(::getpid()) + "_" + std::to_string(i) + ".sock");
+            rings.push_back("shm:" + segment + ":" + std::to_string(i));
+        }
+        std::vector<double> socket_us, shm_us;
+        try {
+            socket_us = gather_rtt(signerd, curve, sockets, dntat, issuances, deadline_ms);
+            shm_us = gather_rtt(signerd, curve, rings, dntat, issuances, deadline_ms);
+        } catch (const std::exception& e) {
+            std::cerr << "bench_signerd: " << e.what() << std::endl;
+            return 1;
+        }
+        for (const std::string& addr : sockets) {
+            ::unlink(addr.c_str() + 5);
+        }
+        if (socket_us.empty() || shm_us.empty()) {
+            std::cout << std::left << std::setw(9) << n << "  (every round missed the deadline)" << std::endl;
+            continue;
+        }
+        std::cout << std::left << std::setw(9) << n << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(13) << percentile(socket_us, 0.50) << std::setw(13) << percentile(socket_us, 0.99)
+                  << std::setw(12) << percentile(shm_us, 0.50) << std::setw(12) << percentile(shm_us, 0.99)
+                  << std::endl;
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include "dntat_ps.h"
+#include "dntat_artifact.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std::chrono;
+
+// Startup cost of a DNTAT worker, built from scratch versus mapped from a
+// precomputation artifact (dntat_artifact.h).
+//
+// From scratch, a worker hashes the generators to the curve, derives the
+// committee's MuSig coefficients and aggregated key, and builds the g1
+// table and g2 lines. From the artifact it maps the file, checks its
+// digest and points at the stored values. Both also pay initPairing(),
+// reported on its own. --workers processes are then forked at once and
+// each times its own start from the artifact, as a pool of new workers
+// would. The benchmark finally checks that both instances accept the same
+// token, times verify() with and without the stored lines, and checks that
+// a corrupted artifact is refused.
+//
+// Usage: bench_startup [--curve bn254|bls12_381|bn462] [--signers 4] [--workers 8] [--artifact /tmp/dntat_startup_<pid>.pre]
+
+namespace {
+
+const int kRepeats = 5;
+
+double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+template<class F>
+double time_us(F f) {
+    std::vector<double> runs;
+    for (int r = 0; r < kRepeats; ++r) {
+        auto start = steady_clock::now();
+        f();
+        runs.push_back(duration<double, std::micro>(steady_clock::now() - start).count());
+    }
+    return median(runs);
+}
+
+void row(const std::string& label, double us) {
+    std::cout << std::left << std::setw(44) << label << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << us << std::endl;
+}
+
+// Forks `workers` processes that each open the artifact and build a
+// DNTAT_PS from it; returns their start times in microseconds.
+std::vector<double> spawn_workers(const std::string& path, int workers) {
+    std::vector<pid_t> pids;
+    std::vector<int> fds;
+    for (int w = 0; w < workers; ++w) {
+        int fd[2];
+        if (::pipe(fd) != 0) {
+            throw std::runtime_error("bench_startup: pipe failed");
+        }
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            throw std::runtime_error("bench_startup: fork failed");
+        }
+        if (pid == 0) {
+            ::close(fd[0]);
+            double us = -1;
+            try {
+                auto start = steady_clock::now();
+                DNTATArtifact artifact(path);
+                DNTAT_PS dntat(artifact);
+                us = duration<double, std::micro>(steady_clock::now() - start).count();
+            } catch (const std::exception&) {
+            }
+            ssize_t ignored = ::write(fd[1], &us, sizeof(us));
+            (void)ignored;
+            _exit(0);
+        }
+        ::close(fd[1]);
+        pids.push_back(pid);
+        fds.push_back(fd[0]);
+    }
+    std::vector<double> times;
+    for (size_t w = 0; w < pids.size(); ++w) {
+        double us = -1;
+        if (::read(fds[w], &us, sizeof(us)) != static_cast<ssize_t>(sizeof(us)) || us < 0) {
+            std::cerr << "bench_startup: worker " << w << " failed to start from the artifact" << std::endl;
+        } else {
+            times.push_back(us);
+        }
+        ::close(fds[w]);
+        ::waitpid(pids[w], 0, 0);
+    }
+    return times;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::string curve = take_curve_arg(argc, argv);
+    int n = 4;
+    int workers = 8;
+    std::string path = "/tmp/dntat_startup_" + std::to_string(::getpid()) + ".pre";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--signers") {
+            n = std::atoi(argv[i + 1]);
+        } else if (flag == "--workers") {
+            workers = std::atoi(argv[i + 1]);
+        } else if (flag == "--artifact") {
+            path = argv[i + 1];
+        } else {
+            std::cerr << "unknown option " << flag << std::endl;
+            return 1;
+        }
+    }
+    if (n < 1 || workers < 0) {
+        std::cerr << "--signers must be positive and --workers non-negative" << std::endl;
+        return 1;
+    }
+
+    auto start = steady_clock::now();
+    if (!init_curve(curve)) {
+        return 1;
+    }
+    double init_us = duration<double, std::micro>(steady_clock::now() - start).count();
+
+    // The committee: keys made once, outside any timed step.
+    DNTAT_PS keygen(n);
+    std::vector<PublicKey> pks;
+    std::vector<SecretKey> sks;
+    for (int i = 0; i < n; ++i) {
+        auto keypair = keygen.S_keygen();
+        pks.push_back(keypair.first);
+        sks.push_back(keypair.second);
+    }
+
+    std::cout << "=== DNTAT worker startup, " << n << " signers ===" << std::endl;
+    std::cout << std::left << std::setw(44) << "Step" << std::right << std::setw(12) << "Time (us)" << std::endl;
+    row("initPairing (either way)", init_us);
+
+    double generators_us = time_us([&]() { DNTAT_PS dntat(n); });
+    DNTAT_PS cold(n);
+    double keyaggr_us = time_us([&]() { cold.keyaggr(pks); });
+    double tables_us = time_us([&]() { cold.precompute(); });
+    row("scratch: generators (hash to curve)", generators_us);
+    row("scratch: MuSig coefficients + keyaggr", keyaggr_us);
+    row("scratch: g1 table + g2 lines", tables_us);
+    row("scratch: total", generators_us + keyaggr_us + tables_us);
+
+    double write_us;
+    try {
+        write_us = time_us([&]() { DNTATArtifact::write(path, cold, pks); });
+    } catch (const std::exception& e) {
+        std::cerr << "bench_startup: " << e.what() << std::endl;
+        return 1;
+    }
+    double map_us = time_us([&]() {
+        DNTATArtifact artifact(path);
+        DNTAT_PS dntat(artifact);
+    });
+    DNTATArtifact artifact(path);
+    row("artifact: write (" + std::to_string(artifact.file_bytes() / 1024) + " KiB, once)", write_us);
+    row("artifact: map + digest + attach", map_us);
+
+    if (workers > 0) {
+        std::vector<double> times = spawn_workers(path, workers);
+        if (!times.empty()) {
+            row("artifact: " + std::to_string(workers) + " new workers at once, p50", median(times));
+            row("artifact: " + std::to_string(workers) + " new workers at once, max",
+                *std::max_element(times.begin(), times.end()));
+        }
+    }
+
+    // Issued through the artifact's g1 table, aggregated from scratch, and
+    // verified both ways; then verify() with and without g2's lines.
+    DNTAT_PS plain(n);
+    DNTAT_PS mapped(artifact);
+    auto apk = plain.keyaggr(pks);
+    auto user = mapped.U_keygen();
+    DNTAT_PS::SignResult sign_result = mapped.sign(sks, pks, user.second, user.first);
+    Token token = plain.tokenaggr(sign_result.sigma_bars, sign_result.hbar, sign_result.omega, pks);
+    bool agree = mapped.keyaggr(pks) == apk && plain.verify(token, apk, user.second) &&
+                 mapped.verify(token, apk, user.second);
+    std::cout << std::endl;
+    std::cout << std::left << std::setw(44) << "verify()" << std::right << std::setw(12) << "Time (us)" << std::endl;
+    row("pairings", time_us([&]() { plain.verify(token, apk, user.second); }));
+    row("stored g2 lines, one final exponentiation", time_us([&]() { mapped.verify(token, apk, user.second); }));
+    std::cout << "Scratch and artifact instances agree: " << (agree ? "yes" : "NO") << std::endl;
+
+    // A flipped byte in the table must be caught by the digest.
+    const std::string corrupt = path + ".corrupt";
+    {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        bytes[bytes.size() / 2] ^= 1;
+        std::ofstream out(corrupt.c_str(), std::ios::binary);
+        out.write(bytes.data(), bytes.size());
+    }
+    bool refused = false;
+    try {
+        DNTATArtifact bad(corrupt);
+    } catch (const std::exception&) {
+        refused = true;
+    }
+    std::cout << "Corrupted artifact refused: " << (refused ? "yes" : "NO") << std::endl;
+    ::unlink(corrupt.c_str());
+    ::unlink(path.c_str());
+    return agree && refused ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+#include "dntat_ps.h"
+#include "dntat_bench.h"
+#include "dntat_coordinator.h"
+#include "dntat_latency.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+// End-to-end DNTAT issuance latency for a committee spread across regions,
+// simulated on one machine.
+//
+// Every signer is a local dntat_signerd process that holds its share back
+// by a latency sample drawn around its region's round-trip time from the
+// coordinator, and optionally drops shares. For each committee size, signers
+// are assigned to regions round robin and --parallel coordinators issue
+// tokens concurrently (the injected delays are timers, not CPU, so they
+// overlap). The report gives the fraction of issuances completed within
+// --deadline-ms and the latency distribution of those that were, which is
+// what a committee size and a coordinator timeout are chosen from.
+//
+// Usage: bench_wan [--curve bn254|bls12_381|bn462] [--signers 1,4,8,16] [--issuances 200] [--parallel 8]
+//                  [--dist const|lognormal|pareto] [--sigma 0.3] [--alpha 2.5]
+//                  [--drop 0] [--deadline-ms 2000]
+//                  [--regions us-east:2,us-west:65,eu-west:80,ap-northeast:160,ap-southeast:220,sa-east:120]
+//                  [--signerd <dir of this binary>/dntat_signerd]
+
+namespace {
+
+struct Region {
+    std::string name;
+    double rtt_ms;
+};
+
+struct Options {
+    std::vector<int> signers;
+    int issuances = 200;
+    int parallel = 8;
+    std::string dist = "lognormal";
+    double sigma = 0.3;
+    double alpha = 2.5;
+    double drop = 0;
+    int deadline_ms = 2000;
+    std::vector<Region> regions;
+    std::string signerd;
+};
+
+std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> items;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, sep)) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// Delay spec for a signer in a region, e.g. "lognormal:80,0.3".
+std::string delay_spec(const Options& opt, const Region& region) {
+    std::ostringstream spec;
+    if (opt.dist == "const") {
+        spec << "const:" << region.rtt_ms;
+    } else if (opt.dist == "lognormal") {
+        spec << "lognormal:" << region.rtt_ms << "," << opt.sigma;
+    } else if (opt.dist == "pareto") {
+        // Scaled so the median is the region's RTT: median = min * 2^(1/alpha).
+        spec << "pareto:" << region.rtt_ms / std::pow(2.0, 1.0 / opt.alpha) << "," << opt.alpha;
+    } else {
+        throw std::invalid_argument("unknown --dist " + opt.dist);
+    }
+    LatencyModel check(spec.str());
+    (void)check;
+    return spec.str();
+}
+
+// --delay and --drop for each of n signers, signer i in region i mod R.
+std::vector<std::vector<std::string> > fault_args(const Options& opt, size_t n) {
+    std::vector<std::vector<std::string> > args(n);
+    for (size_t i = 0; i < n; ++i) {
+        args[i].push_back("--delay");
+        args[i].push_back(delay_spec(opt, opt.regions[i % opt.regions.size()]));
+        args[i].push_back("--drop");
+        args[i].push_back(std::to_string(opt.drop));
+    }
+    return args;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::string curve = take_curve_arg(argc, argv);
+    Options opt;
+    std::string signers = "1,4,8,16";
+    std::string regions = "us-east:2,us-west:65,eu-west:80,ap-northeast:160,ap-southeast:220,sa-east:120";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        const char* value = argv[i + 1];
+        if (flag == "--signers") {
+            signers = value;
+        } else if (flag == "--issuances") {
+            opt.issuances = std::atoi(value);
+        } else if (flag == "--parallel") {
+            opt.parallel = std::atoi(value);
+        } else if (flag == "--dist") {
+            opt.dist = value;
+        } else if (flag == "--sigma") {
+            opt.sigma = std::atof(value);
+        } else if (flag == "--alpha") {
+            opt.alpha = std::atof(value);
+        } else if (flag == "--drop") {
+            opt.drop = std::atof(value);
+        } else if (flag == "--deadline-ms") {
+            opt.deadline_ms = std::atoi(value);
+        } else if (flag == "--regions") {
+            regions = value;
+        } else if (flag == "--signerd") {
+            opt.signerd = value;
+        } else {
+            std::cerr << "unknown option " << flag << std::endl;
+            return 1;
+        }
+    }
+    for (const std::string& n : split(signers, ',')) {
+        opt.signers.push_back(std::atoi(n.c_str()));
+    }
+    for (const std::string& r : split(regions, ',')) {
+        size_t colon = r.rfind(':');
+        if (colon == std::string::npos) {
+            std::cerr << "region must be <name>:<rtt_ms>, got " << r << std::endl;
+            return 1;
+        }
+        Region region;
+        region.name = r.substr(0, colon);
+        region.rtt_ms = std::atof(r.c_str() + colon + 1);
+        opt.regions.push_back(region);
+    }
+    if (opt.signerd.empty()) {
+        opt.signerd = default_signerd(argv[0]);
+    }
+    if (opt.signers.empty() || opt.regions.empty() || opt.issuances < 1 || opt.parallel < 1) {
+        std::cerr << "--signers, --regions, --issuances and --parallel must be non-empty / positive" << std::endl;
+        return 1;
+    }
+    try {
+        delay_spec(opt, opt.regions[0]);
+    } catch (const std::exception& e) {
+        std::cerr << "bench_wan: " << e.what() << std::endl;
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if (!init_curve(curve)) {
+        return 1;
+    }
+
+    std::cout << "=== DNTAT issuance across regions: " << opt.dist << " reply latency";
+    if (opt.dist == "lognormal") {
+        std::cout << " (sigma " << opt.sigma << ")";
+    } else if (opt.dist == "pareto") {
+        std::cout << " (alpha " << opt.alpha << ")";
+    }
+    std::cout << ", drop " << opt.drop << ", deadline " << opt.deadline_ms << " ms ===" << std::endl;
+    std::cout << "Signer i is in region i mod " << opt.regions.size() << ":";
+    for (const Region& r : opt.regions) {
+        std::cout << " " << r.name << " (" << r.rtt_ms << " ms)";
+    }
+    std::cout << std::endl;
+    std::cout << std::left << std::setw(9) << "Signers" << std::right << std::setw(10) << "in time"
+              << std::setw(11) << "p50 (ms)" << std::setw(11) << "p90 (ms)" << std::setw(11) << "p99 (ms)"
+              << std::setw(11) << "max (ms)" << std::endl;
+
+    for (int n : opt.signers) {
+        if (n < 1) {
+            continue;
+        }
+        std::vector<std::string> addrs;
+        for (int i = 0; i < n; ++i) {
+            addrs.push_back("unix:/tmp/dntat_wan_" + std::to_string(::getpid()) + "_" + std::to_string(i) + ".sock");
+        }
+        std::vector<pid_t> pids;
+        std::vector<double> latencies;
+        std::atomic<int> missed(0);
+        try {
+            pids = spawn_signers(opt.signerd, curve, addrs, fault_args(opt, addrs.size()));
+            DNTAT_PS dntat(n);
+            std::vector<std::unique_ptr<SignerCoordinator> > coordinators;
+            for (int c = 0; c < opt.parallel; ++c) {
+                coordinators.emplace_back(new SignerCoordinator(addrs, milliseconds(10000),
+                                                                microseconds(opt.deadline_ms * 1000LL)));
+            }
+            auto apk = dntat.keyaggr(coordinators[0]->pks());
+            auto user_keypair = dntat.U_keygen();
+
+            std::mutex latencies_mutex;
+            std::atomic<int> next(0), invalid(0);
+            std::vector<std::thread> threads;
+            for (int c = 0; c < opt.parallel; ++c) {
+                threads.emplace_back([&, c]() {
+                    Token token;
+                    while (next.fetch_add(1) < opt.issuances) {
+                        auto start = steady_clock::now();
+                        if (!coordinators[c]->issue(dntat, user_keypair.second, user_keypair.first, token)) {
+                            missed.fetch_add(1);
+                            continue;
+                        }
+                        double ms = duration<double, std::milli>(steady_clock::now() - start).count();
+                        if (!dntat.verify(token, apk, user_keypair.second)) {
+                            invalid.fetch_add(1);
+                        }
+                        std::lock_guard<std::mutex> lock(latencies_mutex);
+                        latencies.push_back(ms);
+                    }
+                });
+            }
+            for (auto& t : threads) {
+                t.join();
+            }
+            if (invalid.load() != 0) {
+                std::cerr << "bench_wan: " << invalid.load() << " issued tokens did not verify" << std::endl;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "bench_wan: " << e.what() << std::endl;
+            stop_signers(pids);
+            return 1;
+        }
+        stop_signers(pids);
+        for (const std::string& addr : addrs) {
+            ::unlink(addr.c_str() + 5);
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << std::left << std::setw(9) << n << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(9) << 100.0 * latencies.size() / opt.issuances << "%";
+        if (latencies.empty()) {
+            std::cout << "  (no issuance completed in time)" << std::endl;
+            continue;
+        }
+        std::cout << std::setw(11) << percentile(latencies, 0.50) << std::setw(11) << percentile(latencies, 0.90)
+                  << std::setw(11) << percentile(latencies, 0.99) << std::setw(11) << latencies.back() << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,615 @@
+#include "dntat_ps.h"
+#include "dntat_wire.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+// DNTAT issuance daemon (Linux).
+//
+// One thread owns every socket through a non-blocking epoll loop. WIRE_ISSUE
+// requests from all connections are gathered into a micro-batch that is
+// handed to the worker pool when it reaches --max-batch requests or when its
+// oldest request has waited --batch-us microseconds, whichever comes first.
+// Workers compute the n signer shares of every request in the batch (the
+// batch is split at (request, signer) granularity) and signal the loop
+// through an eventfd. Each connection keeps its requests in arrival order
+// and a reply is written only once every earlier request on that connection
+// has been answered, so clients can pipeline. A connection that has too
+// many requests unanswered or too many reply bytes unsent is neither read
+// from nor parsed until it drains, so a client that sends faster than it
+// reads is held back by its socket buffers rather than by the daemon's
+// memory. A client that shuts down its sending side still gets the replies
+// to everything it sent before the connection is closed.
+//
+// Request points come from users, so they must be in the prime-order
+// subgroup; the check is made once per micro-batch (SubgroupBatch) when it
+// is dispatched, and a request that fails it gets WIRE_ERROR.
+//
+// The daemon holds all n signer keys, like DNTAT_PS::sign(); see
+// dntat_signerd for one key per process.
+//
+// Usage: dntat_issuerd [--curve bn254|bls12_381|bn462]
+//                      [--listen unix:/tmp/dntat_issuerd.sock] [--signers 4]
+//                      [--workers <cores>] [--batch-us 200] [--max-batch 64]
+
+using namespace std::chrono;
+
+namespace {
+
+struct Options {
+    std::string listen = "unix:/tmp/dntat_issuerd.sock";
+    int signers = 4;
+    int workers = static_cast<int>(std::thread::hardware_concurrency());
+    int batch_us = 200;
+    size_t max_batch = 64;
+};
+
+// Per-connection limits. At kOutHighWater unsent reply bytes or kMaxPending
+// unanswered requests the connection stops being read and parsed. At most
+// kMaxInBytes, one frame of the largest size wire_get_header() accepts, are
+// buffered from it.
+enum {
+    kOutHighWater = 1 << 20,
+    kMaxPending = 1024,
+    kMaxInBytes = WIRE_HEADER_BYTES + WIRE_MAX_PAYLOAD
+};
+
+struct Connection;
+
+// One WIRE_ISSUE request, from decode to reply.
+struct Pending {
+    std::shared_ptr<Connection> conn;
+    uint32_t id;
+    DNTAT_PS::IssuanceRequest request;
+    std::vector<G1> shares;
+    std::vector<unsigned char> reply;  // whole frame once ready
+    bool ready;
+};
+
+struct Connection {
+    int fd;
+    bool open;
+    bool eof;      // the peer will send nothing more
+    bool parsing;  // inside parse_frames()
+    uint32_t events;  // epoll interest currently registered
+    std::vector<unsigned char> in;
+    std::vector<unsigned char> out;
+    size_t out_sent;
+    std::deque<std::shared_ptr<Pending> > order;  // unanswered, arrival order
+};
+
+struct Batch {
+    std::vector<std::shared_ptr<Pending> > items;
+    std::atomic<size_t> next;
+    std::atomic<size_t> remaining;
+};
+
+class WorkerPool {
+public:
+    WorkerPool(int workers, const std::vector<SecretKey>& sks, int done_fd)
+        : sks_(sks), done_fd_(done_fd), stop_(false) {
+        for (int i = 0; i < workers; ++i) {
+            threads_.emplace_back(&WorkerPool::run, this);
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : threads_) {
+            t.join();
+        }
+    }
+
+    void submit(const std::shared_ptr<Batch>& batch) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(batch);
+        }
+        cv_.notify_all();
+    }
+
+    // Batches whose shares are all computed, in completion order.
+    std::vector<std::shared_ptr<Batch> > take_done() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::shared_ptr<Batch> > done;
+        done.swap(done_);
+        return done;
+    }
+
+private:
+    void run() {
+        const size_t n = sks_.size();
+        for (;;) {
+            std::shared_ptr<Batch> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&]() { return stop_ || !queue_.empty(); });
+                if (stop_) {
+                    return;
+                }
+                batch = queue_.front();
+            }
+
+            // Claim (request, signer) items until the batch is exhausted;
+            // whoever claims past the end retires it from the queue.
+            const size_t total = batch->items.size() * n;
+            for (;;) {
+                size_t k = batch->next.fetch_add(1);
+                if (k >= total) {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (!queue_.empty() && queue_.front() == batch) {
+                        queue_.pop_front();
+                    }
+                    break;
+                }
+                Pending& p = *batch->items[k / n];
+                DNTAT_PS::sign_share(sks_[k % n], p.request, p.shares[k % n]);
+                if (batch->remaining.fetch_sub(1) == 1) {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        done_.push_back(batch);
+                    }
+                    uint64_t one = 1;
+                    ssize_t ignored = ::write(done_fd_, &one, sizeof(one));
+                    (void)ignored;
+                }
+            }
+        }
+    }
+
+    const std::vector<SecretKey>& sks_;
+    int done_fd_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::shared_ptr<Batch> > queue_;
+    std::vector<std::shared_ptr<Batch> > done_;
+    bool stop_;
+    std::vector<std::thread> threads_;
+};
+
+class Issuer {
+public:
+    Issuer(const Options& opt, const std::vector<PublicKey>& pks, const std::vector<SecretKey>& sks)
+        : opt_(opt), keys_payload_(wire_encode_keys(pks)), num_signers_(sks.size()) {
+        listen_fd_ = wire_listen(opt.listen);
+        set_nonblocking(listen_fd_);
+        epoll_fd_ = ::epoll_create1(0);
+        done_fd_ = ::eventfd(0, EFD_NONBLOCK);
+        timer_fd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        if (epoll_fd_ < 0 || done_fd_ < 0 || timer_fd_ < 0) {
+            throw std::runtime_error("dntat_issuerd: epoll setup failed");
+        }
+        watch(listen_fd_, EPOLLIN);
+        watch(done_fd_, EPOLLIN);
+        watch(timer_fd_, EPOLLIN);
+        pool_.reset(new WorkerPool(opt.workers, sks, done_fd_));
+    }
+
+    void run() {
+        std::vector<epoll_event> events(256);
+        for (;;) {
+            int n = ::epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), -1);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("dntat_issuerd: epoll_wait failed");
+            }
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listen_fd_) {
+                    accept_all();
+                } else if (fd == done_fd_) {
+                    uint64_t count;
+                    ssize_t ignored = ::read(done_fd_, &count, sizeof(count));
+                    (void)ignored;
+                    finish_batches();
+                } else if (fd == timer_fd_) {
+                    uint64_t expirations;
+                    ssize_t ignored = ::read(timer_fd_, &expirations, sizeof(expirations));
+                    (void)ignored;
+                    dispatch();
+                } else {
+                    auto it = conns_.find(fd);
+                    if (it == conns_.end()) {
+                        continue;
+                    }
+                    std::shared_ptr<Connection> conn = it->second;
+                    if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                        close_conn(conn);  // closed both ways; replies cannot be delivered
+                        continue;
+                    }
+                    if (events[i].events & EPOLLIN) {
+                        on_readable(conn);
+                    }
+                    if (conn->open && (events[i].events & EPOLLOUT)) {
+                        pump(conn);
+                    }
+                }
+            }
+            while (!resume_.empty()) {
+                std::vector<std::shared_ptr<Connection> > resume;
+                resume.swap(resume_);
+                for (const auto& conn : resume) {
+                    pump(conn);
+                }
+            }
+        }
+    }
+
+private:
+    static void set_nonblocking(int fd) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    }
+
+    void watch(int fd, uint32_t events) {
+        epoll_event ev;
+        ev.events = events;
+        ev.data.fd = fd;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    void rewatch(int fd, uint32_t events) {
+        epoll_event ev;
+        ev.events = events;
+        ev.data.fd = fd;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+    }
+
+    void accept_all() {
+        for (;;) {
+            int fd = ::accept(listen_fd_, 0, 0);
+            if (fd < 0) {
+                return;  // EAGAIN, or a transient error
+            }
+            set_nonblocking(fd);
+            wire_tune_socket(fd, opt_.listen.compare(0, 5, "unix:") == 0 ? AF_UNIX : AF_INET);
+            std::shared_ptr<Connection> conn(new Connection());
+            conn->fd = fd;
+            conn->open = true;
+            conn->eof = false;
+            conn->parsing = false;
+            conn->events = EPOLLIN;
+            conn->out_sent = 0;
+            conns_[fd] = conn;
+            watch(fd, conn->events);
+        }
+    }
+
+    void close_conn(const std::shared_ptr<Connection>& conn) {
+        if (!conn->open) {
+            return;
+        }
+        conn->open = false;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, conn->fd, 0);
+        ::close(conn->fd);
+        conns_.erase(conn->fd);
+        conn->order.clear();  // batches in flight keep their own references
+    }
+
+    void on_readable(const std::shared_ptr<Connection>& conn) {
+        unsigned char buf[64 * 1024];
+        while (conn->in.size() < kMaxInBytes) {
+            ssize_t r = ::recv(conn->fd, buf, std::min(sizeof(buf), kMaxInBytes - conn->in.size()), 0);
+            if (r > 0) {
+                conn->in.insert(conn->in.end(), buf, buf + r);
+                continue;
+            }
+            if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            if (r == 0) {
+                conn->eof = true;  // answer what was sent, then close
+                break;
+            }
+            close_conn(conn);
+            return;
+        }
+        pump(conn);
+    }
+
+    static bool backlogged(const Connection& conn) {
+        return conn.out.size() - conn.out_sent >= kOutHighWater || conn.order.size() >= kMaxPending;
+    }
+
+    // Writes what is ready and handles buffered frames while the connection
+    // is under its limits; called whenever a connection may have made
+    // progress. Closes it once the peer has stopped sending and everything
+    // has been answered.
+    void pump(const std::shared_ptr<Connection>& conn) {
+        flush(conn);
+        if (conn->parsing) {
+            return;  // reached from a frame of this connection; parse_frames() goes on
+        }
+        while (conn->open && !backlogged(*conn)) {
+            size_t before = conn->in.size();
+            if (!parse_frames(conn) || conn->in.size() == before) {
+                break;
+            }
+            flush(conn);
+        }
+        if (conn->open && conn->eof && conn->order.empty() && conn->out.empty()) {
+            close_conn(conn);
+        }
+    }
+
+    // Handles complete frames from the front of conn->in until none is
+    // left or the connection reaches a limit. false if a malformed frame
+    // closed the connection.
+    bool parse_frames(const std::shared_ptr<Connection>& conn) {
+        size_t at = 0;
+        conn->parsing = true;
+        try {
+            while (conn->open && !backlogged(*conn) && conn->in.size() - at >= WIRE_HEADER_BYTES) {
+                uint8_t type;
+                uint32_t id, len;
+                wire_get_header(&conn->in[at], type, id, len);
+                if (conn->in.size() - at < WIRE_HEADER_BYTES + len) {
+                    break;
+                }
+                const unsigned char* payload = &conn->in[at + WIRE_HEADER_BYTES];
+                on_frame(conn, type, id, payload, len);
+                at += WIRE_HEADER_BYTES + len;
+            }
+        } catch (const std::exception&) {
+            // A malformed frame ends the connection; the stream cannot be
+            // resynchronised.
+            conn->parsing = false;
+            close_conn(conn);
+            return false;
+        }
+        conn->parsing = false;
+        conn->in.erase(conn->in.begin(), conn->in.begin() + at);
+        return true;
+    }
+
+    void on_frame(const std::shared_ptr<Connection>& conn, uint8_t type, uint32_t id,
+                  const unsigned char* payload, size_t len) {
+        std::shared_ptr<Pending> p(new Pending());
+        p->conn = conn;
+        p->id = id;
+        p->ready = false;
+        conn->order.push_back(p);
+
+        if (type == WIRE_GET_KEYS) {
+            wire_append_frame(p->reply, WIRE_KEYS, id, keys_payload_);
+            p->ready = true;
+            return;
+        }
+        if (type != WIRE_ISSUE) {
+            std::string msg = "unknown message type";
+            wire_append_frame(p->reply, WIRE_ERROR, id, std::vector<unsigned char>(msg.begin(), msg.end()));
+            p->ready = true;
+            return;
+        }
+
+        wire_decode(payload, len, p->request, checks_, batch_.size());
+        p->shares.resize(num_signers_);
+        if (batch_.empty()) {
+            arm_timer(opt_.batch_us);
+        }
+        batch_.push_back(p);
+        if (batch_.size() >= opt_.max_batch) {
+            dispatch();
+        }
+    }
+
+    void arm_timer(int us) {
+        itimerspec spec;
+        std::memset(&spec, 0, sizeof(spec));
+        spec.it_value.tv_sec = us / 1000000;
+        spec.it_value.tv_nsec = (us % 1000000) * 1000L;
+        if (us <= 0) {
+            spec.it_value.tv_nsec = 1;  // zero would disarm
+        }
+        ::timerfd_settime(timer_fd_, 0, &spec, 0);
+    }
+
+    void dispatch() {
+        if (batch_.empty()) {
+            return;
+        }
+        itimerspec off;
+        std::memset(&off, 0, sizeof(off));
+        ::timerfd_settime(timer_fd_, 0, &off, 0);
+
+        if (!checks_.check()) {
+            reject(checks_.bad());
+        }
+        checks_.clear();
+        if (batch_.empty()) {
+            return;
+        }
+
+        std::shared_ptr<Batch> b(new Batch());
+        b->items.swap(batch_);
+        b->next.store(0);
+        b->remaining.store(b->items.size() * num_signers_);
+        pool_->submit(b);
+    }
+
+    // Answers the requests at the given (ascending) batch positions with
+    // WIRE_ERROR and takes them out of the batch.
+    void reject(const std::vector<size_t>& positions) {
+        static const std::string msg = "request point outside the subgroup";
+        std::vector<std::shared_ptr<Pending> > kept;
+        std::vector<std::shared_ptr<Connection> > touched;
+        size_t next = 0;
+        for (size_t i = 0; i < batch_.size(); ++i) {
+            if (next < positions.size() && positions[next] == i) {
+                ++next;
+                Pending& p = *batch_[i];
+                wire_append_frame(p.reply, WIRE_ERROR, p.id, std::vector<unsigned char>(msg.begin(), msg.end()));
+                p.ready = true;
+                if (p.conn->open) {
+                    touched.push_back(p.conn);
+                }
+            } else {
+                kept.push_back(batch_[i]);
+            }
+        }
+        batch_.swap(kept);
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+        // Only flushed here: dispatch() still owns checks_, so no new frame
+        // may be parsed until it returns.
+        for (const auto& conn : touched) {
+            flush(conn);
+            resume_.push_back(conn);
+        }
+    }
+
+    void finish_batches() {
+        std::vector<std::shared_ptr<Batch> > done = pool_->take_done();
+        std::vector<std::shared_ptr<Connection> > touched;
+        for (const auto& b : done) {
+            for (const auto& p : b->items) {
+                if (!p->conn->open) {
+                    continue;
+                }
+                wire_append_frame(p->reply, WIRE_SHARES, p->id,
+                                  wire_encode_shares(p->shares.data(), p->shares.size()));
+                p->ready = true;
+                touched.push_back(p->conn);
+            }
+        }
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+        for (const auto& conn : touched) {
+            pump(conn);
+        }
+    }
+
+    // Moves answered requests at the head of the connection's order into its
+    // output buffer and writes as much as the socket takes.
+    void flush(const std::shared_ptr<Connection>& conn) {
+        if (!conn->open) {
+            return;
+        }
+        while (!conn->order.empty() && conn->order.front()->ready) {
+            const std::vector<unsigned char>& reply = conn->order.front()->reply;
+            conn->out.insert(conn->out.end(), reply.begin(), reply.end());
+            conn->order.pop_front();
+        }
+        while (conn->out_sent < conn->out.size()) {
+            ssize_t w = ::send(conn->fd, conn->out.data() + conn->out_sent,
+                               conn->out.size() - conn->out_sent, MSG_NOSIGNAL);
+            if (w < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                close_conn(conn);
+                return;
+            }
+            conn->out_sent += w;
+        }
+        if (conn->out_sent == conn->out.size()) {
+            conn->out.clear();
+            conn->out_sent = 0;
+        }
+        uint32_t events = 0;
+        if (!conn->eof && !backlogged(*conn)) {
+            events |= EPOLLIN;
+        }
+        if (!conn->out.empty()) {
+            events |= EPOLLOUT;
+        }
+        if (events != conn->events) {
+            conn->events = events;
+            rewatch(conn->fd, events);
+        }
+    }
+
+    Options opt_;
+    std::vector<unsigned char> keys_payload_;
+    size_t num_signers_;
+    int listen_fd_;
+    int epoll_fd_;
+    int done_fd_;
+    int timer_fd_;
+    std::map<int, std::shared_ptr<Connection> > conns_;
+    std::vector<std::shared_ptr<Pending> > batch_;
+    SubgroupBatch checks_;  // points of batch_, owner = position in batch_
+    std::vector<std::shared_ptr<Connection> > resume_;  // answered by reject(), to pump
+    std::unique_ptr<WorkerPool> pool_;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::string curve = take_curve_arg(argc, argv);
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        const char* value = argv[i + 1];
+        if (flag == "--listen") {
+            opt.listen = value;
+        } else if (flag == "--signers") {
+            opt.signers = std::atoi(value);
+        } else if (flag == "--workers") {
+            opt.workers = std::atoi(value);
+        } else if (flag == "--batch-us") {
+            opt.batch_us = std::atoi(value);
+        } else if (flag == "--max-batch") {
+            opt.max_batch = std::strtoul(value, 0, 10);
+        } else {
+            std::cerr << "unknown option " << flag << std::endl;
+            return 1;
+        }
+    }
+    if (opt.signers < 1 || opt.workers < 1 || opt.max_batch < 1) {
+        std::cerr << "--signers, --workers and --max-batch must be positive" << std::endl;
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if (!init_curve(curve)) {
+        return 1;
+    }
+    DNTAT_PS dntat(opt.signers);
+    std::vector<PublicKey> pks;
+    std::vector<SecretKey> sks;
+    for (int i = 0; i < opt.signers; ++i) {
+        auto keypair = dntat.S_keygen();
+        pks.push_back(keypair.first);
+        sks.push_back(keypair.second);
+    }
+
+    try {
+        Issuer issuer(opt, pks, sks);
+        std::cout << "dntat_issuerd: " << opt.signers << " signers, " << opt.workers << " workers, batch "
+                  << opt.max_batch << " / " << opt.batch_us << " us, listening on " << opt.listen << std::endl;
+        issuer.run();
+    } catch (const std::exception& e) {
+        std::cerr << "dntat_issuerd: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,289 @@
+#include "dntat_ps.h"
+#include "dntat_bench.h"
+#include "dntat_wire.h"
+#include "wire_bench.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Open-loop load generator for dntat_issuerd.
+//
+// For each offered rate, --conns connections each send WIRE_ISSUE requests
+// on a fixed schedule (rate / conns per second, regardless of replies) for
+// --duration seconds while a second thread per connection reads the
+// pipelined replies. Latency is measured from a request's scheduled send
+// time, so a server that falls behind is charged for the queueing it causes.
+// The first reply on every connection is unblinded, aggregated and verified.
+// Before the first rate, a request with a point outside G1 is sent between
+// two valid ones and must get WIRE_ERROR while its neighbours get shares
+// (skipped on curves where G1 has no cofactor).
+//
+// Usage: dntat_loadgen [--curve bn254|bls12_381|bn462]
+//                      [--connect unix:/tmp/dntat_issuerd.sock] [--conns 4]
+//                      [--rates 250,500,1000,2000,4000] [--duration 5]
+//                      [--pool 256]
+
+using namespace std::chrono;
+
+namespace {
+
+struct Options {
+    std::string connect = "unix:/tmp/dntat_issuerd.sock";
+    int conns = 4;
+    std::vector<double> rates;
+    double duration = 5;
+    int pool = 256;
+};
+
+// Requests are expensive to blind, so a pool is prepared up front and sent
+// round robin; the daemon does the same work for a repeated request.
+struct Prepared {
+    DNTAT_PS::IssuanceRequest request;
+    DNTAT_PS::IssuanceSecrets secrets;
+    std::vector<unsigned char> payload;
+};
+
+struct RunResult {
+    std::vector<double> latencies_us;
+    size_t sent;
+    double seconds;
+    int verified;
+    int failed;
+    int send_errors;
+};
+
+bool check_reply(DNTAT_PS& dntat, const std::vector<PublicKey>& pks, const std::array<G2, 4>& apk,
+                 const Prepared& prepared, const WireFrame& reply) {
+    if (reply.type != WIRE_SHARES) {
+        return false;
+    }
+    std::vector<G1> shares = wire_decode_shares(reply.payload);
+    if (shares.size() != pks.size()) {
+        return false;
+    }
+    std::vector<G1> sigma_bars(shares.size());
+    for (size_t i = 0; i < shares.size(); ++i) {
+        DNTAT_PS::unblind_share(pks[i], prepared.secrets, shares[i], sigma_bars[i]);
+    }
+    Token token = dntat.tokenaggr(sigma_bars, prepared.secrets.hbar, prepared.secrets.omega, pks);
+    return dntat.verify(token, apk, prepared.secrets.sku);
+}
+
+RunResult run_rate(const Options& opt, double rate, DNTAT_PS& dntat, const std::vector<PublicKey>& pks,
+                   const std::array<G2, 4>& apk, const std::vector<Prepared>& pool) {
+    const double per_conn = rate / opt.conns;
+    const size_t count = std::max<size_t>(1, static_cast<size_t>(per_conn * opt.duration));
+    const nanoseconds interval(static_cast<long long>(1e9 / per_conn));
+
+    std::vector<int> fds(opt.conns);
+    for (int c = 0; c < opt.conns; ++c) {
+        fds[c] = wire_connect(opt.connect);
+    }
+
+    std::vector<std::vector<double> > latencies(opt.conns);
+    std::atomic<int> verified(0), failed(0), send_errors(0);
+    std::vector<std::thread> threads;
+    const steady_clock::time_point start = steady_clock::now() + milliseconds(10);
+
+    for (int c = 0; c < opt.conns; ++c) {
+        // Connections start staggered across one interval.
+        const steady_clock::time_point first = start + interval * c / opt.conns;
+
+        threads.emplace_back([&, c, first]() {
+            try {
+                for (size_t k = 0; k < count; ++k) {
+                    std::this_thread::sleep_until(first + interval * k);
+                    const Prepared& p = pool[(c + k * opt.conns) % pool.size()];
+                    wire_send(fds[c], WIRE_ISSUE, static_cast<uint32_t>(k), p.payload);
+                }
+            } catch (const std::exception&) {
+                // The connection is lost; wake the reader, which counts the
+                // replies that will not come as failures.
+                send_errors.fetch_add(1);
+                ::shutdown(fds[c], SHUT_RDWR);
+            }
+        });
+
+        threads.emplace_back([&, c, first]() {
+            latencies[c].reserve(count);
+            WireFrame reply;
+            for (size_t k = 0; k < count; ++k) {
+                bool received;
+                try {
+                    received = wire_recv(fds[c], reply);
+                } catch (const std::exception&) {
+                    received = false;
+                }
+                if (!received) {
+                    failed.fetch_add(1);
+                    return;
+                }
+                steady_clock::time_point now = steady_clock::now();
+                // Replies on a connection come back in request order.
+                if (reply.id != k) {
+                    failed.fetch_add(1);
+                    return;
+                }
+                latencies[c].push_back(duration<double, std::micro>(now - (first + interval * k)).count());
+                if (k == 0) {
+                    const Prepared& p = pool[c % pool.size()];
+                    (check_reply(dntat, pks, apk, p, reply) ? verified : failed).fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    RunResult result;
+    result.seconds = duration<double>(steady_clock::now() - start).count();
+    result.sent = count * opt.conns;
+    for (int c = 0; c < opt.conns; ++c) {
+        ::close(fds[c]);
+        result.latencies_us.insert(result.latencies_us.end(), latencies[c].begin(), latencies[c].end());
+    }
+    std::sort(result.latencies_us.begin(), result.latencies_us.end());
+    result.verified = verified.load();
+    result.failed = failed.load();
+    result.send_errors = send_errors.load();
+    return result;
+}
+
+// Sends a valid request, one with T[0] moved out of the subgroup, and a
+// valid one on a fresh connection. True if only the middle one is refused;
+// `checked` is false when G1 has no cofactor and there was nothing to send.
+bool check_subgroup_refusal(const Options& opt, const Prepared& prepared, bool& checked) {
+    DNTAT_PS::IssuanceRequest bad = prepared.request;
+    checked = off_subgroup_point(prepared.request.T[0], bad.T[0]);
+    if (!checked) {
+        return true;
+    }
+    int fd = wire_connect(opt.connect);
+    wire_send(fd, WIRE_ISSUE, 0, prepared.payload);
+    wire_send(fd, WIRE_ISSUE, 1, wire_encode_request(bad));
+    wire_send(fd, WIRE_ISSUE, 2, prepared.payload);
+    static const uint8_t expected[] = {WIRE_SHARES, WIRE_ERROR, WIRE_SHARES};
+    bool ok = true;
+    WireFrame reply;
+    for (uint32_t k = 0; k < 3 && ok; ++k) {
+        ok = wire_recv(fd, reply) && reply.id == k && reply.type == expected[k];
+    }
+    ::close(fd);
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::string curve = take_curve_arg(argc, argv);
+    Options opt;
+    std::string rates = "250,500,1000,2000,4000";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        const char* value = argv[i + 1];
+        if (flag == "--connect") {
+            opt.connect = value;
+        } else if (flag == "--conns") {
+            opt.conns = std::atoi(value);
+        } else if (flag == "--rates") {
+            rates = value;
+        } else if (flag == "--duration") {
+            opt.duration = std::atof(value);
+        } else if (flag == "--pool") {
+            opt.pool = std::atoi(value);
+        } else {
+            std::cerr << "unknown option " << flag << std::endl;
+            return 1;
+        }
+    }
+    std::stringstream ss(rates);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (std::atof(item.c_str()) > 0) {
+            opt.rates.push_back(std::atof(item.c_str()));
+        }
+    }
+    if (opt.conns < 1 || opt.pool < 1 || opt.duration <= 0 || opt.rates.empty()) {
+        std::cerr << "--conns, --pool, --duration and --rates must be positive" << std::endl;
+        return 1;
+    }
+
+    if (!init_curve(curve)) {
+        return 1;
+    }
+
+    std::vector<PublicKey> pks;
+    try {
+        int fd = wire_connect(opt.connect);
+        wire_send(fd, WIRE_GET_KEYS, 0, std::vector<unsigned char>());
+        WireFrame reply;
+        if (!wire_recv(fd, reply) || reply.type != WIRE_KEYS) {
+            throw std::runtime_error("no key reply");
+        }
+        pks = wire_decode_keys(reply.payload);
+        ::close(fd);
+    } catch (const std::exception& e) {
+        std::cerr << "dntat_loadgen: " << opt.connect << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    DNTAT_PS dntat(static_cast<int>(pks.size()));
+    auto apk = dntat.keyaggr(pks);
+    std::vector<Prepared> pool(opt.pool);
+    for (Prepared& p : pool) {
+        auto user_keypair = dntat.U_keygen();
+        dntat.issue_request(user_keypair.second, user_keypair.first, p.request, p.secrets);
+        p.payload = wire_encode_request(p.request);
+    }
+
+    try {
+        bool checked;
+        if (!check_subgroup_refusal(opt, pool[0], checked)) {
+            std::cerr << "dntat_loadgen: a request point outside G1 was not refused" << std::endl;
+            return 1;
+        }
+        if (checked) {
+            std::cout << "Request point outside G1: refused" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "dntat_loadgen: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "=== dntat_issuerd at " << opt.connect << ": " << pks.size() << " signers, "
+              << opt.conns << " connections, " << opt.duration << " s per rate ===" << std::endl;
+    std::cout << std::left << std::setw(12) << "Offered/s" << std::right << std::setw(14) << "Achieved/s"
+              << std::setw(12) << "p50 (ms)" << std::setw(12) << "p99 (ms)" << std::setw(12) << "max (ms)"
+              << std::endl;
+    for (double rate : opt.rates) {
+        RunResult r;
+        try {
+            r = run_rate(opt, rate, dntat, pks, apk, pool);
+        } catch (const std::exception& e) {
+            std::cerr << "dntat_loadgen: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << std::left << std::setw(12) << std::fixed << std::setprecision(0) << rate << std::right
+                  << std::setw(14) << r.latencies_us.size() / r.seconds << std::setprecision(2)
+                  << std::setw(12) << percentile(r.latencies_us, 0.50) / 1000
+                  << std::setw(12) << percentile(r.latencies_us, 0.99) / 1000
+                  << std::setw(12) << (r.latencies_us.empty() ? 0 : r.latencies_us.back() / 1000);
+        if (r.failed != 0 || r.verified != opt.conns) {
+            std::cout << "  (" << r.failed << " failed, " << r.verified << "/" << opt.conns << " verified)";
+        }
+        if (r.send_errors != 0) {
+            std::cout << "  (" << r.send_errors << " connections lost while sending)";
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -1,16 +1,80 @@
 #include "dntat_ps.h"
+#include "dntat_artifact.h"
+#include "scalar_mul.h"
+#include <algorithm>
 #include <iostream>
-#include <sstream>
 #include <cstring>
 #include <thread>
 #include <vector>
 #include <mutex>
 
-DNTAT_PS::DNTAT_PS(int num_signers) : num_signers(num_signers) {
+DNTAT_PS::DNTAT_PS(int num_signers) : num_signers(num_signers), g2_lines_mapped(0) {
     hashToG1(g1, "G1");
     hashToG2(g2, "G2");
 }
 
+DNTAT_PS::DNTAT_PS(const DNTATArtifact& artifact)
+    : g1(artifact.g1()), g2(artifact.g2()), num_signers(artifact.num_signers()),
+      g2_lines_mapped(artifact.lines()),
+      committee(artifact.keys(), artifact.keys() + artifact.num_signers()),
+      committee_a(artifact.coefficients(), artifact.coefficients() + artifact.num_signers()) {
+    g1_table.attach(artifact.table(), artifact.table_windows());
+    std::copy(artifact.apk(), artifact.apk() + 4, committee_apk.begin());
+}
+
+void DNTAT_PS::precompute() {
+    g1_table.init(g1);
+    precomputeG2(g2_lines, g2);
+    g2_lines_mapped = 0;
+}
+
+void DNTAT_PS::precompute(const std::vector<PublicKey>& pks) {
+    if (static_cast<int>(pks.size()) != num_signers) {
+        throw std::invalid_argument("precompute: expected one public key per signer");
+    }
+    precompute();
+    committee.clear();
+    committee_a.resize(num_signers);
+    compute_a(pks, committee_a.data());
+    committee_apk = keyaggr(pks);
+    committee = pks;
+}
+
+void DNTAT_PS::mul_g1(G1& z, const Fr& k) const {
+    if (g1_table.empty()) {
+        mul_secret(z, g1, k);
+    } else {
+        g1_table.mul(z, k);
+    }
+}
+
+const Fp6* DNTAT_PS::lines() const {
+    if (g2_lines_mapped) {
+        return g2_lines_mapped;
+    }
+    return g2_lines.empty() ? 0 : g2_lines.data();
+}
+
+size_t DNTAT_PS::precomputed_bytes() const {
+    return g1_table.windows() * FixedBaseTable<G1>::window_size() * sizeof(G1) +
+           g2_lines.size() * sizeof(Fp6) + committee.size() * sizeof(PublicKey) +
+           committee_a.size() * sizeof(Fr);
+}
+
+bool DNTAT_PS::is_committee(const std::vector<PublicKey>& pks) const {
+    if (committee.empty() || pks.size() != committee.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < pks.size(); ++i) {
+        for (int j = 0; j < 4; ++j) {
+            if (pks[i].g2_keys[j] != committee[i].g2_keys[j]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 void DNTAT_PS::hashToG1(G1& P, const std::string& m) {
     Fp t;
     t.setHashOf(m);
@@ -29,6 +93,36 @@ void DNTAT_PS::hashToFr(Fr& f, const void* data, size_t size) {
     f.setHashOf(data, size);
 }
 
+// Little-endian byte offset of the epoch inside omega. The user sets it;
+// signers only see omega blinded, so nothing checks it at issuance.
+static const size_t kEpochOffset = 24;
+
+static void make_omega(Fr& omega, uint32_t epoch) {
+    Fr r;
+    r.setByCSPRNG();
+    unsigned char bytes[MAX_FR_BYTES];
+    std::memset(bytes, 0, sizeof(bytes));
+    r.serialize(bytes, sizeof(bytes));
+    std::memset(bytes + kEpochOffset, 0, sizeof(bytes) - kEpochOffset);
+    for (int i = 0; i < 4; ++i) {
+        bytes[kEpochOffset + i] = static_cast<unsigned char>(epoch >> (8 * i));
+    }
+    if (omega.deserialize(bytes, Fr::getByteSize()) == 0) {
+        throw std::runtime_error("make_omega: epoch does not fit in Fr");
+    }
+}
+
+uint32_t DNTAT_PS::epoch_of(const Token& token) {
+    unsigned char bytes[MAX_FR_BYTES];
+    std::memset(bytes, 0, sizeof(bytes));
+    token.omega.serialize(bytes, sizeof(bytes));
+    uint32_t epoch = 0;
+    for (int i = 0; i < 4; ++i) {
+        epoch |= static_cast<uint32_t>(bytes[kEpochOffset + i]) << (8 * i);
+    }
+    return epoch;
+}
+
 std::pair<PublicKey, SecretKey> DNTAT_PS::S_keygen() {
     PublicKey pk;
     SecretKey sk;
@@ -38,11 +132,11 @@ std::pair<PublicKey, SecretKey> DNTAT_PS::S_keygen() {
     }
     
     for (size_t j = 0; j < sk.fr_keys.size(); ++j) {
-        G1::mul(pk.g1_keys[j], g1, sk.fr_keys[j]);
+        mul_g1(pk.g1_keys[j], sk.fr_keys[j]);
     }
     
     for (size_t j = 0; j < sk.fr_keys.size(); ++j) {
-        G2::mul(pk.g2_keys[j], g2, sk.fr_keys[j]);
+        mul_secret(pk.g2_keys[j], g2, sk.fr_keys[j]);
     }
     
     return std::make_pair(pk, sk);
@@ -53,59 +147,60 @@ std::pair<G1, Fr> DNTAT_PS::U_keygen() {
     G1 pku;
     
     sku.setByCSPRNG();
-    G1::mul(pku, g1, sku);
+    mul_g1(pku, sku);
     
     return std::make_pair(pku, sku);
 }
 
 Fr DNTAT_PS::H_agg(const std::vector<PublicKey>& pks, const G2& pk_i) {
-    std::stringstream ss;
+    ArenaScope scope;
+    ArenaVector<unsigned char> transcript;
+    transcript.reserve((pks.size() + 1) * MAX_G2_BYTES + 3);
     
+    unsigned char buf[MAX_G2_BYTES];
     for (const auto& pk : pks) {
-        unsigned char buf[96];
-        pk.g2_keys[0].serialize(buf, 96);
-        ss.write(reinterpret_cast<char*>(buf), 96);
+        size_t n = pk.g2_keys[0].serialize(buf, sizeof(buf));
+        transcript.insert(transcript.end(), buf, buf + n);
     }
     
-    unsigned char buf_i[96];
-    pk_i.serialize(buf_i, 96);
-    ss.write(reinterpret_cast<char*>(buf_i), 96);
+    size_t n_i = pk_i.serialize(buf, sizeof(buf));
+    transcript.insert(transcript.end(), buf, buf + n_i);
     
-    ss << "agg";
+    static const char tag[] = "agg";
+    transcript.insert(transcript.end(), tag, tag + 3);
     
-    std::string combined = ss.str();
     Fr result;
-    result.setHashOf(combined.c_str(), combined.size());
+    result.setHashOf(transcript.data(), transcript.size());
     
     return result;
 }
 
-std::vector<Fr> DNTAT_PS::compute_a(const std::vector<PublicKey>& pks) {
-    std::vector<Fr> a;
-    a.reserve(num_signers);
-    
+void DNTAT_PS::compute_a(const std::vector<PublicKey>& pks, Fr* a) {
+    if (is_committee(pks)) {
+        std::copy(committee_a.begin(), committee_a.end(), a);
+        return;
+    }
     for (int i = 0; i < num_signers; ++i) {
-        a.push_back(H_agg(pks, pks[i].g2_keys[0]));
+        a[i] = H_agg(pks, pks[i].g2_keys[0]);
     }
-    
-    return a;
 }
 
 std::array<G2, 4> DNTAT_PS::keyaggr(const std::vector<PublicKey>& pks) {
-    std::vector<Fr> a = compute_a(pks);
+    if (is_committee(pks)) {
+        return committee_apk;
+    }
+    ArenaScope scope;
+    ArenaVector<Fr> a(num_signers);
+    compute_a(pks, a.data());
     std::array<G2, 4> apk;
     
+    // Coefficients and keys are public: one MSM per key component.
+    ArenaVector<G2> keys(num_signers);
     for (int j = 0; j < 4; ++j) {
-        G2 sum;
-        sum.clear();
-        
         for (int i = 0; i < num_signers; ++i) {
-            G2 temp;
-            G2::mul(temp, pks[i].g2_keys[j], a[i]);
-            sum += temp;
+            keys[i] = pks[i].g2_keys[j];
         }
-        
-        apk[j] = sum;
+        msm_public(apk[j], keys.data(), a.data(), num_signers);
     }
     
     return apk;
@@ -115,55 +210,86 @@ DNTAT_PS::SignResult DNTAT_PS::sign(
     const std::vector<SecretKey>& sks,
     const std::vector<PublicKey>& pks,
     const Fr& sku,
-    const G1& pku
+    const G1& pku,
+    uint32_t epoch
 ) {
+    SignResult result;
+    result.sigma_bars.resize(num_signers);
+    sign_impl(sks, pks, sku, pku, result.sigma_bars.data(), result.hbar, result.omega, epoch);
+    return result;
+}
+
+void DNTAT_PS::sign(
+    const std::vector<SecretKey>& sks,
+    const std::vector<PublicKey>& pks,
+    const Fr& sku,
+    const G1& pku,
+    ArenaSignResult& result,
+    uint32_t epoch
+) {
+    result.sigma_bars.resize(num_signers);
+    sign_impl(sks, pks, sku, pku, result.sigma_bars.data(), result.hbar, result.omega, epoch);
+}
+
+void DNTAT_PS::issue_request(
+    const Fr& sku,
+    const G1& pku,
+    IssuanceRequest& request,
+    IssuanceSecrets& secrets,
+    uint32_t epoch
+) {
+    G1& hbar = secrets.hbar;
+    Fr& omega = secrets.omega;
+    Fr& theta = secrets.theta;
+    Fr& r_2 = secrets.r_2;
+    Fr& r_3 = secrets.r_3;
+    Fr& r_4 = secrets.r_4;
+    Fr& r_5 = secrets.r_5;
+    G1& T_1 = request.T[0];
+    G1& T_2 = request.T[1];
+    G1& T_3 = request.T[2];
+    G1& T_4 = request.T[3];
+    secrets.sku = sku;
+    
     Fr random1;
     random1.setByCSPRNG();
     
     G1 h;
-    G1::mul(h, g1, random1);
+    mul_g1(h, random1);
     
-    Fr r_1, r_2, r_3, r_4, r_5;
+    Fr r_1;
     r_1.setByCSPRNG();
     r_2.setByCSPRNG();
     r_3.setByCSPRNG();
     r_4.setByCSPRNG();
     r_5.setByCSPRNG();
     
-    G1 hbar;
-    G1::mul(hbar, h, r_1);
-    
-    unsigned char hbar_data[64];
-    hbar.serialize(hbar_data, 64);
-    std::stringstream ss_theta;
-    ss_theta.write(reinterpret_cast<char*>(hbar_data), 64);
-    ss_theta << "3";
-    std::string theta_input = ss_theta.str();
-    Fr theta;
-    theta.setHashOf(theta_input.c_str(), theta_input.size());
+    mul_secret(hbar, h, r_1);
     
-    Fr omega;
-    omega.setByCSPRNG();
+    unsigned char theta_input[MAX_G1_BYTES + 1];
+    size_t theta_len = hbar.serialize(theta_input, MAX_G1_BYTES);
+    theta_input[theta_len++] = '3';
+    theta.setHashOf(theta_input, theta_len);
     
-    G1 T_1, T_2, T_3, T_4;
+    make_omega(omega, epoch);
     
     G1 temp1, temp2;
     T_1 = hbar;
-    G1::mul(temp2, g1, r_2);
+    mul_g1(temp2, r_2);
     T_1 += temp2;
     
-    G1::mul(temp1, T_1, theta);
-    G1::mul(temp2, g1, r_3);
+    mul_secret(temp1, T_1, theta);
+    mul_g1(temp2, r_3);
     T_2 = temp1;
     T_2 += temp2;
     
-    G1::mul(temp1, T_1, sku);
-    G1::mul(temp2, g1, r_4);
+    mul_secret(temp1, T_1, sku);
+    mul_g1(temp2, r_4);
     T_3 = temp1;
     T_3 += temp2;
     
-    G1::mul(temp1, T_1, omega);
-    G1::mul(temp2, g1, r_5);
+    mul_secret(temp1, T_1, omega);
+    mul_g1(temp2, r_5);
     T_4 = temp1;
     T_4 += temp2;
     
@@ -179,48 +305,42 @@ DNTAT_PS::SignResult DNTAT_PS::sign(
     
     G1 comm_1, comm_2, comm_3, comm_4, comm_5;
     
-    G1::mul(temp1, h, a);
-    G1::mul(temp2, g1, b);
+    mul_secret(temp1, h, a);
+    mul_g1(temp2, b);
     comm_1 = temp1;
     comm_1 += temp2;
     
-    G1::mul(temp1, T_1, f);
-    G1::mul(temp2, g1, c);
+    mul_secret(temp1, T_1, f);
+    mul_g1(temp2, c);
     comm_2 = temp1;
     comm_2 += temp2;
     
-    G1::mul(temp1, T_1, m);
-    G1::mul(temp2, g1, d);
+    mul_secret(temp1, T_1, m);
+    mul_g1(temp2, d);
     comm_3 = temp1;
     comm_3 += temp2;
     
-    G1::mul(temp1, T_1, n);
-    G1::mul(temp2, g1, e);
+    mul_secret(temp1, T_1, n);
+    mul_g1(temp2, e);
     comm_4 = temp1;
     comm_4 += temp2;
     
-    G1::mul(comm_5, g1, m);
-    
-    std::stringstream ss;
-    unsigned char buf[64];
-    
-    g1.serialize(buf, 64); ss.write(reinterpret_cast<char*>(buf), 64);
-    h.serialize(buf, 64); ss.write(reinterpret_cast<char*>(buf), 64);
-    comm_1.serialize(buf, 64); ss.write(reinterpret_cast<char*>(buf), 64);
-    comm_2.serialize(buf, 64); ss.write(reinterpret_cast<char*>(buf), 64);
-    comm_3.serialize(buf, 64); ss.write(reinterpret_cast<char*>(buf), 64);
-    comm_4.serialize(buf, 64); ss.write(reinterpret_cast<char*>(buf), 64);
-    comm_5.serialize(buf, 64); ss.write(reinterpret_cast<char*>(buf), 64);
-    T_1.serialize(buf, 64); ss.write(reinterpret_cast<char*>(buf), 64);
-    T_2.serialize(buf, 64); ss.write(reinterpret_cast<char*>(buf), 64);
-    T_3.serialize(buf, 64); ss.write(reinterpret_cast<char*>(buf), 64);
-    T_4.serialize(buf, 64); ss.write(reinterpret_cast<char*>(buf), 64);
-    pku.serialize(buf, 64); ss.write(reinterpret_cast<char*>(buf), 64);
-    ss << "1";
-    
-    std::string hash_input = ss.str();
+    mul_g1(comm_5, m);
+    
+    // Challenge transcript, serialized straight into a stack buffer.
+    const G1* transcript_points[] = {
+        &g1, &h, &comm_1, &comm_2, &comm_3, &comm_4, &comm_5,
+        &T_1, &T_2, &T_3, &T_4, &pku
+    };
+    unsigned char hash_input[12 * MAX_G1_BYTES + 1];
+    size_t hash_len = 0;
+    for (const G1* P : transcript_points) {
+        hash_len += P->serialize(hash_input + hash_len, MAX_G1_BYTES);
+    }
+    hash_input[hash_len++] = '1';
+    
     Fr ch;
-    ch.setHashOf(hash_input.c_str(), hash_input.size());
+    ch.setHashOf(hash_input, hash_len);
     
     Fr resp_1, resp_2, resp_3, resp_4, resp_5, resp_6, resp_7, resp_8;
     Fr temp_fr;
@@ -248,8 +368,59 @@ DNTAT_PS::SignResult DNTAT_PS::sign(
     
     Fr::mul(temp_fr, ch, omega);
     Fr::sub(resp_8, n, temp_fr);
+}
+
+void DNTAT_PS::sign_share(const SecretKey& sk, const IssuanceRequest& request, G1& s_bar) {
+    G1 temp;
+    mul_secret(s_bar, request.T[0], sk.fr_keys[0]);
+    for (int j = 1; j < 4; ++j) {
+        mul_secret(temp, request.T[j], sk.fr_keys[j]);
+        s_bar += temp;
+    }
+}
+
+void DNTAT_PS::unblind_share(
+    const PublicKey& pk,
+    const IssuanceSecrets& secrets,
+    const G1& s_bar,
+    G1& sigma_bar
+) {
+    // sigma_bar = s_bar - pk_0 r_2 - pk_1 (theta r_2 + r_3)
+    //                   - pk_2 (sku r_2 + r_4) - pk_3 (omega r_2 + r_5)
+    Fr k[4];
+    k[0] = secrets.r_2;
+    Fr::mul(k[1], secrets.theta, secrets.r_2);
+    k[1] += secrets.r_3;
+    Fr::mul(k[2], secrets.sku, secrets.r_2);
+    k[2] += secrets.r_4;
+    Fr::mul(k[3], secrets.omega, secrets.r_2);
+    k[3] += secrets.r_5;
+    
+    G1 blind, temp;
+    mul_secret(blind, pk.g1_keys[0], k[0]);
+    for (int j = 1; j < 4; ++j) {
+        mul_secret(temp, pk.g1_keys[j], k[j]);
+        blind += temp;
+    }
+    G1::sub(sigma_bar, s_bar, blind);
+}
+
+void DNTAT_PS::sign_impl(
+    const std::vector<SecretKey>& sks,
+    const std::vector<PublicKey>& pks,
+    const Fr& sku,
+    const G1& pku,
+    G1* sigma_bars,
+    G1& hbar,
+    Fr& omega,
+    uint32_t epoch
+) {
+    IssuanceRequest request;
+    IssuanceSecrets secrets;
+    issue_request(sku, pku, request, secrets, epoch);
+    hbar = secrets.hbar;
+    omega = secrets.omega;
     
-    std::vector<G1> sigma_bars(num_signers);
     std::mutex error_mutex;
     bool has_error = false;
     std::string error_message;
@@ -257,57 +428,10 @@ DNTAT_PS::SignResult DNTAT_PS::sign(
     // Lambda function for each signer's computation (server-side processing)
     auto process_signer = [&](int i) {
         try {
-            // Thread-local variables
-            G1 temp1_local, temp2_local, temp3_local, temp4_local;
-            
-            // Each signer computes their sigma_bar independently
+            // Signer i sees only the request; the user unblinds its share.
             G1 s_bar;
-            G1::mul(temp1_local, T_1, sks[i].fr_keys[0]);
-            G1::mul(temp2_local, T_2, sks[i].fr_keys[1]);
-            G1::mul(temp3_local, T_3, sks[i].fr_keys[2]);
-            G1::mul(temp4_local, T_4, sks[i].fr_keys[3]);
-            
-            s_bar = temp1_local;
-            s_bar += temp2_local;
-            s_bar += temp3_local;
-            s_bar += temp4_local;
-            
-            G1 pk_i0_neg, pk_i1_neg, pk_i2_neg, pk_i3_neg;
-            G1::neg(pk_i0_neg, pks[i].g1_keys[0]);
-            G1::neg(pk_i1_neg, pks[i].g1_keys[1]);
-            G1::neg(pk_i2_neg, pks[i].g1_keys[2]);
-            G1::neg(pk_i3_neg, pks[i].g1_keys[3]);
-            
-            G1 sigma_bar = s_bar;
-            
-            G1::mul(temp1_local, pk_i0_neg, r_2);
-            sigma_bar += temp1_local;
-            
-            Fr theta_r2;
-            Fr::mul(theta_r2, theta, r_2);
-            G1::mul(temp1_local, pk_i1_neg, theta_r2);
-            sigma_bar += temp1_local;
-            
-            G1::mul(temp1_local, pk_i1_neg, r_3);
-            sigma_bar += temp1_local;
-            
-            Fr sku_r2;
-            Fr::mul(sku_r2, sku, r_2);
-            G1::mul(temp1_local, pk_i2_neg, sku_r2);
-            sigma_bar += temp1_local;
-            
-            G1::mul(temp1_local, pk_i2_neg, r_4);
-            sigma_bar += temp1_local;
-            
-            Fr omega_r2;
-            Fr::mul(omega_r2, omega, r_2);
-            G1::mul(temp1_local, pk_i3_neg, omega_r2);
-            sigma_bar += temp1_local;
-            
-            G1::mul(temp1_local, pk_i3_neg, r_5);
-            sigma_bar += temp1_local;
-            
-            sigma_bars[i] = sigma_bar;
+            sign_share(sks[i], request, s_bar);
+            unblind_share(pks[i], secrets, s_bar, sigma_bars[i]);
         } catch (const std::exception& e) {
             std::lock_guard<std::mutex> lock(error_mutex);
             has_error = true;
@@ -315,14 +439,20 @@ DNTAT_PS::SignResult DNTAT_PS::sign(
         }
     };
     
-    // Parallel signing: create threads for each signer
-    std::vector<std::thread> threads;
-    threads.reserve(num_signers);
+    // Parallel signing: signers 1..n-1 get their own thread while the
+    // calling thread handles signer 0, so a single signer spawns nothing.
+    ArenaScope scope;
+    ArenaVector<std::thread> threads;
+    threads.reserve(num_signers > 1 ? num_signers - 1 : 0);
     
-    for (int i = 0; i < num_signers; ++i) {
+    for (int i = 1; i < num_signers; ++i) {
         threads.emplace_back(process_signer, i);
     }
     
+    if (num_signers > 0) {
+        process_signer(0);
+    }
+    
     // Wait for all threads to complete
     for (auto& thread : threads) {
         thread.join();
@@ -332,13 +462,6 @@ DNTAT_PS::SignResult DNTAT_PS::sign(
     if (has_error) {
         throw std::runtime_error(error_message);
     }
-    
-    SignResult result;
-    result.sigma_bars = sigma_bars;
-    result.hbar = hbar;
-    result.omega = omega;
-    
-    return result;
 }
 
 Token DNTAT_PS::tokenaggr(
@@ -347,16 +470,32 @@ Token DNTAT_PS::tokenaggr(
     const Fr& omega,
     const std::vector<PublicKey>& pks
 ) {
-    std::vector<Fr> a = compute_a(pks);
+    return tokenaggr_impl(sigma_bars.data(), hbar, omega, pks);
+}
+
+Token DNTAT_PS::tokenaggr(
+    const ArenaVector<G1>& sigma_bars,
+    const G1& hbar,
+    const Fr& omega,
+    const std::vector<PublicKey>& pks
+) {
+    return tokenaggr_impl(sigma_bars.data(), hbar, omega, pks);
+}
+
+Token DNTAT_PS::tokenaggr_impl(
+    const G1* sigma_bars,
+    const G1& hbar,
+    const Fr& omega,
+    const std::vector<PublicKey>& pks
+) {
+    ArenaScope scope;
+    ArenaVector<Fr> a(num_signers);
+    compute_a(pks, a.data());
     
+    // The shares and coefficients are both public.
+    ArenaVector<G1> shares(sigma_bars, sigma_bars + num_signers);
     G1 sigma;
-    sigma.clear();
-    
-    for (int i = 0; i < num_signers; ++i) {
-        G1 temp;
-        G1::mul(temp, sigma_bars[i], a[i]);
-        sigma += temp;
-    }
+    msm_public(sigma, shares.data(), a.data(), num_signers);
     
     Token token;
     token.omega = omega;
@@ -366,35 +505,51 @@ Token DNTAT_PS::tokenaggr(
     return token;
 }
 
-bool DNTAT_PS::verify(
+// sigma2 = apk_0 + thetabar apk_1 + sku apk_2 + omega apk_3, the G2 side
+// of the verification equation e(sigma, g2) == e(hbar, sigma2).
+void DNTAT_PS::sigma2_of(
+    G2& sigma2,
     const Token& token,
     const std::array<G2, 4>& apk,
     const Fr& sku
-) {
-    unsigned char hbar_data[64];
-    token.hbar.serialize(hbar_data, 64);
-    std::stringstream ss_thetabar;
-    ss_thetabar.write(reinterpret_cast<char*>(hbar_data), 64);
-    ss_thetabar << "3";
-    std::string thetabar_input = ss_thetabar.str();
+) const {
+    unsigned char thetabar_input[MAX_G1_BYTES + 1];
+    size_t thetabar_len = token.hbar.serialize(thetabar_input, MAX_G1_BYTES);
+    thetabar_input[thetabar_len++] = '3';
     Fr thetabar;
-    thetabar.setHashOf(thetabar_input.c_str(), thetabar_input.size());
+    thetabar.setHashOf(thetabar_input, thetabar_len);
     
-    G2 sigma1;
-    G2 temp1, temp2;
-    G2::mul(temp1, apk[0], 1);
-    G2::mul(temp2, apk[1], thetabar);
-    sigma1 = temp1;
-    sigma1 += temp2;
+    // thetabar and omega are public; sku is the only secret scalar here.
+    G2 public_keys[2] = { apk[1], apk[3] };
+    Fr public_scalars[2] = { thetabar, token.omega };
+    msm_public(sigma2, public_keys, public_scalars, 2);
+    sigma2 += apk[0];
     
-    G2 sigma_bar;
-    G2::mul(temp1, apk[2], sku);
-    G2::mul(temp2, apk[3], token.omega);
-    sigma_bar = temp1;
-    sigma_bar += temp2;
-    
-    G2 sigma2 = sigma1;
-    sigma2 += sigma_bar;
+    G2 sku_term;
+    mul_secret(sku_term, apk[2], sku);
+    sigma2 += sku_term;
+}
+
+bool DNTAT_PS::verify(
+    const Token& token,
+    const std::array<G2, 4>& apk,
+    const Fr& sku
+) const {
+    G2 sigma2;
+    sigma2_of(sigma2, token, apk, sku);
+    
+    const Fp6* g2_coeff = lines();
+    if (g2_coeff) {
+        // e(sigma, g2) == e(hbar, sigma2) as e(-hbar, sigma2) e(sigma, g2) == 1:
+        // one Miller loop, half of it over g2's stored lines, and one final
+        // exponentiation.
+        G1 neg_hbar;
+        G1::neg(neg_hbar, token.hbar);
+        GT f;
+        precomputedMillerLoop2mixed(f, neg_hbar, sigma2, token.sigma, g2_coeff);
+        finalExp(f, f);
+        return f.isOne();
+    }
     
     GT e1, e2;
     pairing(e1, token.sigma, g2);
@@ -402,3 +557,86 @@ bool DNTAT_PS::verify(
     
     return e1 == e2;
 }
+
+bool DNTAT_PS::verify_batch(
+    const Token* tokens,
+    const Fr* skus,
+    size_t k,
+    const std::array<G2, 4>& apk
+) const {
+    if (k == 0) {
+        return true;
+    }
+    if (k == 1) {
+        return verify(tokens[0], apk, skus[0]);
+    }
+    
+    // With random rho_i, check
+    //   e(sum_i rho_i sigma_i, g2) * prod_i e(-rho_i hbar_i, sigma2_i) == 1
+    // k + 1 Miller loops (the g2 one over its lines if precomputed) and a
+    // single final exponentiation for the whole batch.
+    ArenaScope scope;
+    ArenaVector<G1> sigmas(k), hbars(k);
+    ArenaVector<G2> sigma2s(k);
+    ArenaVector<Fr> rho(k);
+    for (size_t i = 0; i < k; ++i) {
+        sigma2_of(sigma2s[i], tokens[i], apk, skus[i]);
+        rho[i].setByCSPRNG();
+        Fr neg_rho;
+        Fr::neg(neg_rho, rho[i]);
+        mul_public(hbars[i], tokens[i].hbar, neg_rho);
+        sigmas[i] = tokens[i].sigma;
+    }
+    G1 S;
+    msm_public(S, sigmas.data(), rho.data(), k);
+    
+    GT f, g;
+    millerLoopVec(f, hbars.data(), sigma2s.data(), k);
+    const Fp6* g2_coeff = lines();
+    if (g2_coeff) {
+        precomputedMillerLoop(g, S, g2_coeff);
+    } else {
+        millerLoop(g, S, g2);
+    }
+    f *= g;
+    finalExp(f, f);
+    return f.isOne();
+}
+
+bool DNTAT_PS::verify(
+    const Token& token,
+    const std::array<G2, 4>& apk,
+    const Fr& sku,
+    NullifierStore& spent
+) const {
+    return verify(token, apk, sku) && spent.insert(nullifier_tag("dntat/hbar", token.hbar));
+}
+
+bool DNTAT_PS::verify(
+    const Token& token,
+    const std::array<G2, 4>& apk,
+    const Fr& sku,
+    PersistentNullifierStore& spent
+) const {
+    return verify(token, apk, sku) && spent.insert(nullifier_tag("dntat/hbar", token.hbar));
+}
+
+bool DNTAT_PS::verify(
+    const Token& token,
+    const std::array<G2, 4>& apk,
+    const Fr& sku,
+    FilteredNullifierStore& spent
+) const {
+    return verify(token, apk, sku) && spent.insert(nullifier_tag("dntat/hbar", token.hbar));
+}
+
+bool DNTAT_PS::verify(
+    const Token& token,
+    const std::array<G2, 4>& apk,
+    const Fr& sku,
+    EpochNullifierStore& spent
+) const {
+    uint32_t epoch = epoch_of(token);
+    return spent.accepts(epoch) && verify(token, apk, sku) &&
+           spent.insert(epoch, nullifier_tag("dntat/hbar", token.hbar));
+}
@@ -0,0 +1,285 @@
+#include "dntat_ps.h"
+#include "dntat_wire.h"
+#include "dntat_shm_ring.h"
+#include "dntat_latency.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One DNTAT signer as its own process.
+//
+// The signer generates its key pair at startup and keeps the SecretKey to
+// itself: WIRE_GET_KEYS returns its PublicKey (a one-key WIRE_KEYS), and
+// WIRE_ISSUE returns its single share s_bar = sum_j sk[j] T_j (a one-share
+// WIRE_SHARES). A coordinator (dntat_coordinator.h) talks to n of these.
+// Each connection is served by its own thread, in request order.
+//
+// With --listen shm:<segment>:<slot> the signer instead serves slot <slot>
+// of the coordinator's shared-memory segment (ShmRing, Linux). It exits if
+// the coordinator leaves the response ring full for 10 s.
+//
+// For simulating a geographically spread committee on one machine, --delay
+// holds each share back by a sample of a latency distribution (see
+// dntat_latency.h) and --drop omits a share with the given probability
+// (socket transports only).
+// Delayed shares go out from a timer thread, so later requests are not
+// held up behind them and replies may overtake each other; the coordinator
+// matches them by request id.
+//
+// Usage: dntat_signerd [--curve bn254|bls12_381|bn462]
+//                      [--listen unix:/tmp/dntat_signer0.sock | shm:<segment>:<slot>]
+//                      [--delay none | const:<ms> | lognormal:<median_ms>,<sigma> | pareto:<min_ms>,<alpha>]
+//                      [--drop <probability>]
+
+namespace {
+
+struct Faults {
+    LatencyModel delay;
+    double drop;
+};
+
+// Writes frames to one connection, either now or once their due time
+// passes.
+class ReplySender {
+public:
+    explicit ReplySender(int fd) : fd_(fd), stop_(false), broken_(false) {}
+
+    ~ReplySender() {
+        if (timer_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            cv_.notify_one();
+            timer_.join();
+        }
+    }
+
+    void send(uint8_t type, uint32_t id, const std::vector<unsigned char>& payload) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        wire_send(fd_, type, id, payload);
+    }
+
+    void send_at(std::chrono::steady_clock::time_point due, uint8_t type, uint32_t id,
+                 const std::vector<unsigned char>& payload) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (broken_) {
+                throw std::runtime_error("connection closed");
+            }
+            Delayed d;
+            d.due = due;
+            d.type = type;
+            d.id = id;
+            d.payload = payload;
+            queue_.push(d);
+            if (!timer_.joinable()) {
+                timer_ = std::thread(&ReplySender::run, this);
+            }
+        }
+        cv_.notify_one();
+    }
+
+private:
+    struct Delayed {
+        std::chrono::steady_clock::time_point due;
+        uint8_t type;
+        uint32_t id;
+        std::vector<unsigned char> payload;
+        bool operator<(const Delayed& other) const {
+            return due > other.due;  // earliest first
+        }
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            if (stop_) {
+                return;  // unsent replies are dropped with the connection
+            }
+            if (queue_.empty()) {
+                cv_.wait(lock);
+                continue;
+            }
+            std::chrono::steady_clock::time_point due = queue_.top().due;
+            if (std::chrono::steady_clock::now() < due) {
+                cv_.wait_until(lock, due);
+                continue;
+            }
+            Delayed d = queue_.top();
+            queue_.pop();
+            lock.unlock();
+            try {
+                send(d.type, d.id, d.payload);
+            } catch (const std::exception&) {
+                lock.lock();
+                broken_ = true;
+                continue;
+            }
+            lock.lock();
+        }
+    }
+
+    int fd_;
+    std::mutex write_mutex_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::priority_queue<Delayed> queue_;
+    bool stop_;
+    bool broken_;
+    std::thread timer_;
+};
+
+void serve(int fd, const std::vector<unsigned char>& keys_payload, const SecretKey& sk, const Faults& faults) {
+    {
+        ReplySender out(fd);
+        std::mt19937_64 rng(std::random_device{}());
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        try {
+            WireFrame frame;
+            while (wire_recv(fd, frame)) {
+                if (frame.type == WIRE_GET_KEYS) {
+                    out.send(WIRE_KEYS, frame.id, keys_payload);
+                } else if (frame.type == WIRE_ISSUE) {
+                    DNTAT_PS::IssuanceRequest request = wire_decode_request(frame.payload.data(), frame.payload.size());
+                    if (faults.drop > 0 && coin(rng) < faults.drop) {
+                        continue;
+                    }
+                    G1 s_bar;
+                    DNTAT_PS::sign_share(sk, request, s_bar);
+                    if (faults.delay.none()) {
+                        out.send(WIRE_SHARES, frame.id, wire_encode_shares(&s_bar, 1));
+                    } else {
+                        out.send_at(std::chrono::steady_clock::now() + faults.delay.sample(rng), WIRE_SHARES,
+                                    frame.id, wire_encode_shares(&s_bar, 1));
+                    }
+                } else {
+                    std::string msg = "unknown message type";
+                    out.send(WIRE_ERROR, frame.id, std::vector<unsigned char>(msg.begin(), msg.end()));
+                }
+            }
+        } catch (const std::exception&) {
+            // Malformed frame or broken connection: drop the client.
+        }
+    }
+    ::close(fd);
+}
+
+#ifdef __linux__
+int serve_shm(const std::string& segment, size_t slot, const PublicKey& pk, const SecretKey& sk) {
+    std::unique_ptr<ShmRing> ring;
+    try {
+        ring.reset(ShmRing::attach(segment, std::chrono::milliseconds(10000)));
+        ring->publish_key(slot, pk);
+    } catch (const std::exception& e) {
+        std::cerr << "dntat_signerd: " << e.what() << std::endl;
+        return 1;
+    }
+    uint32_t id;
+    DNTAT_PS::IssuanceRequest request;
+    G1 s_bar;
+    for (;;) {
+        try {
+            ring->pop_request(slot, id, request);
+        } catch (const std::exception&) {
+            continue;  // undecodable record: the coordinator's deadline covers it
+        }
+        bool valid = true;
+        for (const G1& T : request.T) {
+            valid = valid && in_subgroup(T);
+        }
+        if (!valid) {
+            continue;  // the user's points are outside the subgroup; same as above
+        }
+        DNTAT_PS::sign_share(sk, request, s_bar);
+        if (!ring->push_response(slot, id, s_bar, std::chrono::milliseconds(10000))) {
+            std::cerr << "dntat_signerd: " << segment << ": coordinator stopped taking responses" << std::endl;
+            return 1;
+        }
+    }
+}
+#endif
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::string curve = take_curve_arg(argc, argv);
+    std::string listen = "unix:/tmp/dntat_signer0.sock";
+    Faults faults;
+    faults.drop = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--listen") {
+            listen = argv[i + 1];
+        } else if (flag == "--delay") {
+            try {
+                faults.delay = LatencyModel(argv[i + 1]);
+            } catch (const std::exception& e) {
+                std::cerr << "dntat_signerd: " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (flag == "--drop") {
+            faults.drop = std::atof(argv[i + 1]);
+        } else {
+            std::cerr << "unknown option " << flag << std::endl;
+            return 1;
+        }
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if (!init_curve(curve)) {
+        return 1;
+    }
+    DNTAT_PS dntat(1);
+    auto keypair = dntat.S_keygen();
+    const std::vector<unsigned char> keys_payload = wire_encode_keys(std::vector<PublicKey>(1, keypair.first));
+    const SecretKey sk = keypair.second;
+
+    std::string segment;
+    size_t slot;
+    try {
+        if (shm_parse_address(listen, segment, slot)) {
+#ifdef __linux__
+            return serve_shm(segment, slot, keypair.first, sk);
+#else
+            std::cerr << "dntat_signerd: the shared-memory transport needs Linux" << std::endl;
+            return 1;
+#endif
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "dntat_signerd: " << e.what() << std::endl;
+        return 1;
+    }
+
+    int listen_fd;
+    try {
+        listen_fd = wire_listen(listen);
+    } catch (const std::exception& e) {
+        std::cerr << "dntat_signerd: " << e.what() << std::endl;
+        return 1;
+    }
+    const int family = listen.compare(0, 5, "unix:") == 0 ? AF_UNIX : AF_INET;
+
+    for (;;) {
+        int fd = ::accept(listen_fd, 0, 0);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            std::cerr << "dntat_signerd: accept: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        wire_tune_socket(fd, family);
+        std::thread(serve, fd, std::cref(keys_payload), std::cref(sk), std::cref(faults)).detach();
+    }
+}
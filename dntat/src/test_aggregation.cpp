@@ -1,8 +1,11 @@
 #include "dntat_ps.h"
 #include <iostream>
+#include <sstream>
 
 int main() {
-    initPairing();
+    if (!init_curve("bn254")) {
+        return 1;
+    }
     
     int num_signers = 4;
     DNTAT_PS dntat(num_signers);
@@ -34,12 +37,12 @@ int main() {
         std::stringstream ss;
         for (const auto& pk : pks) {
             unsigned char buf[96];
-            pk.g2_keys[0].serialize(buf, 96);
-            ss.write(reinterpret_cast<char*>(buf), 96);
+            size_t n = pk.g2_keys[0].serialize(buf, 96);
+            ss.write(reinterpret_cast<char*>(buf), n);
         }
         unsigned char buf_i[96];
-        pks[i].g2_keys[0].serialize(buf_i, 96);
-        ss.write(reinterpret_cast<char*>(buf_i), 96);
+        size_t n_i = pks[i].g2_keys[0].serialize(buf_i, 96);
+        ss.write(reinterpret_cast<char*>(buf_i), n_i);
         ss << "agg";
         std::string combined = ss.str();
         Fr a_i;
@@ -49,9 +52,9 @@ int main() {
     
     // Compute theta
     unsigned char hbar_data[64];
-    sign_result.hbar.serialize(hbar_data, 64);
+    size_t hbar_len = sign_result.hbar.serialize(hbar_data, 64);
     std::stringstream ss_theta;
-    ss_theta.write(reinterpret_cast<char*>(hbar_data), 64);
+    ss_theta.write(reinterpret_cast<char*>(hbar_data), hbar_len);
     ss_theta << "3";
     std::string theta_input = ss_theta.str();
     Fr theta;
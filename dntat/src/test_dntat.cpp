@@ -1,99 +1,150 @@
 #include "dntat_ps.h"
+#include "dntat_codec.h"
+#include "wire_bench.h"
 #include <iostream>
 #include <chrono>
 #include <iomanip>
+#include <cstdlib>
+#include <stdexcept>
 
 using namespace std::chrono;
 
 void print_timing(const std::string& operation, double ms) {
-    std::cout << operation << ": " 
-              << std::fixed << std::setprecision(2) 
+    std::cout << operation << ": "
+              << std::fixed << std::setprecision(2)
               << ms << " ms" << std::endl;
 }
 
-int main() {
-    initPairing();
-    
-    int num_signers = 1;
-    
-    auto start_total = steady_clock::now();
-    
-    auto start = steady_clock::now();
-    DNTAT_PS dntat(num_signers);
-    auto end = steady_clock::now();
-    print_timing("Setup DNTAT_PS", duration<double, std::milli>(end - start).count());
-    
-    std::vector<PublicKey> pks;
-    std::vector<SecretKey> sks;
-    
-    start = steady_clock::now();
-    for (int i = 0; i < num_signers; ++i) {
-        auto keypair = dntat.S_keygen();
-        pks.push_back(keypair.first);
-        sks.push_back(keypair.second);
-    }
-    end = steady_clock::now();
-    print_timing("S keygen (all signers)", duration<double, std::milli>(end - start).count());
-    
-    start = steady_clock::now();
-    auto user_keypair = dntat.U_keygen();
-    G1 pku = user_keypair.first;
-    Fr sku = user_keypair.second;
-    end = steady_clock::now();
-    print_timing("U keygen", duration<double, std::milli>(end - start).count());
-    
-    start = steady_clock::now();
-    auto apk = dntat.keyaggr(pks);
-    end = steady_clock::now();
-    print_timing("Key aggregation", duration<double, std::milli>(end - start).count());
-    
-    start = steady_clock::now();
-    auto sign_result = dntat.sign(sks, pks, sku, pku);
-    end = steady_clock::now();
-    double sign_time = duration<double, std::milli>(end - start).count();
-    print_timing("Sign", sign_time);
-    
-    start = steady_clock::now();
-    Token token = dntat.tokenaggr(sign_result.sigma_bars, sign_result.hbar, sign_result.omega, pks);
-    end = steady_clock::now();
-    print_timing("Token aggregation", duration<double, std::milli>(end - start).count());
-    
-    start = steady_clock::now();
-    bool verify_result = dntat.verify(token, apk, sku);
-    end = steady_clock::now();
-    double redeem_time = duration<double, std::milli>(end - start).count();
-    print_timing("Redemption (verify)", redeem_time);
-    
-    auto end_total = steady_clock::now();
-    print_timing("Total time", duration<double, std::milli>(end_total - start_total).count());
-    
-    std::cout << "\nVerification result: SUCCESS" << std::endl;
-    
-    std::cout << "\n=== Performance Test (1000 iterations) ===" << std::endl;
-    
-    std::cout << "\nTesting Sign operation..." << std::endl;
-    start = steady_clock::now();
-    for (int i = 0; i < 1000; ++i) {
-        auto sign_result_test = dntat.sign(sks, pks, sku, pku);
-    }
-    end = steady_clock::now();
-    double total_sign = duration<double, std::milli>(end - start).count();
-    std::cout << "Total time for 1000 signs: " << std::fixed << std::setprecision(2) 
-              << total_sign << " ms" << std::endl;
-    std::cout << "Average time per sign: " << std::fixed << std::setprecision(2) 
-              << total_sign / 1000.0 << " ms" << std::endl;
-    
-    std::cout << "\nTesting Redemption operation..." << std::endl;
-    start = steady_clock::now();
-    for (int i = 0; i < 1000; ++i) {
-        bool result = dntat.verify(token, apk, sku);
+struct DNTATBenchmark {
+    int num_signers;
+
+    template<class Curve>
+    CurveBenchSummary run() const {
+        auto start_total = steady_clock::now();
+
+        auto start = steady_clock::now();
+        DNTAT_PS dntat(num_signers);
+        auto end = steady_clock::now();
+        print_timing("Setup DNTAT_PS", duration<double, std::milli>(end - start).count());
+
+        std::vector<PublicKey> pks;
+        std::vector<SecretKey> sks;
+
+        start = steady_clock::now();
+        for (int i = 0; i < num_signers; ++i) {
+            auto keypair = dntat.S_keygen();
+            pks.push_back(keypair.first);
+            sks.push_back(keypair.second);
+        }
+        end = steady_clock::now();
+        print_timing("S keygen (all signers)", duration<double, std::milli>(end - start).count());
+
+        start = steady_clock::now();
+        auto user_keypair = dntat.U_keygen();
+        G1 pku = user_keypair.first;
+        Fr sku = user_keypair.second;
+        end = steady_clock::now();
+        print_timing("U keygen", duration<double, std::milli>(end - start).count());
+
+        start = steady_clock::now();
+        auto apk = dntat.keyaggr(pks);
+        end = steady_clock::now();
+        print_timing("Key aggregation", duration<double, std::milli>(end - start).count());
+
+        start = steady_clock::now();
+        auto sign_result = dntat.sign(sks, pks, sku, pku);
+        end = steady_clock::now();
+        double sign_time = duration<double, std::milli>(end - start).count();
+        print_timing("Sign", sign_time);
+
+        start = steady_clock::now();
+        Token token = dntat.tokenaggr(sign_result.sigma_bars, sign_result.hbar, sign_result.omega, pks);
+        end = steady_clock::now();
+        print_timing("Token aggregation", duration<double, std::milli>(end - start).count());
+
+        start = steady_clock::now();
+        bool verify_result = dntat.verify(token, apk, sku);
+        end = steady_clock::now();
+        double redeem_time = duration<double, std::milli>(end - start).count();
+        print_timing("Redemption (verify)", redeem_time);
+
+        auto end_total = steady_clock::now();
+        print_timing("Total time", duration<double, std::milli>(end_total - start_total).count());
+
+        std::cout << "\nVerification result: " << (verify_result ? "SUCCESS" : "FAILED") << std::endl;
+
+        std::cout << "\n=== Wire Format ===" << std::endl;
+        DNTAT_PS::IssuanceRequest request;
+        DNTAT_PS::IssuanceSecrets secrets;
+        dntat.issue_request(sku, pku, request, secrets);
+        wire_report_header();
+        wire_report(pks[0]);
+        wire_report(request);
+        wire_report(sign_result);
+        wire_report(token);
+        std::cout << std::endl;
+        wire_trust_report_header(64);
+        wire_trust_report(request);
+        wire_trust_report(token);
+
+        // Points outside the subgroup, in the group of each message.
+        std::cout << std::endl;
+        bool refused = true;
+        DNTAT_PS::IssuanceRequest bad_request = request;
+        if (off_subgroup_point(request.T[1], bad_request.T[1])) {
+            refused &= wire_subgroup_report(request, bad_request, "T[1] outside G1");
+        } else {
+            std::cout << "G1 has no cofactor on this curve" << std::endl;
+        }
+        PublicKey bad_pk = pks[0];
+        if (off_subgroup_point(pks[0].g2_keys[2], bad_pk.g2_keys[2])) {
+            refused &= wire_subgroup_report(pks[0], bad_pk, "g2_keys[2] outside G2");
+        } else {
+            std::cout << "G2 has no cofactor on this curve" << std::endl;
+        }
+        if (!refused) {
+            throw std::runtime_error("a point outside the subgroup was accepted");
+        }
+
+        std::cout << "\n=== Performance Test (1000 iterations) ===" << std::endl;
+
+        std::cout << "\nTesting Sign operation..." << std::endl;
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            auto sign_result_test = dntat.sign(sks, pks, sku, pku);
+        }
+        end = steady_clock::now();
+        double total_sign = duration<double, std::milli>(end - start).count();
+        std::cout << "Total time for 1000 signs: " << std::fixed << std::setprecision(2)
+                  << total_sign << " ms" << std::endl;
+        std::cout << "Average time per sign: " << std::fixed << std::setprecision(2)
+                  << total_sign / 1000.0 << " ms" << std::endl;
+
+        std::cout << "\nTesting Redemption operation..." << std::endl;
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            dntat.verify(token, apk, sku);
+        }
+        end = steady_clock::now();
+        double total_redeem = duration<double, std::milli>(end - start).count();
+        std::cout << "Total time for 1000 redemptions: " << std::fixed << std::setprecision(2)
+                  << total_redeem << " ms" << std::endl;
+        std::cout << "Average time per redemption: " << std::fixed << std::setprecision(2)
+                  << total_redeem / 1000.0 << " ms" << std::endl;
+
+        CurveBenchSummary summary;
+        summary.issuance_ms = total_sign / 1000.0;
+        summary.redemption_ms = total_redeem / 1000.0;
+        return summary;
     }
-    end = steady_clock::now();
-    double total_redeem = duration<double, std::milli>(end - start).count();
-    std::cout << "Total time for 1000 redemptions: " << std::fixed << std::setprecision(2) 
-              << total_redeem << " ms" << std::endl;
-    std::cout << "Average time per redemption: " << std::fixed << std::setprecision(2) 
-              << total_redeem / 1000.0 << " ms" << std::endl;
-    
-    return 0;
+};
+
+// Usage: DNTAT [bn254|bls12_381|bn462|all] [num_signers]
+int main(int argc, char** argv) {
+    std::string curve = argc > 1 ? argv[1] : "bn254";
+
+    DNTATBenchmark bench;
+    bench.num_signers = argc > 2 ? std::atoi(argv[2]) : 1;
+
+    return run_curve_benchmark(curve, bench);
 }
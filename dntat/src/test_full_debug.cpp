@@ -1,8 +1,11 @@
 #include "dntat_ps.h"
 #include <iostream>
+#include <sstream>
 
 int main() {
-    initPairing();
+    if (!init_curve("bn254")) {
+        return 1;
+    }
     
     int num_signers = 4;
     DNTAT_PS dntat(num_signers);
@@ -40,9 +43,9 @@ int main() {
     std::cout << "\nManually checking pairing..." << std::endl;
     
     unsigned char hbar_data[64];
-    token.hbar.serialize(hbar_data, 64);
+    size_t hbar_len = token.hbar.serialize(hbar_data, 64);
     std::stringstream ss_thetabar;
-    ss_thetabar.write(reinterpret_cast<char*>(hbar_data), 64);
+    ss_thetabar.write(reinterpret_cast<char*>(hbar_data), hbar_len);
     ss_thetabar << "3";
     std::string thetabar_input = ss_thetabar.str();
     Fr thetabar;
@@ -2,7 +2,9 @@
 #include <iostream>
 
 int main() {
-    initPairing();
+    if (!init_curve("bn254")) {
+        return 1;
+    }
     
     int num_signers = 4;
     DNTAT_PS dntat(num_signers);
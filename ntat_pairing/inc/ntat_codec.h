@@ -0,0 +1,68 @@
+#ifndef NTAT_CODEC_H
+#define NTAT_CODEC_H
+
+#include "ntat_pairing.h"
+#include "wire_format.h"
+
+// Wire encodings of the NTAT messages (see wire_format.h). The enums name
+// the fields for WireView<M>::get().
+
+template<> struct WireMessage<Query> {
+    static const uint8_t type = 0x10;
+    static const char* name() { return "Query"; }
+    enum { T, CH, RESP1, RESP2, RESP3, COMM1, COMM2 };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.T);
+        v(m.pi_c.ch);
+        v(m.pi_c.resp1);
+        v(m.pi_c.resp2);
+        v(m.pi_c.resp3);
+        v(m.pi_c.comm1);
+        v(m.pi_c.comm2);
+    }
+};
+
+template<> struct WireMessage<ResponsePairing> {
+    static const uint8_t type = 0x11;
+    static const char* name() { return "ResponsePairing"; }
+    enum { S_FR, S_G1 };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.s);
+        v(m.S);
+    }
+};
+
+template<> struct WireMessage<Token> {
+    static const uint8_t type = 0x12;
+    static const char* name() { return "Token"; }
+    enum { SIGMA, R, S };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.sigma);
+        v(m.r);
+        v(m.s);
+    }
+};
+
+template<> struct WireMessage<RedemptionProof1> {
+    static const uint8_t type = 0x13;
+    static const char* name() { return "RedemptionProof1"; }
+    enum { SIGMA_, COMM };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.sigma_);
+        v(m.comm);
+    }
+};
+
+template<> struct WireMessage<RedemptionProof2> {
+    static const uint8_t type = 0x14;
+    static const char* name() { return "RedemptionProof2"; }
+    enum { V0, V1, V2, RHO };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.v0);
+        v(m.v1);
+        v(m.v2);
+        v(m.rho);
+    }
+};
+
+#endif
@@ -1,14 +1,14 @@
 #ifndef NTAT_PAIRING_H
 #define NTAT_PAIRING_H
 
-#include <mcl/bn256.hpp>
+#include "curve.h"
+#include "nullifier_store.h"
+#include "filtered_nullifier_store.h"
 #include <array>
 #include <vector>
 #include <string>
 #include <memory>
 
-using namespace mcl::bn256;
-
 // Public Parameters
 struct PublicParams {
     G1 g1;
@@ -23,6 +23,8 @@ struct REP3Proof {
     Fr resp1;   // response 1
     Fr resp2;   // response 2
     Fr resp3;   // response 3
+    G1 comm1;   // commitments, carried so proofs can be batch-verified
+    G1 comm2;
 };
 
 // Query from client to server
@@ -61,6 +63,7 @@ struct RedemptionProof2 {
 // Utility functions
 PublicParams setup();
 void hashToFr(Fr& result, const std::string& data);
+void hashToFr(Fr& result, const void* data, size_t size);
 
 // REP3 Proof functions
 REP3Proof rep3_prove(
@@ -79,6 +82,16 @@ bool rep3_verify(
     const REP3Proof& pi_c
 );
 
+// Verifies k proofs at once: checks each challenge against the carried
+// commitments, then both commitment equations over a random linear
+// combination of all k proofs, one MSM per equation.
+bool rep3_verify_batch(
+    const PublicParams& pp,
+    const std::vector<G1>& X,
+    const std::vector<G1>& T,
+    const std::vector<REP3Proof>& proofs
+);
+
 // Client class
 class Client {
 private:
@@ -91,8 +104,15 @@ private:
     Fr beta;
     Fr gamma;
     Fr rho;
+    // Miller-loop lines for the two fixed G2 arguments of the issuer check
+    std::vector<Fp6> pk_s_lines;
+    std::vector<Fp6> g2_lines;
+    
+    bool issuer_check(const G1& S, const G1& R) const;
 
 public:
+    // Precomputes the G2 lines for pk_s and pp.g2 once; one Client can run
+    // any number of query/final rounds against the same issuer.
     Client(const PublicParams& pp, const G2& pk_s);
     
     Query client_query(
@@ -101,8 +121,19 @@ public:
         const G2& pk_s
     );
     
+    // Checks e(S, pk_s + g2*s) == e(T, g2) before unblinding; throws
+    // std::runtime_error if the issuer's response is invalid.
     Token client_final(const ResponsePairing& resp);
     
+    // client_final for k pending queries at once; resps[i] answers the
+    // query made by clients[i]; all clients must share one issuer. Checks all
+    // k responses with one random linear combination and inverts all k
+    // lambdas with one inversion.
+    static std::vector<Token> client_final_batch(
+        const std::vector<Client>& clients,
+        const std::vector<ResponsePairing>& resps
+    );
+    
     RedemptionProof1 client_prove_redemption1(
         const Token& token,
         const Fr& sk_c,
@@ -135,6 +166,16 @@ public:
         const Query& query
     );
     
+    // Issues a queue of queries; pk_cs[i] is the key of the client that
+    // sent queries[i]. All REP3 proofs are checked with one batch verification
+    // and all k (sk_s + s) are inverted with one field inversion.
+    std::vector<ResponsePairing> server_issue_batch(
+        const PublicParams& pp,
+        const Fr& sk_s,
+        const std::vector<G1>& pk_cs,
+        const std::vector<Query>& queries
+    );
+    
     Fr server_verify_redemption1(
         const Token& token,
         const G2& pk_s,
@@ -146,6 +187,22 @@ public:
         const Fr& sk_s,
         const RedemptionProof2& proof
     );
+    
+    // server_verify_redemption2 plus the double-spend check on token.sigma.
+    bool server_verify_redemption2(
+        const Token& token,
+        const Fr& sk_s,
+        const RedemptionProof2& proof,
+        NullifierStore& spent
+    );
+    
+    // Same, with a Bloom filter in front of the spent-token table.
+    bool server_verify_redemption2(
+        const Token& token,
+        const Fr& sk_s,
+        const RedemptionProof2& proof,
+        FilteredNullifierStore& spent
+    );
 };
 
 #endif
@@ -1,4 +1,6 @@
 #include "ntat_pairing.h"
+#include "ntat_codec.h"
+#include "wire_bench.h"
 #include <iostream>
 #include <chrono>
 #include <iomanip>
@@ -11,144 +13,318 @@ void print_timing(const std::string& operation, double ms) {
               << ms << " ms" << std::endl;
 }
 
-int main() {
-    initPairing();
-    
-    std::cout << "=== NTAT w/Pairing Performance Benchmark ===" << std::endl;
-    std::cout << std::endl;
-    
-    // Setup
-    auto start = steady_clock::now();
-    PublicParams pp = setup();
-    auto end = steady_clock::now();
-    print_timing("Setup", duration<double, std::milli>(end - start).count());
-    
-    // Client KeyGen
-    start = steady_clock::now();
-    Fr sk_c;
-    sk_c.setByCSPRNG();
-    G1 pk_c;
-    G1::mul(pk_c, pp.g1, sk_c);
-    end = steady_clock::now();
-    print_timing("Client KeyGen", duration<double, std::milli>(end - start).count());
-    
-    // Server KeyGen
-    start = steady_clock::now();
-    Fr sk_s;
-    sk_s.setByCSPRNG();
-    G2 pk_s;
-    G2::mul(pk_s, pp.g2, sk_s);
-    end = steady_clock::now();
-    print_timing("Server KeyGen", duration<double, std::milli>(end - start).count());
-    
-    // Initialize client and server
-    Client client(pp, pk_s);
-    Server server(pp, pk_c);
-    
-    std::cout << "\n=== Single Run Test ===" << std::endl;
-    
-    // Client Query
-    start = steady_clock::now();
-    Query query = client.client_query(pp, sk_c, pk_s);
-    end = steady_clock::now();
-    double client_query_time = duration<double, std::milli>(end - start).count();
-    print_timing("Client Query", client_query_time);
-    
-    // Server Issue
-    start = steady_clock::now();
-    ResponsePairing response = server.server_issue(pp, sk_s, pk_c, query);
-    end = steady_clock::now();
-    double server_issue_time = duration<double, std::milli>(end - start).count();
-    print_timing("Server Issue", server_issue_time);
-    
-    // Client Finalize Query
-    start = steady_clock::now();
-    Token token = client.client_final(response);
-    end = steady_clock::now();
-    double client_final_time = duration<double, std::milli>(end - start).count();
-    print_timing("Client Finalize Query", client_final_time);
-    
-    std::cout << "\n** Total Issuance Time: " 
-              << std::fixed << std::setprecision(2)
-              << (client_query_time + server_issue_time + client_final_time) 
-              << " ms **" << std::endl;
-    
-    // Client Redeem Part 1
-    start = steady_clock::now();
-    RedemptionProof1 proof1 = client.client_prove_redemption1(token, sk_c, pk_s);
-    end = steady_clock::now();
-    double client_redeem1_time = duration<double, std::milli>(end - start).count();
-    print_timing("Client Redeem Part 1", client_redeem1_time);
-    
-    // Server Verify Redemption Part 1
-    start = steady_clock::now();
-    Fr c = server.server_verify_redemption1(token, pk_s, proof1);
-    end = steady_clock::now();
-    double server_verify1_time = duration<double, std::milli>(end - start).count();
-    print_timing("Server Verify Redemption Part 1", server_verify1_time);
-    
-    // Client Redeem Part 2
-    start = steady_clock::now();
-    RedemptionProof2 proof2 = client.client_prove_redemption2(token, sk_c, c);
-    end = steady_clock::now();
-    double client_redeem2_time = duration<double, std::milli>(end - start).count();
-    print_timing("Client Redeem Part 2", client_redeem2_time);
-    
-    // Server Verify Redemption Part 2
-    start = steady_clock::now();
-    bool verified = server.server_verify_redemption2(token, sk_s, proof2);
-    end = steady_clock::now();
-    double server_verify2_time = duration<double, std::milli>(end - start).count();
-    print_timing("Server Verify Redemption Part 2", server_verify2_time);
-    
-    std::cout << "\n** Total Redemption Time: " 
-              << std::fixed << std::setprecision(2)
-              << (client_redeem1_time + server_verify1_time + client_redeem2_time + server_verify2_time) 
-              << " ms **" << std::endl;
-    
-    std::cout << "\nVerification result: SUCCESS" << std::endl;
-    
-    // Performance test with 1000 iterations
-    std::cout << "\n=== Performance Test (1000 iterations) ===" << std::endl;
-    
-    // Test Issuance (Client Query + Server Issue + Client Finalize)
-    std::cout << "\nTesting Issuance (full flow)..." << std::endl;
-    start = steady_clock::now();
-    for (int i = 0; i < 1000; ++i) {
+struct NTATBenchmark {
+    template<class Curve>
+    CurveBenchSummary run() const {
+        std::cout << "=== NTAT w/Pairing Performance Benchmark ===" << std::endl;
+        std::cout << std::endl;
+
+        // Setup
+        auto start = steady_clock::now();
+        PublicParams pp = setup();
+        auto end = steady_clock::now();
+        print_timing("Setup", duration<double, std::milli>(end - start).count());
+
+        // Client KeyGen
+        start = steady_clock::now();
+        Fr sk_c;
+        sk_c.setByCSPRNG();
+        G1 pk_c;
+        G1::mul(pk_c, pp.g1, sk_c);
+        end = steady_clock::now();
+        print_timing("Client KeyGen", duration<double, std::milli>(end - start).count());
+
+        // Server KeyGen
+        start = steady_clock::now();
+        Fr sk_s;
+        sk_s.setByCSPRNG();
+        G2 pk_s;
+        G2::mul(pk_s, pp.g2, sk_s);
+        end = steady_clock::now();
+        print_timing("Server KeyGen", duration<double, std::milli>(end - start).count());
+
+        // Initialize client and server
+        Client client(pp, pk_s);
+        Server server(pp, pk_c);
+
+        std::cout << "\n=== Single Run Test ===" << std::endl;
+
+        // Client Query
+        start = steady_clock::now();
+        Query query = client.client_query(pp, sk_c, pk_s);
+        end = steady_clock::now();
+        double client_query_time = duration<double, std::milli>(end - start).count();
+        print_timing("Client Query", client_query_time);
+
+        // Server Issue
+        start = steady_clock::now();
+        ResponsePairing response = server.server_issue(pp, sk_s, pk_c, query);
+        end = steady_clock::now();
+        double server_issue_time = duration<double, std::milli>(end - start).count();
+        print_timing("Server Issue", server_issue_time);
+
+        // Client Finalize Query
+        start = steady_clock::now();
+        Token token = client.client_final(response);
+        end = steady_clock::now();
+        double client_final_time = duration<double, std::milli>(end - start).count();
+        print_timing("Client Finalize Query", client_final_time);
+
+        std::cout << "\n** Total Issuance Time: " 
+                  << std::fixed << std::setprecision(2)
+                  << (client_query_time + server_issue_time + client_final_time) 
+                  << " ms **" << std::endl;
+
+        // Client Redeem Part 1
+        start = steady_clock::now();
+        RedemptionProof1 proof1 = client.client_prove_redemption1(token, sk_c, pk_s);
+        end = steady_clock::now();
+        double client_redeem1_time = duration<double, std::milli>(end - start).count();
+        print_timing("Client Redeem Part 1", client_redeem1_time);
+
+        // Server Verify Redemption Part 1
+        start = steady_clock::now();
+        Fr c = server.server_verify_redemption1(token, pk_s, proof1);
+        end = steady_clock::now();
+        double server_verify1_time = duration<double, std::milli>(end - start).count();
+        print_timing("Server Verify Redemption Part 1", server_verify1_time);
+
+        // Client Redeem Part 2
+        start = steady_clock::now();
+        RedemptionProof2 proof2 = client.client_prove_redemption2(token, sk_c, c);
+        end = steady_clock::now();
+        double client_redeem2_time = duration<double, std::milli>(end - start).count();
+        print_timing("Client Redeem Part 2", client_redeem2_time);
+
+        // Server Verify Redemption Part 2
+        start = steady_clock::now();
+        bool verified = server.server_verify_redemption2(token, sk_s, proof2);
+        end = steady_clock::now();
+        double server_verify2_time = duration<double, std::milli>(end - start).count();
+        print_timing("Server Verify Redemption Part 2", server_verify2_time);
+
+        std::cout << "\n** Total Redemption Time: " 
+                  << std::fixed << std::setprecision(2)
+                  << (client_redeem1_time + server_verify1_time + client_redeem2_time + server_verify2_time) 
+                  << " ms **" << std::endl;
+
+        std::cout << "\nVerification result: SUCCESS" << std::endl;
+
+        std::cout << "\n=== Wire Format ===" << std::endl;
+        wire_report_header();
+        wire_report(query);
+        wire_report(response);
+        wire_report(token);
+        wire_report(proof1);
+        wire_report(proof2);
+        std::cout << std::endl;
+        wire_trust_report_header(64);
+        wire_trust_report(query);
+        wire_trust_report(token);
+        wire_trust_report(proof1);
+
+        // Performance test with 1000 iterations
+        std::cout << "\n=== Performance Test (1000 iterations) ===" << std::endl;
+
+        // Test Issuance (Client Query + Server Issue + Client Finalize)
+        std::cout << "\nTesting Issuance (full flow)..." << std::endl;
         Client test_client(pp, pk_s);
-        Query test_query = test_client.client_query(pp, sk_c, pk_s);
-        ResponsePairing test_resp = server.server_issue(pp, sk_s, pk_c, test_query);
-        Token test_token = test_client.client_final(test_resp);
-    }
-    end = steady_clock::now();
-    double total_issuance = duration<double, std::milli>(end - start).count();
-    std::cout << "Total time for 1000 issuances: " << std::fixed << std::setprecision(2) 
-              << total_issuance << " ms" << std::endl;
-    std::cout << "Average time per issuance: " << std::fixed << std::setprecision(2) 
-              << total_issuance / 1000.0 << " ms" << std::endl;
-    
-    // Test Redemption (all 4 steps)
-    std::cout << "\nTesting Redemption (full flow)..." << std::endl;
-    start = steady_clock::now();
-    for (int i = 0; i < 1000; ++i) {
-        RedemptionProof1 test_proof1 = client.client_prove_redemption1(token, sk_c, pk_s);
-        Fr test_c = server.server_verify_redemption1(token, pk_s, test_proof1);
-        RedemptionProof2 test_proof2 = client.client_prove_redemption2(token, sk_c, test_c);
-        bool test_verified = server.server_verify_redemption2(token, sk_s, test_proof2);
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            Query test_query = test_client.client_query(pp, sk_c, pk_s);
+            ResponsePairing test_resp = server.server_issue(pp, sk_s, pk_c, test_query);
+            Token test_token = test_client.client_final(test_resp);
+        }
+        end = steady_clock::now();
+        double total_issuance = duration<double, std::milli>(end - start).count();
+        std::cout << "Total time for 1000 issuances: " << std::fixed << std::setprecision(2) 
+                  << total_issuance << " ms" << std::endl;
+        std::cout << "Average time per issuance: " << std::fixed << std::setprecision(2) 
+                  << total_issuance / 1000.0 << " ms" << std::endl;
+
+        // Test Redemption (all 4 steps)
+        std::cout << "\nTesting Redemption (full flow)..." << std::endl;
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            RedemptionProof1 test_proof1 = client.client_prove_redemption1(token, sk_c, pk_s);
+            Fr test_c = server.server_verify_redemption1(token, pk_s, test_proof1);
+            RedemptionProof2 test_proof2 = client.client_prove_redemption2(token, sk_c, test_c);
+            bool test_verified = server.server_verify_redemption2(token, sk_s, test_proof2);
+        }
+        end = steady_clock::now();
+        double total_redemption = duration<double, std::milli>(end - start).count();
+        std::cout << "Total time for 1000 redemptions: " << std::fixed << std::setprecision(2) 
+                  << total_redemption << " ms" << std::endl;
+        std::cout << "Average time per redemption: " << std::fixed << std::setprecision(2) 
+                  << total_redemption / 1000.0 << " ms" << std::endl;
+
+        // Client-side cost of checking the issuer's response in client_final
+        std::cout << "\n=== Client Finalize Check (1000 iterations) ===" << std::endl;
+        Fr lambda;
+        lambda.setByCSPRNG();
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            Fr lambda_inv;
+            Fr::inv(lambda_inv, lambda);
+            G1 sigma;
+            G1::mulCT(sigma, response.S, lambda_inv);
+        }
+        end = steady_clock::now();
+        double unchecked_final = duration<double, std::milli>(end - start).count();
+
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            G2 pk_s_plus_s;
+            G2::mul(pk_s_plus_s, pp.g2, response.s);
+            pk_s_plus_s += pk_s;
+            GT e1, e2;
+            pairing(e1, response.S, pk_s_plus_s);
+            pairing(e2, query.T, pp.g2);
+        }
+        end = steady_clock::now();
+        double two_pairings = duration<double, std::milli>(end - start).count();
+
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            client.client_final(response);
+        }
+        end = steady_clock::now();
+        double checked_final = duration<double, std::milli>(end - start).count();
+
+        print_timing("Unblind only (no check)", unchecked_final / 1000.0);
+        print_timing("Unblind + check, two full pairings", (unchecked_final + two_pairings) / 1000.0);
+        print_timing("client_final (multi-Miller loop, precomputed lines)", checked_final / 1000.0);
+        print_timing("Added client cost of the check", (checked_final - unchecked_final) / 1000.0);
+
+        // Server-side issuance including REP3 verification: one query at a
+        // time vs. a queue checked with rep3_verify_batch
+        std::cout << "\n=== Server Issuance with REP3 Verification ===" << std::endl;
+        const size_t batch_sizes[] = { 16, 64, 256 };
+        for (size_t k : batch_sizes) {
+            std::vector<G1> pk_cs(k);
+            std::vector<Query> queue(k);
+            std::vector<Client> queued_clients(k, Client(pp, pk_s));
+            for (size_t i = 0; i < k; ++i) {
+                Fr sk_i;
+                sk_i.setByCSPRNG();
+                G1::mul(pk_cs[i], pp.g1, sk_i);
+                queue[i] = queued_clients[i].client_query(pp, sk_i, pk_s);
+            }
+            
+            start = steady_clock::now();
+            for (size_t i = 0; i < k; ++i) {
+                server.server_issue(pp, sk_s, pk_cs[i], queue[i]);
+            }
+            end = steady_clock::now();
+            double per_query = duration<double, std::milli>(end - start).count();
+            
+            start = steady_clock::now();
+            std::vector<ResponsePairing> responses = server.server_issue_batch(pp, sk_s, pk_cs, queue);
+            end = steady_clock::now();
+            double batched = duration<double, std::milli>(end - start).count();
+            
+            std::cout << "k = " << k << ": per-query " << std::fixed << std::setprecision(3)
+                      << per_query / k << " ms/query, batched " << batched / k
+                      << " ms/query (" << std::setprecision(2) << per_query / batched << "x)" << std::endl;
+            
+            start = steady_clock::now();
+            for (size_t i = 0; i < k; ++i) {
+                queued_clients[i].client_final(responses[i]);
+            }
+            end = steady_clock::now();
+            double per_token = duration<double, std::milli>(end - start).count();
+            
+            start = steady_clock::now();
+            Client::client_final_batch(queued_clients, responses);
+            end = steady_clock::now();
+            double batched_final = duration<double, std::milli>(end - start).count();
+            
+            std::cout << "        client_final per-token " << std::fixed << std::setprecision(3)
+                      << per_token / k << " ms/token, batched " << batched_final / k
+                      << " ms/token (" << std::setprecision(2) << per_token / batched_final << "x)" << std::endl;
+        }
+        
+        // Server-side redemption against a spent set that already holds
+        // many tokens, with and without the Bloom filter in front of it
+        const size_t prefill = 1000000;
+        const int num_redeem = 200;
+        std::cout << "\n=== Redemption with Double-spend Check (" << prefill
+                  << " tokens already spent) ===" << std::endl;
+        {
+            NullifierStore plain(prefill + num_redeem);
+            FilteredNullifierStore filtered(prefill + num_redeem);
+            for (size_t i = 0; i < prefill; ++i) {
+                Fr x;
+                x.setByCSPRNG();
+                NullifierTag tag = nullifier_tag("bench", x);
+                plain.insert(tag);
+                filtered.insert(tag);
+            }
+            filtered.flush();
+
+            const size_t trials = 100000;
+            size_t false_positives = 0;
+            for (size_t i = 0; i < trials; ++i) {
+                Fr x;
+                x.setByCSPRNG();
+                false_positives += filtered.filter().may_contain(nullifier_tag("bench", x));
+            }
+            std::cout << "Filter false-positive rate: " << std::fixed << std::setprecision(3)
+                      << 100.0 * false_positives / trials << "% (" << (filtered.filter().bytes() >> 10)
+                      << " KiB)" << std::endl;
+
+            std::vector<Token> tokens(num_redeem);
+            for (int i = 0; i < num_redeem; ++i) {
+                Query q = test_client.client_query(pp, sk_c, pk_s);
+                tokens[i] = test_client.client_final(server.server_issue(pp, sk_s, pk_c, q));
+            }
+
+            double elapsed[2] = { 0, 0 };
+            bool double_spend_refused = true;
+            for (int pass = 0; pass < 2; ++pass) {
+                for (int i = 0; i < num_redeem; ++i) {
+                    RedemptionProof1 p1 = client.client_prove_redemption1(tokens[i], sk_c, pk_s);
+                    start = steady_clock::now();
+                    Fr ci = server.server_verify_redemption1(tokens[i], pk_s, p1);
+                    end = steady_clock::now();
+                    elapsed[pass] += duration<double, std::milli>(end - start).count();
+                    RedemptionProof2 p2 = client.client_prove_redemption2(tokens[i], sk_c, ci);
+                    start = steady_clock::now();
+                    bool ok = pass == 0 ? server.server_verify_redemption2(tokens[i], sk_s, p2, plain)
+                                        : server.server_verify_redemption2(tokens[i], sk_s, p2, filtered);
+                    end = steady_clock::now();
+                    elapsed[pass] += duration<double, std::milli>(end - start).count();
+                    if (!ok) {
+                        std::cout << "Valid token " << i << " rejected" << std::endl;
+                    }
+                    if (i == 0) {
+                        bool again = pass == 0 ? server.server_verify_redemption2(tokens[i], sk_s, p2, plain)
+                                               : server.server_verify_redemption2(tokens[i], sk_s, p2, filtered);
+                        double_spend_refused = double_spend_refused && !again;
+                    }
+                }
+            }
+            std::cout << "Server redemptions/second: table only ~" << std::fixed << std::setprecision(0)
+                      << num_redeem * 1000.0 / elapsed[0] << ", filtered ~" << num_redeem * 1000.0 / elapsed[1]
+                      << (double_spend_refused ? "" : " (double spend accepted)") << std::endl;
+        }
+
+        // Summary
+        std::cout << "\n=== Performance Summary ===" << std::endl;
+        std::cout << "Issuance throughput: ~" << std::fixed << std::setprecision(0)
+                  << 1000000.0 / total_issuance << " tokens/second" << std::endl;
+        std::cout << "Redemption throughput: ~" << std::fixed << std::setprecision(0)
+                  << 1000000.0 / total_redemption << " tokens/second" << std::endl;
+
+        CurveBenchSummary summary;
+        summary.issuance_ms = total_issuance / 1000.0;
+        summary.redemption_ms = total_redemption / 1000.0;
+        return summary;
     }
-    end = steady_clock::now();
-    double total_redemption = duration<double, std::milli>(end - start).count();
-    std::cout << "Total time for 1000 redemptions: " << std::fixed << std::setprecision(2) 
-              << total_redemption << " ms" << std::endl;
-    std::cout << "Average time per redemption: " << std::fixed << std::setprecision(2) 
-              << total_redemption / 1000.0 << " ms" << std::endl;
-    
-    // Summary
-    std::cout << "\n=== Performance Summary ===" << std::endl;
-    std::cout << "Issuance throughput: ~" << std::fixed << std::setprecision(0)
-              << 1000000.0 / total_issuance << " tokens/second" << std::endl;
-    std::cout << "Redemption throughput: ~" << std::fixed << std::setprecision(0)
-              << 1000000.0 / total_redemption << " tokens/second" << std::endl;
-    
-    return 0;
+};
+
+// Usage: ntat_benchmark [bn254|bls12_381|bn462|all]
+int main(int argc, char** argv) {
+    std::string curve = argc > 1 ? argv[1] : "bn254";
+    return run_curve_benchmark(curve, NTATBenchmark());
 }
@@ -1,13 +1,20 @@
 #include "ntat_pairing.h"
+#include "scalar_mul.h"
+#include "batch_inv.h"
+#include "arena.h"
+#include <stdexcept>
 #include <iostream>
-#include <sstream>
 #include <cstring>
 #include <openssl/sha.h>
 
 // Utility function to hash to Fr (matching Rust implementation)
 void hashToFr(Fr& result, const std::string& data) {
+    hashToFr(result, data.data(), data.size());
+}
+
+void hashToFr(Fr& result, const void* data, size_t size) {
     unsigned char hash[SHA256_DIGEST_LENGTH];
-    SHA256(reinterpret_cast<const unsigned char*>(data.c_str()), data.size(), hash);
+    SHA256(reinterpret_cast<const unsigned char*>(data), size, hash);
     
     // Convert to hex string like Rust's digest() does
     char hex_string[65];
@@ -53,6 +60,31 @@ PublicParams setup() {
     return pp;
 }
 
+// Fiat-Shamir challenge shared by rep3_prove and rep3_verify. The transcript
+// is serialized into a stack buffer so neither side allocates.
+static void rep3_challenge(
+    Fr& ch,
+    const PublicParams& pp,
+    const G1& X,
+    const G1& T,
+    const G1& comm1,
+    const G1& comm2
+) {
+    unsigned char hash_input[7 * MAX_G1_BYTES + MAX_G2_BYTES];
+    size_t len = 0;
+    
+    len += pp.g1.serialize(hash_input + len, MAX_G1_BYTES);
+    len += pp.g2.serialize(hash_input + len, MAX_G2_BYTES);
+    len += pp.g3.serialize(hash_input + len, MAX_G1_BYTES);
+    len += pp.g4.serialize(hash_input + len, MAX_G1_BYTES);
+    len += X.serialize(hash_input + len, MAX_G1_BYTES);
+    len += T.serialize(hash_input + len, MAX_G1_BYTES);
+    len += comm1.serialize(hash_input + len, MAX_G1_BYTES);
+    len += comm2.serialize(hash_input + len, MAX_G1_BYTES);
+    
+    hashToFr(ch, hash_input, len);
+}
+
 // REP3 Prove
 REP3Proof rep3_prove(
     const PublicParams& pp,
@@ -68,40 +100,19 @@ REP3Proof rep3_prove(
     c.setByCSPRNG();
     
     G1 comm1, comm2;
-    G1::mul(comm1, pp.g1, a);
+    mul_secret(comm1, pp.g1, a);
     
     G1 temp1, temp2, temp3;
-    G1::mul(temp1, pp.g1, a);
-    G1::mul(temp2, pp.g3, b);
-    G1::mul(temp3, T, c);
+    mul_secret(temp1, pp.g1, a);
+    mul_secret(temp2, pp.g3, b);
+    mul_secret(temp3, T, c);
     comm2 = temp1;
     comm2 += temp2;
     comm2 += temp3;
     
     // Compute challenge
-    std::stringstream ss;
-    unsigned char buf_g1[64], buf_g2[96];
-    
-    pp.g1.serialize(buf_g1, 64);
-    ss.write(reinterpret_cast<char*>(buf_g1), 64);
-    pp.g2.serialize(buf_g2, 96);
-    ss.write(reinterpret_cast<char*>(buf_g2), 96);
-    pp.g3.serialize(buf_g1, 64);
-    ss.write(reinterpret_cast<char*>(buf_g1), 64);
-    pp.g4.serialize(buf_g1, 64);
-    ss.write(reinterpret_cast<char*>(buf_g1), 64);
-    X.serialize(buf_g1, 64);
-    ss.write(reinterpret_cast<char*>(buf_g1), 64);
-    T.serialize(buf_g1, 64);
-    ss.write(reinterpret_cast<char*>(buf_g1), 64);
-    comm1.serialize(buf_g1, 64);
-    ss.write(reinterpret_cast<char*>(buf_g1), 64);
-    comm2.serialize(buf_g1, 64);
-    ss.write(reinterpret_cast<char*>(buf_g1), 64);
-    
-    std::string hash_input = ss.str();
     Fr ch;
-    hashToFr(ch, hash_input);
+    rep3_challenge(ch, pp, X, T, comm1, comm2);
     
     // Compute responses
     Fr resp1, resp2, resp3;
@@ -123,6 +134,8 @@ REP3Proof rep3_prove(
     proof.resp1 = resp1;
     proof.resp2 = resp2;
     proof.resp3 = resp3;
+    proof.comm1 = comm1;
+    proof.comm2 = comm2;
     
     return proof;
 }
@@ -134,54 +147,109 @@ bool rep3_verify(
     const G1& T,
     const REP3Proof& pi_c
 ) {
+    // Challenge and responses are public: one MSM per commitment.
     G1 comm1_, comm2_;
-    G1 temp1, temp2, temp3, temp4;
     
-    G1::mul(temp1, pp.g1, pi_c.resp1);
-    G1::mul(temp2, X, pi_c.ch);
-    comm1_ = temp1;
-    comm1_ += temp2;
+    G1 bases1[2] = { pp.g1, X };
+    Fr scalars1[2] = { pi_c.resp1, pi_c.ch };
+    msm_public(comm1_, bases1, scalars1, 2);
     
-    G1::mul(temp1, pp.g1, pi_c.resp1);
-    G1::mul(temp2, pp.g3, pi_c.resp2);
-    G1::mul(temp3, T, pi_c.resp3);
     Fr neg_ch;
     Fr::neg(neg_ch, pi_c.ch);
-    G1::mul(temp4, pp.g4, neg_ch);
-    
-    comm2_ = temp1;
-    comm2_ += temp2;
-    comm2_ += temp3;
-    comm2_ += temp4;
+    G1 bases2[4] = { pp.g1, pp.g3, T, pp.g4 };
+    Fr scalars2[4] = { pi_c.resp1, pi_c.resp2, pi_c.resp3, neg_ch };
+    msm_public(comm2_, bases2, scalars2, 4);
     
     // Recompute challenge
-    std::stringstream ss;
-    unsigned char buf_g1[64], buf_g2[96];
-    
-    pp.g1.serialize(buf_g1, 64);
-    ss.write(reinterpret_cast<char*>(buf_g1), 64);
-    pp.g2.serialize(buf_g2, 96);
-    ss.write(reinterpret_cast<char*>(buf_g2), 96);
-    pp.g3.serialize(buf_g1, 64);
-    ss.write(reinterpret_cast<char*>(buf_g1), 64);
-    pp.g4.serialize(buf_g1, 64);
-    ss.write(reinterpret_cast<char*>(buf_g1), 64);
-    X.serialize(buf_g1, 64);
-    ss.write(reinterpret_cast<char*>(buf_g1), 64);
-    T.serialize(buf_g1, 64);
-    ss.write(reinterpret_cast<char*>(buf_g1), 64);
-    comm1_.serialize(buf_g1, 64);
-    ss.write(reinterpret_cast<char*>(buf_g1), 64);
-    comm2_.serialize(buf_g1, 64);
-    ss.write(reinterpret_cast<char*>(buf_g1), 64);
-    
-    std::string hash_input = ss.str();
     Fr ch_;
-    hashToFr(ch_, hash_input);
+    rep3_challenge(ch_, pp, X, T, comm1_, comm2_);
     
     return pi_c.ch == ch_;
 }
 
+// REP3 Batch Verify
+bool rep3_verify_batch(
+    const PublicParams& pp,
+    const std::vector<G1>& X,
+    const std::vector<G1>& T,
+    const std::vector<REP3Proof>& proofs
+) {
+    size_t k = proofs.size();
+    if (X.size() != k || T.size() != k) {
+        return false;
+    }
+    if (k == 0) {
+        return true;
+    }
+    
+    // Each challenge must be the hash of the commitments it came with.
+    for (size_t i = 0; i < k; ++i) {
+        Fr ch_;
+        rep3_challenge(ch_, pp, X[i], T[i], proofs[i].comm1, proofs[i].comm2);
+        if (ch_ != proofs[i].ch) {
+            return false;
+        }
+    }
+    
+    // With random rho_i, check
+    //   sum_i rho_i * (g1*resp1_i + X_i*ch_i - comm1_i) == 0
+    //   sum_i rho_i * (g1*resp1_i + g3*resp2_i + T_i*resp3_i - g4*ch_i - comm2_i) == 0
+    // The fixed bases g1, g3, g4 collect a single summed scalar each.
+    ArenaScope scope;
+    ArenaVector<G1> bases1, bases2;
+    ArenaVector<Fr> scalars1, scalars2;
+    bases1.reserve(2 * k + 1);
+    scalars1.reserve(2 * k + 1);
+    bases2.reserve(2 * k + 3);
+    scalars2.reserve(2 * k + 3);
+    
+    Fr g1_coeff, g3_coeff, g4_coeff;
+    g1_coeff.clear();
+    g3_coeff.clear();
+    g4_coeff.clear();
+    
+    for (size_t i = 0; i < k; ++i) {
+        const REP3Proof& pi = proofs[i];
+        Fr rho, neg_rho, temp;
+        rho.setByCSPRNG();
+        Fr::neg(neg_rho, rho);
+        
+        Fr::mul(temp, rho, pi.resp1);
+        g1_coeff += temp;
+        Fr::mul(temp, rho, pi.resp2);
+        g3_coeff += temp;
+        Fr::mul(temp, rho, pi.ch);
+        g4_coeff -= temp;
+        
+        bases1.push_back(X[i]);
+        scalars1.push_back(temp);
+        bases1.push_back(pi.comm1);
+        scalars1.push_back(neg_rho);
+        
+        Fr::mul(temp, rho, pi.resp3);
+        bases2.push_back(T[i]);
+        scalars2.push_back(temp);
+        bases2.push_back(pi.comm2);
+        scalars2.push_back(neg_rho);
+    }
+    
+    bases1.push_back(pp.g1);
+    scalars1.push_back(g1_coeff);
+    
+    bases2.push_back(pp.g1);
+    scalars2.push_back(g1_coeff);
+    bases2.push_back(pp.g3);
+    scalars2.push_back(g3_coeff);
+    bases2.push_back(pp.g4);
+    scalars2.push_back(g4_coeff);
+    
+    G1 check1, check2;
+    msm_public(check1, bases1.data(), scalars1.data(), bases1.size());
+    msm_public(check2, bases2.data(), scalars2.data(), bases2.size());
+    
+    return check1.isZero() && check2.isZero();
+}
+
 // Client implementation
 Client::Client(const PublicParams& pp, const G2& pk_s) 
     : pp(pp), pk_s(pk_s) {
@@ -192,6 +260,19 @@ Client::Client(const PublicParams& pp, const G2& pk_s)
     beta.setByCSPRNG();
     gamma.setByCSPRNG();
     rho.setByCSPRNG();
+    precomputeG2(pk_s_lines, pk_s);
+    precomputeG2(g2_lines, pp.g2);
+}
+
+// e(S, pk_s + g2*s) == e(T, g2) is rewritten as e(S, pk_s) * e(R, g2) == 1
+// with R = s*S - T, so both G2 arguments are fixed and the check is one
+// two-pairing Miller loop over precomputed lines plus one final
+// exponentiation.
+bool Client::issuer_check(const G1& S, const G1& R) const {
+    GT f;
+    precomputedMillerLoop2(f, S, pk_s_lines, R, g2_lines);
+    finalExp(f, f);
+    return f.isOne();
 }
 
 Query Client::client_query(
@@ -199,21 +280,19 @@ Query Client::client_query(
     const Fr& sk_c,
     const G2& pk_s
 ) {
-    G1 X, temp1, temp2, temp3;
-    G1::mul(X, pp.g1, sk_c);
+    G1 X, temp;
+    mul_secret(X, pp.g1, sk_c);
     
     r.setByCSPRNG();
     lambda.setByCSPRNG();
     
-    G1::mul(temp1, X, 1);
-    G1::mul(temp2, pp.g3, r);
-    G1::mul(temp3, pp.g4, 1);
+    mul_secret(temp, pp.g3, r);
     
-    G1 sum = temp1;
-    sum += temp2;
-    sum += temp3;
+    G1 sum = X;
+    sum += temp;
+    sum += pp.g4;
     
-    G1::mul(T, sum, lambda);
+    mul_secret(T, sum, lambda);
     
     REP3Proof pi_c = rep3_prove(pp, X, T, sk_c, lambda, r);
     
@@ -225,20 +304,18 @@ Query Client::client_query(
 }
 
 Token Client::client_final(const ResponsePairing& resp) {
-    // Skip pairing verification for performance testing
-    // GT e1, e2;
-    // G2 temp_g2;
-    // G2::mul(temp_g2, pp.g2, resp.s);
-    // G2 pk_s_plus_s;
-    // G2::add(pk_s_plus_s, pk_s, temp_g2);
-    // pairing(e1, resp.S, pk_s_plus_s);
-    // pairing(e2, T, pp.g2);
+    G1 R;
+    mul_public(R, resp.S, resp.s);
+    R -= T;
+    if (!issuer_check(resp.S, R)) {
+        throw std::runtime_error("client_final: issuer response rejected");
+    }
     
     Fr lambda_inv;
     Fr::inv(lambda_inv, lambda);
     
     G1 sigma;
-    G1::mul(sigma, resp.S, lambda_inv);
+    mul_secret(sigma, resp.S, lambda_inv);
     
     Token token;
     token.sigma = sigma;
@@ -248,6 +325,68 @@ Token Client::client_final(const ResponsePairing& resp) {
     return token;
 }
 
+std::vector<Token> Client::client_final_batch(
+    const std::vector<Client>& clients,
+    const std::vector<ResponsePairing>& resps
+) {
+    size_t k = clients.size();
+    if (resps.size() != k) {
+        throw std::invalid_argument("client_final_batch: one response per client");
+    }
+    
+    if (k == 0) {
+        return std::vector<Token>();
+    }
+    for (size_t i = 1; i < k; ++i) {
+        if (!(clients[i].pk_s == clients[0].pk_s)) {
+            throw std::invalid_argument("client_final_batch: clients of different issuers");
+        }
+    }
+    
+    // With random rho_i, one check covers all k responses:
+    // e(sum rho_i S_i, pk_s) * e(sum rho_i (s_i S_i - T_i), g2) == 1.
+    std::vector<G1> bases(2 * k);
+    std::vector<Fr> scalars(2 * k);
+    std::vector<Fr> rhos(k);
+    for (size_t i = 0; i < k; ++i) {
+        rhos[i].setByCSPRNG();
+        bases[i] = resps[i].S;
+        Fr::mul(scalars[i], rhos[i], resps[i].s);
+        bases[k + i] = clients[i].T;
+        Fr::neg(scalars[k + i], rhos[i]);
+    }
+    G1 S_sum, R_sum;
+    msm_public(S_sum, bases.data(), rhos.data(), k);
+    msm_public(R_sum, bases.data(), scalars.data(), 2 * k);
+    if (!clients[0].issuer_check(S_sum, R_sum)) {
+        for (size_t i = 0; i < k; ++i) {
+            G1 R;
+            mul_public(R, resps[i].S, resps[i].s);
+            R -= clients[i].T;
+            if (!clients[i].issuer_check(resps[i].S, R)) {
+                throw std::runtime_error("client_final_batch: issuer response rejected for token " +
+                                         std::to_string(i));
+            }
+        }
+        throw std::runtime_error("client_final_batch: batch issuer check rejected");
+    }
+    
+    std::vector<Fr> lambdas(k), lambda_invs(k);
+    for (size_t i = 0; i < k; ++i) {
+        lambdas[i] = clients[i].lambda;
+    }
+    batch_inv(lambda_invs.data(), lambdas.data(), k);
+    
+    std::vector<Token> tokens(k);
+    for (size_t i = 0; i < k; ++i) {
+        mul_secret(tokens[i].sigma, resps[i].S, lambda_invs[i]);
+        tokens[i].r = clients[i].r;
+        tokens[i].s = resps[i].s;
+    }
+    
+    return tokens;
+}
+
 RedemptionProof1 Client::client_prove_redemption1(
     const Token& token,
     const Fr& sk_c,
@@ -256,16 +395,15 @@ RedemptionProof1 Client::client_prove_redemption1(
     G1 sigma_;
     G1 temp1, temp2, temp3, temp4;
     
-    G1::mul(temp1, pp.g1, sk_c);
-    G1::mul(temp2, pp.g3, token.r);
-    G1::mul(temp3, pp.g4, 1);
+    mul_secret(temp1, pp.g1, sk_c);
+    mul_secret(temp2, pp.g3, token.r);
     Fr neg_s;
     Fr::neg(neg_s, token.s);
-    G1::mul(temp4, token.sigma, neg_s);
+    mul_secret(temp4, token.sigma, neg_s);
     
     sigma_ = temp1;
     sigma_ += temp2;
-    sigma_ += temp3;
+    sigma_ += pp.g4;
     sigma_ += temp4;
     
     alpha.setByCSPRNG();
@@ -273,9 +411,9 @@ RedemptionProof1 Client::client_prove_redemption1(
     gamma.setByCSPRNG();
     
     G1 Q;
-    G1::mul(temp1, pp.g1, alpha);
-    G1::mul(temp2, pp.g3, beta);
-    G1::mul(temp3, token.sigma, gamma);
+    mul_secret(temp1, pp.g1, alpha);
+    mul_secret(temp2, pp.g3, beta);
+    mul_secret(temp3, token.sigma, gamma);
     
     Q = temp1;
     Q += temp2;
@@ -283,16 +421,12 @@ RedemptionProof1 Client::client_prove_redemption1(
     
     rho.setByCSPRNG();
     
-    std::stringstream ss;
-    unsigned char buf[64];
-    
-    ss << rho.getStr();
-    Q.serialize(buf, 64);
-    ss.write(reinterpret_cast<char*>(buf), 64);
+    unsigned char hash_input[MAX_FR_BYTES + MAX_G1_BYTES];
+    size_t len = rho.serialize(hash_input, MAX_FR_BYTES);
+    len += Q.serialize(hash_input + len, MAX_G1_BYTES);
     
-    std::string hash_input = ss.str();
     Fr comm;
-    hashToFr(comm, hash_input);
+    hashToFr(comm, hash_input, len);
     
     RedemptionProof1 proof;
     proof.sigma_ = sigma_;
@@ -341,8 +475,9 @@ ResponsePairing Server::server_issue(
     const G1& pk_c,
     const Query& query
 ) {
-    // Skip verification for performance testing
-    // bool verified = rep3_verify(pp, this->pk_c, query.T, query.pi_c);
+    if (!rep3_verify(pp, pk_c, query.T, query.pi_c)) {
+        throw std::runtime_error("server_issue: REP3 proof rejected");
+    }
     
     Fr s;
     s.setByCSPRNG();
@@ -354,7 +489,7 @@ ResponsePairing Server::server_issue(
     Fr::inv(inv, sk_s_plus_s);
     
     G1 S;
-    G1::mul(S, query.T, inv);
+    mul_secret(S, query.T, inv);
     
     ResponsePairing resp;
     resp.s = s;
@@ -363,6 +498,51 @@ ResponsePairing Server::server_issue(
     return resp;
 }
 
+std::vector<ResponsePairing> Server::server_issue_batch(
+    const PublicParams& pp,
+    const Fr& sk_s,
+    const std::vector<G1>& pk_cs,
+    const std::vector<Query>& queries
+) {
+    size_t k = queries.size();
+    if (pk_cs.size() != k) {
+        throw std::invalid_argument("server_issue_batch: one client key per query");
+    }
+    
+    std::vector<G1> T(k);
+    std::vector<REP3Proof> proofs(k);
+    for (size_t i = 0; i < k; ++i) {
+        T[i] = queries[i].T;
+        proofs[i] = queries[i].pi_c;
+    }
+    
+    if (!rep3_verify_batch(pp, pk_cs, T, proofs)) {
+        // Find the offending query so the caller can drop it and retry.
+        for (size_t i = 0; i < k; ++i) {
+            if (!rep3_verify(pp, pk_cs[i], T[i], proofs[i])) {
+                throw std::runtime_error("server_issue_batch: REP3 proof rejected for query " +
+                                         std::to_string(i));
+            }
+        }
+        throw std::runtime_error("server_issue_batch: REP3 batch check rejected");
+    }
+    
+    // One inversion for the whole queue instead of one per query.
+    std::vector<ResponsePairing> responses(k);
+    std::vector<Fr> sk_s_plus_s(k), inv(k);
+    for (size_t i = 0; i < k; ++i) {
+        responses[i].s.setByCSPRNG();
+        Fr::add(sk_s_plus_s[i], sk_s, responses[i].s);
+    }
+    batch_inv(inv.data(), sk_s_plus_s.data(), k);
+    
+    for (size_t i = 0; i < k; ++i) {
+        mul_secret(responses[i].S, T[i], inv[i]);
+    }
+    
+    return responses;
+}
+
 Fr Server::server_verify_redemption1(
     const Token& token,
     const G2& pk_s,
@@ -385,33 +565,44 @@ bool Server::server_verify_redemption2(
     const Fr& sk_s,
     const RedemptionProof2& proof
 ) {
-    G1 Q_;
-    G1 temp1, temp2, temp3;
+    // Q_s = g1*v0 + g3*v1 + sigma*v2 - (sigma_ - g4)*c, all public scalars.
+    G1 sigma_minus_g4;
+    G1::sub(sigma_minus_g4, sigma_, pp.g4);
     
-    G1::mul(temp1, pp.g1, proof.v0);
-    G1::mul(temp2, pp.g3, proof.v1);
-    G1::mul(temp3, token.sigma, proof.v2);
-    
-    Q_ = temp1;
-    Q_ += temp2;
-    Q_ += temp3;
+    Fr neg_c;
+    Fr::neg(neg_c, c);
+    G1 bases[4] = { pp.g1, pp.g3, token.sigma, sigma_minus_g4 };
+    Fr scalars[4] = { proof.v0, proof.v1, proof.v2, neg_c };
     
     G1 Q_s;
-    G1 temp4, temp5;
-    G1::sub(temp4, sigma_, pp.g4);
-    G1::mul(temp5, temp4, c);
-    G1::sub(Q_s, Q_, temp5);
-    
-    std::stringstream ss;
-    unsigned char buf[64];
+    msm_public(Q_s, bases, scalars, 4);
     
-    ss << proof.rho.getStr();
-    Q_s.serialize(buf, 64);
-    ss.write(reinterpret_cast<char*>(buf), 64);
+    unsigned char hash_input[MAX_FR_BYTES + MAX_G1_BYTES];
+    size_t len = proof.rho.serialize(hash_input, MAX_FR_BYTES);
+    len += Q_s.serialize(hash_input + len, MAX_G1_BYTES);
     
-    std::string hash_input = ss.str();
     Fr comm_s;
-    hashToFr(comm_s, hash_input);
+    hashToFr(comm_s, hash_input, len);
     
     return comm_s == comm;
 }
+
+bool Server::server_verify_redemption2(
+    const Token& token,
+    const Fr& sk_s,
+    const RedemptionProof2& proof,
+    NullifierStore& spent
+) {
+    return server_verify_redemption2(token, sk_s, proof) &&
+           spent.insert(nullifier_tag("ntat/sigma", token.sigma));
+}
+
+bool Server::server_verify_redemption2(
+    const Token& token,
+    const Fr& sk_s,
+    const RedemptionProof2& proof,
+    FilteredNullifierStore& spent
+) {
+    return server_verify_redemption2(token, sk_s, proof) &&
+           spent.insert(nullifier_tag("ntat/sigma", token.sigma));
+}
@@ -1,8 +1,11 @@
 #include "ntat_pairing.h"
+#include "batch_inv.h"
 #include <iostream>
 
 int main() {
-    initPairing();
+    if (!init_curve("bn254")) {
+        return 1;
+    }
     
     std::cout << "=== Simple REP3 Test ===" << std::endl;
     
@@ -47,5 +50,44 @@ int main() {
     
     std::cout << "Verification result: " << (verified ? "SUCCESS" : "FAILED") << std::endl;
     
+    // Batch verification over several clients' proofs
+    const int k = 8;
+    std::vector<G1> Xs(k), Ts(k);
+    std::vector<REP3Proof> proofs(k);
+    for (int i = 0; i < k; ++i) {
+        Fr sk_i, r_i, lambda_i;
+        sk_i.setByCSPRNG();
+        r_i.setByCSPRNG();
+        lambda_i.setByCSPRNG();
+        G1::mul(Xs[i], pp.g1, sk_i);
+        G1::mul(temp2, pp.g3, r_i);
+        sum = Xs[i];
+        sum += temp2;
+        sum += pp.g4;
+        G1::mul(Ts[i], sum, lambda_i);
+        proofs[i] = rep3_prove(pp, Xs[i], Ts[i], sk_i, lambda_i, r_i);
+    }
+    
+    bool batch_verified = rep3_verify_batch(pp, Xs, Ts, proofs);
+    std::cout << "Batch verification (" << k << " proofs): " << (batch_verified ? "SUCCESS" : "FAILED") << std::endl;
+    
+    proofs[k / 2].resp2 += Fr(1);
+    bool tampered_rejected = !rep3_verify_batch(pp, Xs, Ts, proofs);
+    std::cout << "Tampered proof rejected by batch: " << (tampered_rejected ? "SUCCESS" : "FAILED") << std::endl;
+    
+    // Batch inversion against one Fr::inv per element
+    std::vector<Fr> xs(k), invs(k);
+    for (int i = 0; i < k; ++i) {
+        xs[i].setByCSPRNG();
+    }
+    batch_inv(invs.data(), xs.data(), k);
+    bool inv_ok = true;
+    for (int i = 0; i < k; ++i) {
+        Fr expected;
+        Fr::inv(expected, xs[i]);
+        inv_ok &= (invs[i] == expected);
+    }
+    std::cout << "Batch inversion (" << k << " elements): " << (inv_ok ? "SUCCESS" : "FAILED") << std::endl;
+    
     return 0;
 }
@@ -1,12 +1,12 @@
-#include <mcl/bn256.hpp>
+#include "curve.h"
 #include <iostream>
 #include <chrono>
 #include <iomanip>
 
 using namespace std::chrono;
-using namespace mcl::bn256;
 
 #include "uprove_protocol.cpp"
+#include "wire_bench.h"
 
 void print_timing(const std::string& operation, double ms) {
     std::cout << operation << ": " 
@@ -14,136 +14,254 @@ void print_timing(const std::string& operation, double ms) {
               << ms << " ms" << std::endl;
 }
 
-int main() {
-    initPairing();
-    
-    std::cout << "\n========================================" << std::endl;
-    std::cout << "=== U-Prove Protocol Benchmark ===" << std::endl;
-    std::cout << "========================================\n" << std::endl;
-    
-    auto start = steady_clock::now();
-    UProve_PublicParams pp = uprove_setup();
-    auto end = steady_clock::now();
-    print_timing("Setup", duration<double, std::milli>(end - start).count());
-    
-    Fr sk_c, sk_s, pi;
-    sk_c.setByCSPRNG();
-    sk_s.setByCSPRNG();
-    pi.setByCSPRNG();
-    
-    G1 pk_c;
-    G1::mul(pk_c, pp.gd, sk_c);
-    
-    // Single run test
-    std::cout << "\n=== Single Run Test ===" << std::endl;
-    
-    start = steady_clock::now();
-    UProve_InitMessage init_msg = uprove_server_initiate(pp, sk_s, pk_c);
-    end = steady_clock::now();
-    double server_init_time = duration<double, std::milli>(end - start).count();
-    print_timing("Server Initiate", server_init_time);
-    
-    Fr alpha, beta2, sigma_c_;
-    G1 H, Sigma_z_;
-    
-    start = steady_clock::now();
-    Fr sigma_c = uprove_client_query(pp, pk_c, pi, init_msg, alpha, beta2, H, Sigma_z_, sigma_c_);
-    end = steady_clock::now();
-    double client_query_time = duration<double, std::milli>(end - start).count();
-    print_timing("Client Query", client_query_time);
-    
-    Fr w;
-    w.setByCSPRNG();
-    
-    start = steady_clock::now();
-    Fr sigma_r = uprove_server_issue(sk_s, w, sigma_c);
-    end = steady_clock::now();
-    double server_issue_time = duration<double, std::milli>(end - start).count();
-    print_timing("Server Issue", server_issue_time);
-    
-    start = steady_clock::now();
-    bool finalized = uprove_client_final(pp, H, sigma_c_, beta2, sigma_r, Sigma_z_);
-    end = steady_clock::now();
-    double client_final_time = duration<double, std::milli>(end - start).count();
-    print_timing("Client Finalize", client_final_time);
-    
-    std::cout << "\n** Total Issuance Time: " << std::fixed << std::setprecision(2)
-              << (server_init_time + client_query_time + server_issue_time + client_final_time) << " ms **" << std::endl;
-    
-    UProve_Token token;
-    token.H = H;
-    token.pi = pi;
-    token.Sigma_z_ = Sigma_z_;
-    token.sigma_c_ = sigma_c_;
-    token.sigma_r_ = sigma_r;
-    
-    Fr wd_, w0, wd;
-    
-    start = steady_clock::now();
-    UProve_RedemptionProof1 proof1 = uprove_client_prove_redemption1(pp, token, wd_, w0, wd);
-    end = steady_clock::now();
-    double client_redeem1_time = duration<double, std::milli>(end - start).count();
-    print_timing("Client Redeem Part 1", client_redeem1_time);
-    
-    start = steady_clock::now();
-    Fr a = uprove_server_verify_redemption1(pp, proof1);
-    end = steady_clock::now();
-    double server_verify1_time = duration<double, std::milli>(end - start).count();
-    print_timing("Server Verify Part 1", server_verify1_time);
-    
-    start = steady_clock::now();
-    UProve_RedemptionProof2 proof2 = uprove_client_prove_redemption2(token, a, sk_c, alpha, wd_, w0, wd);
-    end = steady_clock::now();
-    double client_redeem2_time = duration<double, std::milli>(end - start).count();
-    print_timing("Client Redeem Part 2", client_redeem2_time);
-    
-    start = steady_clock::now();
-    bool verified = uprove_server_redeem(pp, token, proof1.comm, a, proof2);
-    end = steady_clock::now();
-    double server_verify2_time = duration<double, std::milli>(end - start).count();
-    print_timing("Server Verify Part 2", server_verify2_time);
-    
-    std::cout << "\n** Total Redemption Time: " << std::fixed << std::setprecision(2)
-              << (client_redeem1_time + server_verify1_time + client_redeem2_time + server_verify2_time) << " ms **" << std::endl;
-    
-    std::cout << "\nVerification result: SUCCESS" << std::endl;
-    
-    // Performance test
-    std::cout << "\n=== Performance Test (1000 iterations) ===" << std::endl;
-    
-    start = steady_clock::now();
-    for (int i = 0; i < 1000; ++i) {
-        UProve_InitMessage im = uprove_server_initiate(pp, sk_s, pk_c);
-        Fr sc = uprove_client_query(pp, pk_c, pi, im, alpha, beta2, H, Sigma_z_, sigma_c_);
-        Fr sr = uprove_server_issue(sk_s, w, sc);
-        uprove_client_final(pp, H, sigma_c_, beta2, sr, Sigma_z_);
-    }
-    end = steady_clock::now();
-    double total_issuance = duration<double, std::milli>(end - start).count();
-    std::cout << "Total time for 1000 issuances: " << std::fixed << std::setprecision(2) 
-              << total_issuance << " ms" << std::endl;
-    std::cout << "Average time per issuance: " << std::fixed << std::setprecision(2) 
-              << total_issuance / 1000.0 << " ms" << std::endl;
-    
-    start = steady_clock::now();
-    for (int i = 0; i < 1000; ++i) {
-        UProve_RedemptionProof1 p1 = uprove_client_prove_redemption1(pp, token, wd_, w0, wd);
-        Fr aa = uprove_server_verify_redemption1(pp, p1);
-        UProve_RedemptionProof2 p2 = uprove_client_prove_redemption2(token, aa, sk_c, alpha, wd_, w0, wd);
-        uprove_server_redeem(pp, token, p1.comm, aa, p2);
+struct UProveBenchmark {
+    template<class Curve>
+    CurveBenchSummary run() const {
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "=== U-Prove Protocol Benchmark ===" << std::endl;
+        std::cout << "========================================\n" << std::endl;
+
+        auto start = steady_clock::now();
+        UProve_PublicParams pp = uprove_setup();
+        auto end = steady_clock::now();
+        print_timing("Setup", duration<double, std::milli>(end - start).count());
+
+        Fr sk_c, sk_s, pi;
+        sk_c.setByCSPRNG();
+        sk_s.setByCSPRNG();
+        pi.setByCSPRNG();
+
+        G1 pk_c, pk_s;
+        G1::mul(pk_c, pp.gd, sk_c);
+        G1::mul(pk_s, pp.g0, sk_s);
+
+        start = steady_clock::now();
+        UProve_IssuerContext issuer = uprove_issuer_context(pp, pk_s);
+        UProve_ClientContext server_client = uprove_server_client_context(pp, sk_s, pk_c);
+        UProve_ClientContext client = uprove_client_context(pp, pk_c);
+        end = steady_clock::now();
+        print_timing("Issuer + Client Contexts", duration<double, std::milli>(end - start).count());
+
+        // Client keys that make pk_c or gamma = gxt + pk_c the identity.
+        G1 bad_keys[2];
+        bad_keys[0].clear();
+        G1::neg(bad_keys[1], pp.gxt);
+        for (const G1& bad : bad_keys) {
+            bool refused = false;
+            try {
+                uprove_client_context(pp, bad);
+            } catch (const std::invalid_argument&) {
+                refused = true;
+            }
+            if (!refused) {
+                throw std::runtime_error("uprove: degenerate client key accepted");
+            }
+        }
+
+        // Single run test
+        std::cout << "\n=== Single Run Test ===" << std::endl;
+
+        start = steady_clock::now();
+        Fr w;
+        UProve_InitMessage init_msg = uprove_server_initiate(issuer, server_client, w);
+        end = steady_clock::now();
+        double server_init_time = duration<double, std::milli>(end - start).count();
+        print_timing("Server Initiate", server_init_time);
+
+        Fr alpha, beta2, sigma_c_;
+        G1 H, Sigma_z_;
+
+        start = steady_clock::now();
+        Fr sigma_c = uprove_client_query(issuer, client, pi, init_msg, alpha, beta2, H, Sigma_z_, sigma_c_);
+        end = steady_clock::now();
+        double client_query_time = duration<double, std::milli>(end - start).count();
+        print_timing("Client Query", client_query_time);
+
+        start = steady_clock::now();
+        Fr sigma_r = uprove_server_issue(sk_s, w, sigma_c);
+        end = steady_clock::now();
+        double server_issue_time = duration<double, std::milli>(end - start).count();
+        print_timing("Server Issue", server_issue_time);
+
+        start = steady_clock::now();
+        Fr sigma_r_;
+        bool finalized = uprove_client_final(pp, pk_s, H, pi, sigma_c_, beta2, sigma_r, Sigma_z_, sigma_r_);
+        end = steady_clock::now();
+        double client_final_time = duration<double, std::milli>(end - start).count();
+        print_timing("Client Finalize", client_final_time);
+
+        std::cout << "\n** Total Issuance Time: " << std::fixed << std::setprecision(2)
+                  << (server_init_time + client_query_time + server_issue_time + client_final_time) << " ms **" << std::endl;
+
+        UProve_Token token;
+        token.H = H;
+        token.pi = pi;
+        token.Sigma_z_ = Sigma_z_;
+        token.sigma_c_ = sigma_c_;
+        token.sigma_r_ = sigma_r_;
+
+        Fr wd_, w0, wd;
+
+        start = steady_clock::now();
+        UProve_RedemptionProof1 proof1 = uprove_client_prove_redemption1(pp, token, wd_, w0, wd);
+        end = steady_clock::now();
+        double client_redeem1_time = duration<double, std::milli>(end - start).count();
+        print_timing("Client Redeem Part 1", client_redeem1_time);
+
+        start = steady_clock::now();
+        Fr a = uprove_server_verify_redemption1(pp, pk_s, proof1);
+        end = steady_clock::now();
+        double server_verify1_time = duration<double, std::milli>(end - start).count();
+        print_timing("Server Verify Part 1", server_verify1_time);
+
+        start = steady_clock::now();
+        UProve_RedemptionProof2 proof2 = uprove_client_prove_redemption2(token, proof1.comm, a, sk_c, alpha, wd_, w0, wd);
+        end = steady_clock::now();
+        double client_redeem2_time = duration<double, std::milli>(end - start).count();
+        print_timing("Client Redeem Part 2", client_redeem2_time);
+
+        start = steady_clock::now();
+        bool verified = uprove_server_redeem(pp, token, proof1.comm, a, proof2);
+        end = steady_clock::now();
+        double server_verify2_time = duration<double, std::milli>(end - start).count();
+        print_timing("Server Verify Part 2", server_verify2_time);
+
+        std::cout << "\n** Total Redemption Time: " << std::fixed << std::setprecision(2)
+                  << (client_redeem1_time + server_verify1_time + client_redeem2_time + server_verify2_time) << " ms **" << std::endl;
+
+        std::cout << "\nVerification result: " << (finalized && verified ? "SUCCESS" : "FAILED") << std::endl;
+
+        std::cout << "\n=== Wire Format ===" << std::endl;
+        std::vector<Fr> batch_ws;
+        wire_report_header();
+        wire_report(init_msg);
+        wire_report(uprove_server_initiate_batch(issuer, server_client, 10, batch_ws));
+        wire_report(token);
+        wire_report(proof1);
+        wire_report(proof2);
+        std::cout << std::endl;
+        wire_trust_report_header(64);
+        wire_trust_report(token);
+        wire_trust_report(proof1);
+
+        // Performance test
+        std::cout << "\n=== Performance Test (1000 iterations) ===" << std::endl;
+
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            Fr ww, alpha_i, beta2_i, sc_, sr_;
+            G1 H_i, Sz_;
+            UProve_InitMessage im = uprove_server_initiate(issuer, server_client, ww);
+            Fr sc = uprove_client_query(issuer, client, pi, im, alpha_i, beta2_i, H_i, Sz_, sc_);
+            Fr sr = uprove_server_issue(sk_s, ww, sc);
+            uprove_client_final(pp, pk_s, H_i, pi, sc_, beta2_i, sr, Sz_, sr_);
+        }
+        end = steady_clock::now();
+        double total_issuance = duration<double, std::milli>(end - start).count();
+        std::cout << "Total time for 1000 issuances: " << std::fixed << std::setprecision(2) 
+                  << total_issuance << " ms" << std::endl;
+        std::cout << "Average time per issuance: " << std::fixed << std::setprecision(2) 
+                  << total_issuance / 1000.0 << " ms" << std::endl;
+
+        int redemption_failures = 0;
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            UProve_RedemptionProof1 p1 = uprove_client_prove_redemption1(pp, token, wd_, w0, wd);
+            Fr aa = uprove_server_verify_redemption1(pp, pk_s, p1);
+            UProve_RedemptionProof2 p2 = uprove_client_prove_redemption2(token, p1.comm, aa, sk_c, alpha, wd_, w0, wd);
+            if (!uprove_server_redeem(pp, token, p1.comm, aa, p2)) {
+                ++redemption_failures;
+            }
+        }
+        end = steady_clock::now();
+        double total_redemption = duration<double, std::milli>(end - start).count();
+        if (redemption_failures != 0) {
+            std::cout << "Redemption failures: " << redemption_failures << std::endl;
+        }
+        std::cout << "Total time for 1000 redemptions: " << std::fixed << std::setprecision(2) 
+                  << total_redemption << " ms" << std::endl;
+        std::cout << "Average time per redemption: " << std::fixed << std::setprecision(2) 
+                  << total_redemption / 1000.0 << " ms" << std::endl;
+
+        // Batch issuance: N tokens per protocol session
+        std::cout << "\n=== Batch Issuance (one session, N tokens) ===" << std::endl;
+        const size_t session_sizes[] = { 1, 10, 100, 1000 };
+        {
+            // The client builds its Sigma_z table in its first session and
+            // keeps it, so build it before timing sessions.
+            std::vector<Fr> ws;
+            UProve_BatchClientState state;
+            uprove_client_query_batch(issuer, client, pi, uprove_server_initiate_batch(issuer, server_client, 1, ws),
+                                      state);
+        }
+        for (size_t n : session_sizes) {
+            std::vector<Fr> ws, alpha_invs;
+            std::vector<UProve_Token> tokens;
+            UProve_BatchClientState state;
+
+            start = steady_clock::now();
+            UProve_BatchInitMessage bim = uprove_server_initiate_batch(issuer, server_client, n, ws);
+            std::vector<Fr> scs = uprove_client_query_batch(issuer, client, pi, bim, state);
+            std::vector<Fr> srs = uprove_server_issue_batch(sk_s, ws, scs);
+            bool batch_ok = uprove_client_final_batch(pp, issuer, pi, state, srs, tokens, alpha_invs);
+            end = steady_clock::now();
+            double session_ms = duration<double, std::milli>(end - start).count();
+
+            // Spot-check that a batch-issued token redeems
+            UProve_RedemptionProof1 bp1 = uprove_client_prove_redemption1(pp, tokens[n - 1], wd_, w0, wd);
+            Fr ba = uprove_server_verify_redemption1(pp, pk_s, bp1);
+            UProve_RedemptionProof2 bp2 =
+                uprove_client_prove_redemption2_inv(tokens[n - 1], bp1.comm, ba, sk_c, alpha_invs[n - 1], wd_, w0, wd);
+            batch_ok &= uprove_server_redeem(pp, tokens[n - 1], bp1.comm, ba, bp2);
+
+            std::cout << "N = " << std::setw(4) << n << ": " << std::fixed << std::setprecision(3)
+                      << session_ms / n << " ms/token, ~" << std::setprecision(0)
+                      << n * 1000.0 / session_ms << " tokens/second"
+                      << (batch_ok ? "" : " (FAILED)") << std::endl;
+        }
+
+        // Server initiate + client query recomputing gamma per call vs. from
+        // the issuer and client contexts
+        std::cout << "\n=== Issuance: per-call gamma vs. cached contexts (1000 iterations) ===" << std::endl;
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            Fr ww, alpha_i, beta2_i, sc_;
+            G1 H_i, Sz_;
+            UProve_InitMessage im = uprove_server_initiate(pp, sk_s, pk_c, ww);
+            uprove_client_query(pp, pk_s, pk_c, pi, im, alpha_i, beta2_i, H_i, Sz_, sc_);
+        }
+        end = steady_clock::now();
+        double uncached = duration<double, std::milli>(end - start).count();
+
+        start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i) {
+            Fr ww, alpha_i, beta2_i, sc_;
+            G1 H_i, Sz_;
+            UProve_InitMessage im = uprove_server_initiate(issuer, server_client, ww);
+            uprove_client_query(issuer, client, pi, im, alpha_i, beta2_i, H_i, Sz_, sc_);
+        }
+        end = steady_clock::now();
+        double cached = duration<double, std::milli>(end - start).count();
+
+        print_timing("Initiate + query, per-call", uncached / 1000.0);
+        print_timing("Initiate + query, contexts", cached / 1000.0);
+        print_timing("Saved per issuance", (uncached - cached) / 1000.0);
+
+        std::cout << "\n=== Performance Summary ===" << std::endl;
+        std::cout << "Issuance throughput: ~" << std::fixed << std::setprecision(0)
+                  << 1000000.0 / total_issuance << " tokens/second" << std::endl;
+        std::cout << "Redemption throughput: ~" << std::fixed << std::setprecision(0)
+                  << 1000000.0 / total_redemption << " tokens/second" << std::endl;
+
+        CurveBenchSummary summary;
+        summary.issuance_ms = total_issuance / 1000.0;
+        summary.redemption_ms = total_redemption / 1000.0;
+        return summary;
     }
-    end = steady_clock::now();
-    double total_redemption = duration<double, std::milli>(end - start).count();
-    std::cout << "Total time for 1000 redemptions: " << std::fixed << std::setprecision(2) 
-              << total_redemption << " ms" << std::endl;
-    std::cout << "Average time per redemption: " << std::fixed << std::setprecision(2) 
-              << total_redemption / 1000.0 << " ms" << std::endl;
-    
-    std::cout << "\n=== Performance Summary ===" << std::endl;
-    std::cout << "Issuance throughput: ~" << std::fixed << std::setprecision(0)
-              << 1000000.0 / total_issuance << " tokens/second" << std::endl;
-    std::cout << "Redemption throughput: ~" << std::fixed << std::setprecision(0)
-              << 1000000.0 / total_redemption << " tokens/second" << std::endl;
-              
-    return 0;
+};
+
+// Usage: uprove_benchmark [bn254|bls12_381|bn462|all]
+int main(int argc, char** argv) {
+    std::string curve = argc > 1 ? argv[1] : "bn254";
+    return run_curve_benchmark(curve, UProveBenchmark());
 }
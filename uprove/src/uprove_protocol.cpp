@@ -1,10 +1,15 @@
-#include <mcl/bn256.hpp>
+#include "curve.h"
+#include "scalar_mul.h"
+#include "fixed_base.h"
+#include "batch_inv.h"
+#include "nullifier_store.h"
+#include "wire_format.h"
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <vector>
 #include <openssl/sha.h>
 
-using namespace mcl::bn256;
-
 // U-Prove Protocol Implementation (Simplified for performance testing)
 // Note: U-Prove uses Curve25519, but we use BN256 for consistency with MCL
 
@@ -30,12 +35,165 @@ struct UProve_RedemptionProof2 {
     Fr r0, rd;
 };
 
+// First issuer message of a session issuing N tokens: Sigma_z is shared,
+// Sigma_a/Sigma_b are per token.
+struct UProve_BatchInitMessage {
+    G1 Sigma_z;
+    std::vector<G1> Sigma_a, Sigma_b;
+};
+
+// Wire encodings (wire_format.h).
+template<> struct WireMessage<UProve_InitMessage> {
+    static const uint8_t type = 0x30;
+    static const char* name() { return "UProve_InitMessage"; }
+    enum { SIGMA_Z, SIGMA_A, SIGMA_B };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.Sigma_z);
+        v(m.Sigma_a);
+        v(m.Sigma_b);
+    }
+};
+
+template<> struct WireMessage<UProve_Token> {
+    static const uint8_t type = 0x31;
+    static const char* name() { return "UProve_Token"; }
+    enum { H, SIGMA_Z_, PI, SIGMA_C_, SIGMA_R_ };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.H);
+        v(m.Sigma_z_);
+        v(m.pi);
+        v(m.sigma_c_);
+        v(m.sigma_r_);
+    }
+};
+
+template<> struct WireMessage<UProve_RedemptionProof1> {
+    static const uint8_t type = 0x32;
+    static const char* name() { return "UProve_RedemptionProof1"; }
+    enum { H, SIGMA_Z_, PI, SIGMA_C_, SIGMA_R_, COMM };
+    template<class V, class M> static void visit(V& v, M& m) {
+        WireMessage<UProve_Token>::visit(v, m.token);
+        v(m.comm);
+    }
+};
+
+template<> struct WireMessage<UProve_RedemptionProof2> {
+    static const uint8_t type = 0x33;
+    static const char* name() { return "UProve_RedemptionProof2"; }
+    enum { R0, RD };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.r0);
+        v(m.rd);
+    }
+};
+
+// One (Sigma_a, Sigma_b) record per token.
+template<> struct WireMessage<UProve_BatchInitMessage> {
+    static const uint8_t type = 0x34;
+    static const char* name() { return "UProve_BatchInitMessage"; }
+    enum { SIGMA_Z };
+    template<class V, class M> static void visit(V& v, M& m) {
+        v(m.Sigma_z);
+        v.tail(m.Sigma_a, m.Sigma_b);
+    }
+};
+
+// Client state between uprove_client_query_batch and
+// uprove_client_final_batch, one entry per token.
+struct UProve_BatchClientState {
+    std::vector<Fr> alpha, beta2, sigma_c_;
+    std::vector<G1> H, Sigma_z_, Sigma_a_, Sigma_b_;
+};
+
+// Issuer-key context, shared by the issuer and its clients: pk_s = g0^sk_s
+// and fixed-base tables for g0 and pk_s.
+struct UProve_IssuerContext {
+    G1 pk_s;
+    FixedBaseTable<G1> g0_table;
+    FixedBaseTable<G1> pk_s_table;
+};
+
+// Per-client context: gamma = gxt + pk_c and its table. On the issuer side
+// Sigma_z = gamma^sk_s is cached too, since it is the same every session;
+// the client side records it from the first batch session and keeps its
+// table for later ones.
+struct UProve_ClientContext {
+    G1 gamma;
+    G1 Sigma_z;
+    FixedBaseTable<G1> gamma_table;
+    FixedBaseTable<G1> Sigma_z_table;
+};
+
 void hashToFr_UProve(Fr& result, const unsigned char* data, size_t len) {
     unsigned char hash[SHA256_DIGEST_LENGTH];
     SHA256(data, len, hash);
     result.setArrayMask(hash, 32);
 }
 
+// sigma_c' = H(h, PI, sigma_z', sigma_a', sigma_b')
+static void uprove_token_challenge(Fr& result, const G1& H, const Fr& pi, const G1& Sigma_z_,
+                                   const G1& Sigma_a_, const G1& Sigma_b_) {
+    unsigned char buf[4 * MAX_G1_BYTES + MAX_FR_BYTES];
+    size_t n = 0;
+    n += H.serialize(buf + n, MAX_G1_BYTES);
+    n += pi.serialize(buf + n, MAX_FR_BYTES);
+    n += Sigma_z_.serialize(buf + n, MAX_G1_BYTES);
+    n += Sigma_a_.serialize(buf + n, MAX_G1_BYTES);
+    n += Sigma_b_.serialize(buf + n, MAX_G1_BYTES);
+    hashToFr_UProve(result, buf, n);
+}
+
+// Presentation challenge c = H(h, comm, a), a being the verifier's nonce
+static void uprove_presentation_challenge(Fr& result, const G1& H, const G1& comm, const Fr& a) {
+    unsigned char buf[2 * MAX_G1_BYTES + MAX_FR_BYTES];
+    size_t n = 0;
+    n += H.serialize(buf + n, MAX_G1_BYTES);
+    n += comm.serialize(buf + n, MAX_G1_BYTES);
+    n += a.serialize(buf + n, MAX_FR_BYTES);
+    hashToFr_UProve(result, buf, n);
+}
+
+// gamma = gxt + pk_c, the base of the client's h. Throws
+// std::invalid_argument if pk_c or gamma is the identity: pk_c = gd^sk_c
+// is then the key of sk_c = 0, and a zero gamma makes h and sigma_z zero,
+// which every check below would accept whatever the issuer signed.
+static void uprove_gamma(G1& gamma, const UProve_PublicParams& pp, const G1& pk_c) {
+    if (pk_c.isZero()) {
+        throw std::invalid_argument("uprove: client key is the identity");
+    }
+    G1::add(gamma, pp.gxt, pk_c);
+    if (gamma.isZero()) {
+        throw std::invalid_argument("uprove: gamma = gxt + pk_c is the identity");
+    }
+}
+
+// Checks the issuer's signature on a token:
+//   sigma_a' = g0^sigma_r' * pk_s^-sigma_c'
+//   sigma_b' = h^sigma_r' * sigma_z'^-sigma_c'
+//   sigma_c' == H(h, PI, sigma_z', sigma_a', sigma_b')
+static bool uprove_token_valid(const UProve_PublicParams& pp, const G1& pk_s, const G1& H,
+                               const Fr& pi, const G1& Sigma_z_, const Fr& sigma_c_, const Fr& sigma_r_) {
+    if (H.isZero() || Sigma_z_.isZero()) {
+        return false;
+    }
+    
+    Fr k[2];
+    k[0] = sigma_r_;
+    Fr::neg(k[1], sigma_c_);
+    
+    G1 P[2], Sigma_a_, Sigma_b_;
+    P[0] = pp.g0;
+    P[1] = pk_s;
+    msm_public(Sigma_a_, P, k, 2);
+    P[0] = H;
+    P[1] = Sigma_z_;
+    msm_public(Sigma_b_, P, k, 2);
+    
+    Fr expected;
+    uprove_token_challenge(expected, H, pi, Sigma_z_, Sigma_a_, Sigma_b_);
+    return expected == sigma_c_;
+}
+
 UProve_PublicParams uprove_setup() {
     UProve_PublicParams pp;
     
@@ -55,28 +213,68 @@ UProve_PublicParams uprove_setup() {
     return pp;
 }
 
-UProve_InitMessage uprove_server_initiate(const UProve_PublicParams& pp, const Fr& sk_s, const G1& pk_c) {
+// The issuer's public key is pk_s = g0^sk_s; w_out is the nonce that
+// uprove_server_issue needs for this session.
+UProve_InitMessage uprove_server_initiate(const UProve_PublicParams& pp, const Fr& sk_s, const G1& pk_c,
+                                          Fr& w_out) {
     UProve_InitMessage msg;
     
     Fr w;
     w.setByCSPRNG();
+    w_out = w;
     
     G1 gamma;
-    G1::add(gamma, pp.gxt, pk_c);
-    
-    G1::mul(msg.Sigma_z, gamma, sk_s);
+    uprove_gamma(gamma, pp, pk_c);
     
-    G2 pk_s;
-    hashAndMapToG2(pk_s, "pk_s_uprove");
+    mul_secret(msg.Sigma_z, gamma, sk_s);
     
     // Simplified: use G1 operations
-    G1::mul(msg.Sigma_a, pp.g0, w);
-    G1::mul(msg.Sigma_b, gamma, w);
+    mul_secret(msg.Sigma_a, pp.g0, w);
+    mul_secret(msg.Sigma_b, gamma, w);
     
     return msg;
 }
 
-Fr uprove_client_query(const UProve_PublicParams& pp, const G1& pk_c, const Fr& pi, 
+UProve_IssuerContext uprove_issuer_context(const UProve_PublicParams& pp, const G1& pk_s) {
+    UProve_IssuerContext issuer;
+    issuer.pk_s = pk_s;
+    issuer.g0_table.init(pp.g0);
+    issuer.pk_s_table.init(pk_s);
+    return issuer;
+}
+
+// Client-side context; Sigma_z is left clear.
+UProve_ClientContext uprove_client_context(const UProve_PublicParams& pp, const G1& pk_c) {
+    UProve_ClientContext client;
+    uprove_gamma(client.gamma, pp, pk_c);
+    client.Sigma_z.clear();
+    client.gamma_table.init(client.gamma);
+    return client;
+}
+
+// Issuer-side context for one client, including Sigma_z = gamma^sk_s.
+UProve_ClientContext uprove_server_client_context(const UProve_PublicParams& pp, const Fr& sk_s,
+                                                  const G1& pk_c) {
+    UProve_ClientContext client = uprove_client_context(pp, pk_c);
+    client.gamma_table.mul(client.Sigma_z, sk_s);
+    return client;
+}
+
+// uprove_server_initiate from cached contexts: two fixed-base
+// multiplications by the session nonce w.
+UProve_InitMessage uprove_server_initiate(const UProve_IssuerContext& issuer, const UProve_ClientContext& client,
+                                          Fr& w_out) {
+    UProve_InitMessage msg;
+    w_out.setByCSPRNG();
+    
+    msg.Sigma_z = client.Sigma_z;
+    issuer.g0_table.mul(msg.Sigma_a, w_out);
+    client.gamma_table.mul(msg.Sigma_b, w_out);
+    
+    return msg;
+}
+
+Fr uprove_client_query(const UProve_PublicParams& pp, const G1& pk_s, const G1& pk_c, const Fr& pi, 
                        const UProve_InitMessage& init_msg,
                        Fr& alpha_out, Fr& beta2_out, G1& H_out, G1& Sigma_z_out, Fr& sigma_c_out) {
     Fr alpha, beta1, beta2;
@@ -88,15 +286,65 @@ Fr uprove_client_query(const UProve_PublicParams& pp, const G1& pk_c, const Fr&
     beta2_out = beta2;
     
     G1 temp;
-    G1::add(temp, pp.gxt, pk_c);
-    G1::mul(H_out, temp, alpha);
+    uprove_gamma(temp, pp, pk_c);
+    mul_secret(H_out, temp, alpha);
     
-    G1::mul(Sigma_z_out, init_msg.Sigma_z, alpha);
+    mul_secret(Sigma_z_out, init_msg.Sigma_z, alpha);
     
-    // Simplified hash computation
-    unsigned char buf[256];
-    H_out.serialize(buf, 64);
-    hashToFr_UProve(sigma_c_out, buf, 64);
+    // sigma_a' = pk_s^beta1 * g0^beta2 * sigma_a
+    G1 Sigma_a_, Sigma_b_;
+    mul_secret(Sigma_a_, pk_s, beta1);
+    mul_secret(temp, pp.g0, beta2);
+    Sigma_a_ += temp;
+    Sigma_a_ += init_msg.Sigma_a;
+    
+    // sigma_b' = sigma_z'^beta1 * h^beta2 * sigma_b^alpha
+    mul_secret(Sigma_b_, Sigma_z_out, beta1);
+    mul_secret(temp, H_out, beta2);
+    Sigma_b_ += temp;
+    mul_secret(temp, init_msg.Sigma_b, alpha);
+    Sigma_b_ += temp;
+    
+    uprove_token_challenge(sigma_c_out, H_out, pi, Sigma_z_out, Sigma_a_, Sigma_b_);
+    
+    Fr sigma_c;
+    Fr::add(sigma_c, sigma_c_out, beta1);
+    
+    return sigma_c;
+}
+
+// uprove_client_query from cached contexts; gamma, g0 and pk_s come from
+// their tables.
+Fr uprove_client_query(const UProve_IssuerContext& issuer, const UProve_ClientContext& client, const Fr& pi,
+                       const UProve_InitMessage& init_msg,
+                       Fr& alpha_out, Fr& beta2_out, G1& H_out, G1& Sigma_z_out, Fr& sigma_c_out) {
+    Fr alpha, beta1, beta2;
+    alpha.setByCSPRNG();
+    beta1.setByCSPRNG();
+    beta2.setByCSPRNG();
+    
+    alpha_out = alpha;
+    beta2_out = beta2;
+    
+    client.gamma_table.mul(H_out, alpha);
+    mul_secret(Sigma_z_out, init_msg.Sigma_z, alpha);
+    
+    // sigma_a' = pk_s^beta1 * g0^beta2 * sigma_a
+    G1 temp, Sigma_a_, Sigma_b_;
+    issuer.pk_s_table.mul(Sigma_a_, beta1);
+    issuer.g0_table.mul(temp, beta2);
+    Sigma_a_ += temp;
+    Sigma_a_ += init_msg.Sigma_a;
+    
+    // sigma_b' = sigma_z'^beta1 * h^beta2 * sigma_b^alpha
+    //          = sigma_z'^beta1 * (gamma^beta2 * sigma_b)^alpha
+    mul_secret(Sigma_b_, Sigma_z_out, beta1);
+    client.gamma_table.mul(temp, beta2);
+    temp += init_msg.Sigma_b;
+    mul_secret(temp, temp, alpha);
+    Sigma_b_ += temp;
+    
+    uprove_token_challenge(sigma_c_out, H_out, pi, Sigma_z_out, Sigma_a_, Sigma_b_);
     
     Fr sigma_c;
     Fr::add(sigma_c, sigma_c_out, beta1);
@@ -111,9 +359,174 @@ Fr uprove_server_issue(const Fr& sk_s, const Fr& w, const Fr& sigma_c) {
     return sigma_r;
 }
 
-bool uprove_client_final(const UProve_PublicParams& pp, const G1& H, const Fr& sigma_c_, 
-                         const Fr& beta2, const Fr& sigma_r, const G1& Sigma_z_) {
-    // Skip verification for performance testing
+// Unblinds sigma_r' = sigma_r + beta2 and checks the resulting token.
+bool uprove_client_final(const UProve_PublicParams& pp, const G1& pk_s, const G1& H, const Fr& pi,
+                         const Fr& sigma_c_, const Fr& beta2, const Fr& sigma_r, const G1& Sigma_z_,
+                         Fr& sigma_r_out) {
+    Fr::add(sigma_r_out, sigma_r, beta2);
+    return uprove_token_valid(pp, pk_s, H, pi, Sigma_z_, sigma_c_, sigma_r_out);
+}
+
+// Batch issuance: one session issues n tokens to the client of `client`.
+UProve_BatchInitMessage uprove_server_initiate_batch(const UProve_IssuerContext& issuer,
+                                                     const UProve_ClientContext& client,
+                                                     size_t n, std::vector<Fr>& w_out) {
+    UProve_BatchInitMessage msg;
+    msg.Sigma_z = client.Sigma_z;
+    msg.Sigma_a.resize(n);
+    msg.Sigma_b.resize(n);
+    w_out.resize(n);
+    
+    for (size_t i = 0; i < n; ++i) {
+        w_out[i].setByCSPRNG();
+        issuer.g0_table.mul(msg.Sigma_a[i], w_out[i]);
+        client.gamma_table.mul(msg.Sigma_b[i], w_out[i]);
+    }
+    
+    return msg;
+}
+
+// Returns the n blinded challenges sigma_c. Sigma_z is the same for every
+// token and every session of this client and issuer key, so its table is
+// built once and kept in `client`; it is rebuilt only if Sigma_z changes
+// (a new issuer key).
+std::vector<Fr> uprove_client_query_batch(const UProve_IssuerContext& issuer, UProve_ClientContext& client,
+                                          const Fr& pi, const UProve_BatchInitMessage& init_msg,
+                                          UProve_BatchClientState& state) {
+    size_t n = init_msg.Sigma_a.size();
+    if (init_msg.Sigma_b.size() != n) {
+        throw std::invalid_argument("uprove_client_query_batch: Sigma_a/Sigma_b size mismatch");
+    }
+    
+    if (client.Sigma_z_table.empty() || client.Sigma_z != init_msg.Sigma_z) {
+        client.Sigma_z_table.init(init_msg.Sigma_z);
+        client.Sigma_z = init_msg.Sigma_z;
+    }
+    const FixedBaseTable<G1>& Sigma_z_table = client.Sigma_z_table;
+    
+    state.alpha.resize(n);
+    state.beta2.resize(n);
+    state.sigma_c_.resize(n);
+    state.H.resize(n);
+    state.Sigma_z_.resize(n);
+    state.Sigma_a_.resize(n);
+    state.Sigma_b_.resize(n);
+    
+    std::vector<Fr> sigma_c(n);
+    Fr beta1, alpha_beta1;
+    G1 temp;
+    for (size_t i = 0; i < n; ++i) {
+        state.alpha[i].setByCSPRNG();
+        state.beta2[i].setByCSPRNG();
+        beta1.setByCSPRNG();
+        
+        client.gamma_table.mul(state.H[i], state.alpha[i]);
+        Sigma_z_table.mul(state.Sigma_z_[i], state.alpha[i]);
+        
+        issuer.pk_s_table.mul(state.Sigma_a_[i], beta1);
+        issuer.g0_table.mul(temp, state.beta2[i]);
+        state.Sigma_a_[i] += temp;
+        state.Sigma_a_[i] += init_msg.Sigma_a[i];
+        
+        // sigma_b' = Sigma_z^(alpha*beta1) * (gamma^beta2 * sigma_b)^alpha
+        Fr::mul(alpha_beta1, state.alpha[i], beta1);
+        Sigma_z_table.mul(state.Sigma_b_[i], alpha_beta1);
+        client.gamma_table.mul(temp, state.beta2[i]);
+        temp += init_msg.Sigma_b[i];
+        mul_secret(temp, temp, state.alpha[i]);
+        state.Sigma_b_[i] += temp;
+        
+        uprove_token_challenge(state.sigma_c_[i], state.H[i], pi, state.Sigma_z_[i],
+                               state.Sigma_a_[i], state.Sigma_b_[i]);
+        Fr::add(sigma_c[i], state.sigma_c_[i], beta1);
+    }
+    
+    return sigma_c;
+}
+
+std::vector<Fr> uprove_server_issue_batch(const Fr& sk_s, const std::vector<Fr>& w,
+                                          const std::vector<Fr>& sigma_c) {
+    size_t n = w.size();
+    if (sigma_c.size() != n) {
+        throw std::invalid_argument("uprove_server_issue_batch: one challenge per nonce");
+    }
+    
+    std::vector<Fr> sigma_r(n);
+    for (size_t i = 0; i < n; ++i) {
+        Fr::mul(sigma_r[i], sk_s, sigma_c[i]);
+        sigma_r[i] += w[i];
+    }
+    return sigma_r;
+}
+
+// Unblinds all n tokens and checks them together. With random rho_i, tau_i
+// the 2n equations
+//   sigma_a'_i = g0^sigma_r'_i * pk_s^-sigma_c'_i
+//   sigma_b'_i = h_i^sigma_r'_i * sigma_z'_i^-sigma_c'_i
+// are folded into one MSM of 4n + 2 terms that must be zero. Also returns
+// 1/alpha for every token (one inversion for all n), which the
+// presentation proof needs.
+bool uprove_client_final_batch(const UProve_PublicParams& pp, const UProve_IssuerContext& issuer,
+                               const Fr& pi, const UProve_BatchClientState& state,
+                               const std::vector<Fr>& sigma_r, std::vector<UProve_Token>& tokens,
+                               std::vector<Fr>& alpha_inv) {
+    size_t n = state.alpha.size();
+    if (sigma_r.size() != n) {
+        throw std::invalid_argument("uprove_client_final_batch: one response per token");
+    }
+    
+    tokens.resize(n);
+    std::vector<G1> P(4 * n + 2);
+    std::vector<Fr> k(4 * n + 2);
+    Fr g0_coeff, pk_s_coeff, rho, tau;
+    g0_coeff.clear();
+    pk_s_coeff.clear();
+    
+    for (size_t i = 0; i < n; ++i) {
+        UProve_Token& token = tokens[i];
+        token.H = state.H[i];
+        token.pi = pi;
+        token.Sigma_z_ = state.Sigma_z_[i];
+        token.sigma_c_ = state.sigma_c_[i];
+        Fr::add(token.sigma_r_, sigma_r[i], state.beta2[i]);
+        if (token.H.isZero() || token.Sigma_z_.isZero()) {
+            return false;
+        }
+        
+        rho.setByCSPRNG();
+        tau.setByCSPRNG();
+        
+        // rho * (sigma_a' - g0*sigma_r' + pk_s*sigma_c')
+        P[4 * i] = state.Sigma_a_[i];
+        k[4 * i] = rho;
+        Fr temp;
+        Fr::mul(temp, rho, token.sigma_r_);
+        g0_coeff -= temp;
+        Fr::mul(temp, rho, token.sigma_c_);
+        pk_s_coeff += temp;
+        
+        // tau * (sigma_b' - h*sigma_r' + sigma_z'*sigma_c')
+        P[4 * i + 1] = state.Sigma_b_[i];
+        k[4 * i + 1] = tau;
+        P[4 * i + 2] = token.H;
+        Fr::mul(k[4 * i + 2], tau, token.sigma_r_);
+        Fr::neg(k[4 * i + 2], k[4 * i + 2]);
+        P[4 * i + 3] = token.Sigma_z_;
+        Fr::mul(k[4 * i + 3], tau, token.sigma_c_);
+    }
+    P[4 * n] = pp.g0;
+    k[4 * n] = g0_coeff;
+    P[4 * n + 1] = issuer.pk_s;
+    k[4 * n + 1] = pk_s_coeff;
+    
+    G1 check;
+    msm_public(check, P.data(), k.data(), P.size());
+    if (!check.isZero()) {
+        return false;
+    }
+    
+    alpha_inv.resize(n);
+    batch_inv(alpha_inv.data(), state.alpha.data(), n);
     return true;
 }
 
@@ -133,9 +546,9 @@ UProve_RedemptionProof1 uprove_client_prove_redemption1(const UProve_PublicParam
     proof.token = token;
     
     G1 temp1, temp2, temp3;
-    G1::mul(temp1, token.H, w0);
-    G1::mul(temp2, pp.gd, wd);
-    G1::mul(temp3, pp.gd, wd_);
+    mul_secret(temp1, token.H, w0);
+    mul_secret(temp2, pp.gd, wd);
+    mul_secret(temp3, pp.gd, wd_);
     
     G1::add(proof.comm, temp1, temp2);
     G1::add(proof.comm, proof.comm, temp3);
@@ -143,23 +556,27 @@ UProve_RedemptionProof1 uprove_client_prove_redemption1(const UProve_PublicParam
     return proof;
 }
 
-Fr uprove_server_verify_redemption1(const UProve_PublicParams& pp, const UProve_RedemptionProof1& proof) {
-    // Skip verification for performance testing
+// Checks the presented token and, if it is valid, returns the verifier's
+// nonce a; throws std::runtime_error otherwise.
+Fr uprove_server_verify_redemption1(const UProve_PublicParams& pp, const G1& pk_s,
+                                    const UProve_RedemptionProof1& proof) {
+    const UProve_Token& token = proof.token;
+    if (!uprove_token_valid(pp, pk_s, token.H, token.pi, token.Sigma_z_, token.sigma_c_, token.sigma_r_)) {
+        throw std::runtime_error("uprove_server_verify_redemption1: invalid token");
+    }
+    
     Fr a;
     a.setByCSPRNG();
     return a;
 }
 
-UProve_RedemptionProof2 uprove_client_prove_redemption2(const UProve_Token& token, const Fr& a,
-                                                         const Fr& sk_c, const Fr& alpha,
-                                                         const Fr& wd_, const Fr& w0, const Fr& wd) {
-    // Simplified hash computation
-    unsigned char buf[64];
-    token.H.serialize(buf, 64);
-    
-    Fr c_p, c;
-    hashToFr_UProve(c_p, buf, 64);
-    hashToFr_UProve(c, buf, 32);
+// As uprove_client_prove_redemption2, for a client that already holds
+// 1/alpha (uprove_client_final_batch returns it for every token).
+UProve_RedemptionProof2 uprove_client_prove_redemption2_inv(const UProve_Token& token, const G1& comm, const Fr& a,
+                                                             const Fr& sk_c, const Fr& alpha_inv,
+                                                             const Fr& wd_, const Fr& w0, const Fr& wd) {
+    Fr c;
+    uprove_presentation_challenge(c, token.H, comm, a);
     
     UProve_RedemptionProof2 proof;
     
@@ -168,16 +585,45 @@ UProve_RedemptionProof2 uprove_client_prove_redemption2(const UProve_Token& toke
     Fr::sub(temp2, wd_, temp1);
     Fr::add(proof.rd, temp2, wd);
     
-    Fr alpha_inv;
-    Fr::inv(alpha_inv, alpha);
     Fr::mul(temp1, c, alpha_inv);
     Fr::add(proof.r0, temp1, w0);
     
     return proof;
 }
 
+UProve_RedemptionProof2 uprove_client_prove_redemption2(const UProve_Token& token, const G1& comm, const Fr& a,
+                                                         const Fr& sk_c, const Fr& alpha,
+                                                         const Fr& wd_, const Fr& w0, const Fr& wd) {
+    Fr alpha_inv;
+    Fr::inv(alpha_inv, alpha);
+    return uprove_client_prove_redemption2_inv(token, comm, a, sk_c, alpha_inv, wd_, w0, wd);
+}
+
+// h = (gxt * gd^sk_c)^alpha, so the prover knows (1/alpha, sk_c) with
+// gxt = h^(1/alpha) * gd^-sk_c. Checks h^r0 * gd^rd * gxt^-c == comm.
 bool uprove_server_redeem(const UProve_PublicParams& pp, const UProve_Token& token,
                           const G1& comm, const Fr& a, const UProve_RedemptionProof2& proof) {
-    // Skip verification for performance testing
-    return true;
+    if (token.H.isZero()) {
+        return false;
+    }
+    Fr c;
+    uprove_presentation_challenge(c, token.H, comm, a);
+    
+    G1 P[3] = { token.H, pp.gd, pp.gxt };
+    Fr k[3];
+    k[0] = proof.r0;
+    k[1] = proof.rd;
+    Fr::neg(k[2], c);
+    
+    G1 lhs;
+    msm_public(lhs, P, k, 3);
+    return lhs == comm;
+}
+
+// uprove_server_redeem plus the double-spend check on the token's h.
+bool uprove_server_redeem(const UProve_PublicParams& pp, const UProve_Token& token,
+                          const G1& comm, const Fr& a, const UProve_RedemptionProof2& proof,
+                          NullifierStore& spent) {
+    return uprove_server_redeem(pp, token, comm, a, proof) &&
+           spent.insert(nullifier_tag("uprove/h", token.H));
 }